@@ -0,0 +1,95 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Conversion.c
+ * \brief Source file including the integer conversion of LIS3DH raw data into mm/s^2
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Conversion.h"
+
+
+/*
+ * The Cortex-M3 has no FPU, so the former conversion (counts/1000.0*9.81, then *1000
+ * and truncation) was done by the software floating point library.
+ * Here: mm/s^2 = counts * (mg/digit) * 9.81, truncated towards zero, computed as
+ * (|counts| * multiplier) >> scale_shift with a 32x32->64 bit multiplication (UMULL).
+ * Each scale_shift is the smallest one for which the result is identical to the exact
+ * value for every possible input of that mode (for HR +-2g this is also bit-identical
+ * to the former float code, checked on all the 4096 12-bit inputs).
+ *
+ * Sensitivity [mg/digit] (datasheet table 4):
+ *         +-2g  +-4g  +-8g  +-16g
+ *   HR      1     2     4    12
+ *   NORMAL  4     8    16    48
+ *   LP     16    32    64   192
+*/
+static const ConversionConstants conversion_table[CONVERSION_RESOLUTIONS][CONVERSION_FULL_SCALES] = {
+    // High resolution (12-bit)
+    { {4, 18, 2571633}, {4, 17, 2571633}, {4, 16, 2571633}, {4, 15, 3857449} },
+    // Normal (10-bit)
+    { {6, 14,  642909}, {6, 14, 1285817}, {6, 14, 2571633}, {6, 13, 3857449} },
+    // Low power (8-bit)
+    { {8, 12,  642909}, {8, 12, 1285817}, {8, 11, 1285817}, {8, 11, 3857449} }
+};
+
+// Constants of the current operating mode (HR, +-2g as set at startup)
+static const ConversionConstants* conversion_mode = &conversion_table[CONVERSION_HIGH_RESOLUTION][CONVERSION_FS_2G];
+
+
+/*
+ * Definition of function that selects the constants for the operating mode
+ * of the LIS3DH. As parameters it requires:
+ * - resolution mode
+ * - full scale
+*/
+void Conversion_SetMode(uint8_t resolution,
+                        uint8_t full_scale) {
+    
+    if((resolution < CONVERSION_RESOLUTIONS) && (full_scale < CONVERSION_FULL_SCALES)) {
+        conversion_mode = &conversion_table[resolution][full_scale];
+    }
+    
+} // end Conversion_SetMode
+
+
+/*
+ * Definition of function that converts the content of an OUT_x_L/OUT_x_H couple
+ * of registers into mm/s^2. As parameter it requires:
+ * - pointer to the two bytes (LSB first)
+*/
+int32_t Conversion_ToMilliMs2(const uint8_t* raw_data) {
+    
+    // Data are left-justified: arithmetic shift to get the signed counts
+    int16_t counts = (int16_t)(raw_data[0] | (raw_data[1]<<8)) >> conversion_mode->justify_shift;
+    
+    // Work on the magnitude so that the result is truncated towards zero. The sign is
+    // applied with a mask (all ones if negative) instead of a branch: x ^ mask - mask = -x
+    int32_t  sign      = (int32_t)counts >> 15;
+    uint32_t magnitude = (uint32_t)(((int32_t)counts ^ sign) - sign);
+    int32_t  result    = (int32_t)(((uint64_t)magnitude * conversion_mode->multiplier) >> conversion_mode->scale_shift);
+    
+    return (result ^ sign) - sign;
+    
+} // end Conversion_ToMilliMs2
+
+
+/* [] END OF FILE */
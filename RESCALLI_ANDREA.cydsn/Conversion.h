@@ -0,0 +1,76 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Conversion.h
+ * \brief Header file including the integer conversion of LIS3DH raw data into mm/s^2
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __CONVERSION_H_
+    #define __CONVERSION_H_
+    
+    // Includes
+    #include "cytypes.h"
+    
+    
+    // Defines
+        // Resolution modes (LPen bit of CTRL_REG1, HR bit of CTRL_REG4)
+    #define CONVERSION_HIGH_RESOLUTION  0  // 12-bit data
+    #define CONVERSION_NORMAL           1  // 10-bit data
+    #define CONVERSION_LOW_POWER        2  // 8-bit data
+    #define CONVERSION_RESOLUTIONS      3
+    
+        // Full scales (FS bits of CTRL_REG4)
+    #define CONVERSION_FS_2G            0
+    #define CONVERSION_FS_4G            1
+    #define CONVERSION_FS_8G            2
+    #define CONVERSION_FS_16G           3
+    #define CONVERSION_FULL_SCALES      4
+    
+    
+    // Constants of the conversion for one operating mode
+    typedef struct {
+        uint8_t  justify_shift; // Right shift from the left-justified OUT registers
+        uint8_t  scale_shift;   // Right shift applied after the multiplication
+        uint32_t multiplier;    // (mg/digit * 9.81) * 2^scale_shift
+    } ConversionConstants;
+    
+    
+    /*
+     * Declaration of function that selects the constants for the operating mode
+     * of the LIS3DH. As parameters it requires:
+     * - resolution mode (CONVERSION_HIGH_RESOLUTION, CONVERSION_NORMAL, CONVERSION_LOW_POWER)
+     * - full scale (CONVERSION_FS_2G ... CONVERSION_FS_16G)
+    */
+    void Conversion_SetMode(uint8_t resolution,
+                            uint8_t full_scale);
+    
+    
+    /*
+     * Declaration of function that converts the content of an OUT_x_L/OUT_x_H couple
+     * of registers into mm/s^2, using integer math only.
+     * As parameter it requires:
+     * - pointer to the two bytes (LSB first)
+     * Returns the acceleration in mm/s^2, truncated towards zero
+    */
+    int32_t Conversion_ToMilliMs2(const uint8_t* raw_data);
+    
+#endif
+
+/* [] END OF FILE */
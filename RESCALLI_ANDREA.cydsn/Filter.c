@@ -0,0 +1,161 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Filter.c
+ * \brief Source file including the functions of the fixed-point filters applied to the samples
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Filter.h"
+
+
+// State of a biquad on one axis (Direct Form I)
+typedef struct {
+    int16_t x1, x2; // Previous inputs (Q15)
+    int32_t y1, y2; // Previous outputs (Q31: 16 more bits than the output)
+} FilterState;
+
+
+// Useful variables
+const FilterConfig filter_presets[FILTER_PRESETS] = {
+    {0, 1, {{0}}},
+    {1, 1, {{  72429549,   144859098,   72429549, 1227265970, -443242341}}},
+    {1, 1, {{1027080468, -2054160935, 1027080468, 2052132225, -982447822}}},
+    {2, 4, {{  20440642,    40881285,   20440642, 1588788093, -596808838},   // Q = 0.541
+            {  23497607,    46995214,   23497607, 1826396544, -846645149}}}  // Q = 1.307
+};
+
+static FilterConfig filter_config = {0, 1, {{0}}};
+static FilterState  filter_states[PACKET_MAX_SENSORS][AXES][FILTER_MAX_STAGES];
+static uint8_t      filter_count[PACKET_MAX_SENSORS]; // Samples since the last output
+
+
+/*
+ * Definition of function that sets up the filters and resets their state.
+ * As parameter it requires:
+ * - pointer to the configuration
+*/
+void Filter_Configure(const FilterConfig* config) {
+    
+    filter_config = *config;
+    
+    if(filter_config.stages > FILTER_MAX_STAGES) {
+        filter_config.stages = FILTER_MAX_STAGES;
+    }
+    if(filter_config.decimation < 1) {
+        filter_config.decimation = 1;
+    }
+    
+    for(uint8_t sensor = 0; sensor < PACKET_MAX_SENSORS; sensor++) {
+        for(uint8_t axis = 0; axis < AXES; axis++) {
+            for(uint8_t stage = 0; stage < FILTER_MAX_STAGES; stage++) {
+                filter_states[sensor][axis][stage] = (FilterState){0, 0, 0, 0};
+            }
+        }
+        filter_count[sensor] = 0;
+    }
+    
+} // end Filter_Configure
+
+
+/*
+ * Definition of function that runs one sample through a biquad.
+ * The parameters needed are:
+ * - pointer to the coefficients
+ * - pointer to the state
+ * - input sample
+ * Returns the output sample
+*/
+static int16_t Filter_Biquad(const FilterBiquad* biquad,
+                             FilterState* state,
+                             int16_t x0) {
+    
+    // Feedback in Q61, brought to the Q45 of the feed-forward terms (rounded)
+    int64_t feedback    = (int64_t)biquad->a1*state->y1 + (int64_t)biquad->a2*state->y2;
+    int64_t accumulator = (int64_t)biquad->b0*x0        + (int64_t)biquad->b1*state->x1 +
+                          (int64_t)biquad->b2*state->x2 +
+                          ((feedback + (1LL << (FILTER_STATE_BITS-1))) >> FILTER_STATE_BITS);
+    
+    // Round to nearest, to Q31 for the state, saturate (the arithmetic shift is what
+    // both arm-gcc and the host compilers do on signed values)
+    accumulator = (accumulator + (1LL << (FILTER_COEFF_SHIFT-FILTER_STATE_BITS-1))) >>
+                  (FILTER_COEFF_SHIFT-FILTER_STATE_BITS);
+    if(accumulator > INT32_MAX) {
+        accumulator = INT32_MAX;
+    }
+    if(accumulator < INT32_MIN) {
+        accumulator = INT32_MIN;
+    }
+    
+    state->x2 = state->x1;
+    state->x1 = x0;
+    state->y2 = state->y1;
+    state->y1 = (int32_t) accumulator;
+    
+    // Output rounded to Q15
+    accumulator = (accumulator + (1LL << (FILTER_STATE_BITS-1))) >> FILTER_STATE_BITS;
+    if(accumulator > INT16_MAX) {
+        accumulator = INT16_MAX;
+    }
+    
+    return (int16_t) accumulator;
+    
+} // end Filter_Biquad
+
+
+/*
+ * Definition of function that filters one raw XYZ sample.
+ * The parameters needed are:
+ * - index of the sensor
+ * - pointer to the raw sample
+ * - pointer where to save the filtered sample
+*/
+uint8_t Filter_Process(uint8_t sensor,
+                       const uint8_t* raw_data,
+                       uint8_t* filtered_data) {
+    
+    for(uint8_t axis = 0; axis < AXES; axis++) {
+        
+        int16_t sample = (int16_t)(raw_data[2*axis] | (raw_data[2*axis+1]<<8));
+        
+        for(uint8_t stage = 0; stage < filter_config.stages; stage++) {
+            sample = Filter_Biquad(&filter_config.biquads[stage],
+                                   &filter_states[sensor][axis][stage],
+                                   sample);
+        }
+        
+        filtered_data[2*axis]   = (uint8_t) (sample & 0xFF);
+        filtered_data[2*axis+1] = (uint8_t) ((uint16_t)sample>>8);
+        
+    } // end for(axis)
+    
+    // The filters run on every sample, only one every 'decimation' goes on
+    if(++filter_count[sensor] < filter_config.decimation) {
+        return 0;
+    }
+    filter_count[sensor] = 0;
+    
+    return 1;
+    
+} // end Filter_Process
+
+
+/* [] END OF FILE */
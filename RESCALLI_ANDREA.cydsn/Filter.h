@@ -0,0 +1,110 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Filter.h
+ * \brief Header file including the functions of the fixed-point filters applied to the samples
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __FILTER_H_
+    #define __FILTER_H_
+    
+    // Includes
+    #include "cytypes.h"
+    #include "Packet.h"
+    
+    
+    // Defines
+    #ifndef FILTER_ENABLED
+        #define FILTER_ENABLED       0     // 1 --> samples go through the filters before packing
+    #endif
+    
+    #define FILTER_MAX_STAGES    4     // Max # biquads in cascade
+    #define FILTER_COEFF_SHIFT   30    // Coefficients in Q30 (|coefficient| < 2)
+    #define FILTER_STATE_BITS    16    // Bits of the outputs kept in the state beyond Q15
+    #define FILTER_CMD           'F'   // Character to be received via UART to move to the next preset
+    
+    /*
+     * Biquad in Direct Form I, on the raw samples (left-justified int16, i.e. Q15):
+     * y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2]
+     * a1 and a2 are stored with the sign already changed, so that every term is added.
+     * The products are accumulated in 64 bits, rounded and saturated: the same code
+     * gives the same bits on any CPU. y[n-1] and y[n-2] are kept in Q31: with poles
+     * close to 1 (high-pass at ODR/100, a1+a2 = 0.996) outputs rounded to Q15 in the
+     * state would leave a dead band of about +-131 LSB, i.e. an offset that never
+     * settles. The feedback is computed in Q61 and rounded to the Q45 of the
+     * feed-forward terms, the sum is rounded to Q31 (state) and then to Q15 (output).
+    */
+    typedef struct {
+        int32_t b0, b1, b2; // Feed-forward coefficients (Q30)
+        int32_t a1, a2;     // Feedback coefficients, sign changed (Q30)
+    } FilterBiquad;
+    
+    // Filter pipeline: biquads in cascade, then one output every 'decimation' samples
+    typedef struct {
+        uint8_t      stages;                      // # biquads (0 --> no filtering)
+        uint8_t      decimation;                  // 1 --> every sample is kept
+        FilterBiquad biquads[FILTER_MAX_STAGES];
+    } FilterConfig;
+    
+    /*
+     * Presets (cut-off frequencies relative to the ODR, so they hold for any ODR):
+     * 0 --> no filtering
+     * 1 --> low-pass, 2nd order Butterworth at ODR/10
+     * 2 --> high-pass, 2nd order Butterworth at ODR/100 (gravity and drift removal)
+     * 3 --> low-pass, 4th order Butterworth at ODR/20, decimation by 4 (samples at ODR/4)
+    */
+    #define FILTER_PRESETS       4
+    extern const FilterConfig filter_presets[FILTER_PRESETS];
+    
+    /*
+     * Cycle budget per sample (3 axes), estimated for the Cortex-M3 (not measured on
+     * the target yet): about 50 cycles per biquad per axis (3 SMLAL, 2 SMULL/SMLAL on
+     * the Q31 state, two roundings, saturation, state update), so about 150 cycles per
+     * stage, 600 cycles with FILTER_MAX_STAGES stages, i.e. 25 us at 24 MHz, 1% of the
+     * 2.5 ms period at 400 Hz.
+     * On the target the PROFILER_FILTER stage measures it (see "Profiler.h"); on the
+     * host bench_filter gives 9-11 ns per biquad per axis and test_filter checks the
+     * output bit by bit against a reference (see host/README.txt)
+    */
+    
+    
+    /*
+     * Declaration of function that sets up the filters and resets their state.
+     * As parameter it requires:
+     * - pointer to the configuration (copied)
+    */
+    void Filter_Configure(const FilterConfig* config);
+    
+    
+    /*
+     * Declaration of function that filters one raw XYZ sample (6 bytes, LSB first).
+     * The parameters needed are:
+     * - index of the sensor (each one has its own filter state)
+     * - pointer to the raw sample
+     * - pointer where to save the filtered sample (same format)
+     * Returns 1 if a filtered sample is ready, 0 if the sample has been decimated away
+    */
+    uint8_t Filter_Process(uint8_t sensor,
+                           const uint8_t* raw_data,
+                           uint8_t* filtered_data);
+    
+#endif
+
+/* [] END OF FILE */
@@ -25,6 +25,13 @@
 // Includes
 #include "I2C.h"
 #include "I2C_Master.h"
+#include <string.h>
+
+
+// Queue of asynchronous transactions (served in order)
+static I2C_AsyncTransaction async_queue[I2C_ASYNC_QUEUE_SIZE];
+static uint8_t async_head = 0; // Transaction currently served
+static uint8_t async_tail = 0; // Next free slot
 
 
 /*
@@ -33,6 +40,9 @@
 */
 uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address) {
 
+    // The bus must be free from queued transactions
+    I2C_Async_Flush();
+
     // Send a start condition followed by a stop condition
     uint8_t temp = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
     I2C_Master_MasterSendStop();
@@ -57,6 +67,9 @@ uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address) {
 uint8_t I2C_Peripheral_ReadRegister(uint8_t device_address, 
                                     uint8_t register_address,
                                     uint8_t* data) {
+
+    // The bus must be free from queued transactions
+    I2C_Async_Flush();
                                     
     // Start condition
     
@@ -99,6 +112,9 @@ uint8_t I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
                                          uint8_t register_address,
                                          uint8_t register_count,
                                          uint8_t* data) {
+
+    // The bus must be free from queued transactions
+    I2C_Async_Flush();
                                         
     // Start condition
                                         
@@ -151,6 +167,9 @@ uint8_t I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
 uint8_t I2C_Peripheral_WriteRegister(uint8_t device_address,
                                      uint8_t register_address,
                                      uint8_t data) {
+
+    // The bus must be free from queued transactions
+    I2C_Async_Flush();
                                     
     // Start condition
                                     
@@ -173,6 +192,339 @@ uint8_t I2C_Peripheral_WriteRegister(uint8_t device_address,
     return temp ? ERROR : NO_ERROR;
 
 } // end I2C_Peripheral_WriteRegister
+
+
+/*
+ * Definition of function that writes multiple consecutive device's registers.
+ * The parameters needed are:
+ * - adress of the device
+ * - adress of the first register we want to write
+ * - # registers we want to write
+ * - pointer to the data to be written
+*/
+uint8_t I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                          uint8_t register_address,
+                                          uint8_t register_count,
+                                          const uint8_t* data) {
+
+    // The bus must be free from queued transactions
+    I2C_Async_Flush();
+                                    
+    // Send start condition to the target device                                
+    uint8_t temp = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
+    
+    if (temp == I2C_Master_MSTR_NO_ERROR) {
+        // Communicate register's adress with the MSb equal to 1 to allow autoincrement
+        temp = I2C_Master_MasterWriteByte(register_address | 0x80);
+        
+        // Write as long as we have registers to write (and the slave acknowledges)
+        for(uint8_t i = 0; (i < register_count) && (temp == I2C_Master_MSTR_NO_ERROR); i++) {
+            temp = I2C_Master_MasterWriteByte(data[i]);
+        } // end write
+    }  // end start
+    
+    // Send stop condition
+    I2C_Master_MasterSendStop();
+    
+    return temp ? ERROR : NO_ERROR;
+
+} // end I2C_Peripheral_WriteRegisterMulti
+
+
+/*
+ * Definition of function that takes the next free slot of the queue.
+ * Returns the handle of the slot, I2C_ASYNC_INVALID if the queue is full
+*/
+static uint8_t I2C_Async_Enqueue(uint8_t device_address,
+                                 uint8_t register_address,
+                                 uint8_t register_count,
+                                 I2C_AsyncCallback callback) {
+    
+    // Slot still owned by a transaction (or by a handle not polled yet)
+    if(async_queue[async_tail].state != I2C_ASYNC_FREE) {
+        return I2C_ASYNC_INVALID;
+    }
+    
+    uint8_t handle = async_tail;
+    async_queue[handle].device_address = device_address;
+    async_queue[handle].register_count = register_count;
+    async_queue[handle].tx_buffer[0]   = register_address;
+    async_queue[handle].callback       = callback;
+    
+    async_tail = (async_tail+1) % I2C_ASYNC_QUEUE_SIZE;
+    
+    return handle;
+    
+} // end I2C_Async_Enqueue
+
+
+/*
+ * Definition of function that queues a read of multiple device's registers.
+ * The parameters needed are:
+ * - adress of the device
+ * - adress of the first register we want to read
+ * - # registers we want to read
+ * - pointer where to save the read data
+ * - function called at the end of the transaction (NULL to poll the handle instead)
+*/
+uint8_t I2C_Async_SubmitRead(uint8_t device_address,
+                             uint8_t register_address,
+                             uint8_t register_count,
+                             uint8_t* data,
+                             I2C_AsyncCallback callback) {
+    
+    if(register_count == 0) {
+        return I2C_ASYNC_INVALID;
+    }
+    
+    // MSb equal to 1 to allow autoincrement (as in I2C_Peripheral_ReadRegisterMulti)
+    if(register_count > 1) {
+        register_address |= 0x80;
+    }
+    
+    uint8_t handle = I2C_Async_Enqueue(device_address, register_address, register_count, callback);
+    
+    if(handle != I2C_ASYNC_INVALID) {
+        async_queue[handle].is_read = 1;
+        async_queue[handle].data    = data;
+        async_queue[handle].state   = I2C_ASYNC_QUEUED;
+    }
+    
+    return handle;
+    
+} // end I2C_Async_SubmitRead
+
+
+/*
+ * Definition of function that queues a write of multiple device's registers.
+ * The parameters needed are:
+ * - adress of the device
+ * - adress of the first register we want to write
+ * - # registers we want to write
+ * - data to be written
+ * - function called at the end of the transaction (NULL to poll the handle instead)
+*/
+uint8_t I2C_Async_SubmitWrite(uint8_t device_address,
+                              uint8_t register_address,
+                              uint8_t register_count,
+                              const uint8_t* data,
+                              I2C_AsyncCallback callback) {
+    
+    if((register_count == 0) || (register_count > I2C_ASYNC_MAX_WRITE)) {
+        return I2C_ASYNC_INVALID;
+    }
+    
+    if(register_count > 1) {
+        register_address |= 0x80;
+    }
+    
+    uint8_t handle = I2C_Async_Enqueue(device_address, register_address, register_count, callback);
+    
+    if(handle != I2C_ASYNC_INVALID) {
+        // Register address and data go out in the same buffer
+        memcpy(&async_queue[handle].tx_buffer[1], data, register_count);
+        async_queue[handle].is_read = 0;
+        async_queue[handle].data    = NULL;
+        async_queue[handle].state   = I2C_ASYNC_QUEUED;
+    }
+    
+    return handle;
+    
+} // end I2C_Async_SubmitWrite
+
+
+/*
+ * Definition of function that returns the state of a transaction, releasing
+ * the handle once the transaction is over
+*/
+uint8_t I2C_Async_Poll(uint8_t handle) {
+    
+    if(handle >= I2C_ASYNC_QUEUE_SIZE) {
+        return I2C_ASYNC_FAILED;
+    }
+    
+    uint8_t state = async_queue[handle].state;
+    
+    if((state == I2C_ASYNC_DONE) || (state == I2C_ASYNC_FAILED)) {
+        async_queue[handle].state = I2C_ASYNC_FREE;
+    }
+    
+    return state;
+    
+} // end I2C_Async_Poll
+
+
+/*
+ * Definition of function that ends the transaction at the head of the queue:
+ * the callback is notified and the head moves to the next transaction.
+*/
+static void I2C_Async_Complete(void) {
+    
+    I2C_AsyncTransaction* transaction = &async_queue[async_head];
+    uint8_t handle = async_head;
+    
+    async_head = (async_head+1) % I2C_ASYNC_QUEUE_SIZE;
+    
+    if(transaction->callback != NULL) {
+        uint8_t result = (transaction->state == I2C_ASYNC_DONE) ? NO_ERROR : ERROR;
+        transaction->state = I2C_ASYNC_FREE;
+        transaction->callback(handle, result);
+    }
+    
+} // end I2C_Async_Complete
+
+
+/*
+ * Definition of function that advances the transaction at the head of the queue.
+ * The byte transfers are carried out by the I2C_Master interrupt through the
+ * MasterWriteBuf/MasterReadBuf APIs: here we only check the completion status.
+ * A register read is a write of the register address without stop condition,
+ * followed by a read started with a restart condition.
+*/
+void I2C_Async_Process(void) {
+    
+    I2C_AsyncTransaction* transaction = &async_queue[async_head];
+    uint8_t status;
+    uint8_t error = NO_ERROR;
+    
+    switch(transaction->state) {
+        
+        case I2C_ASYNC_QUEUED:
+            I2C_Master_MasterClearStatus();
+            if(transaction->is_read) {
+                // Communicate register's address, keep the bus for the restart
+                error = I2C_Master_MasterWriteBuf(transaction->device_address,
+                                                  transaction->tx_buffer,
+                                                  1,
+                                                  I2C_Master_MODE_NO_STOP);
+                transaction->state = I2C_ASYNC_ADDRESSING;
+            }
+            else {
+                // Register's address followed by the data
+                error = I2C_Master_MasterWriteBuf(transaction->device_address,
+                                                  transaction->tx_buffer,
+                                                  1+transaction->register_count,
+                                                  I2C_Master_MODE_COMPLETE_XFER);
+                transaction->state = I2C_ASYNC_TRANSFERRING;
+            }
+            break;
+            
+        case I2C_ASYNC_ADDRESSING:
+            status = I2C_Master_MasterStatus();
+            if(status & I2C_Master_MSTAT_ERR_XFER) {
+                error = ERROR;
+            }
+            else if(status & I2C_Master_MSTAT_WR_CMPLT) {
+                I2C_Master_MasterClearStatus();
+                error = I2C_Master_MasterReadBuf(transaction->device_address,
+                                                 transaction->data,
+                                                 transaction->register_count,
+                                                 I2C_Master_MODE_REPEAT_START);
+                transaction->state = I2C_ASYNC_TRANSFERRING;
+            }
+            break;
+            
+        case I2C_ASYNC_TRANSFERRING:
+            status = I2C_Master_MasterStatus();
+            if(status & I2C_Master_MSTAT_ERR_XFER) {
+                error = ERROR;
+            }
+            else if(status & (transaction->is_read ? I2C_Master_MSTAT_RD_CMPLT : I2C_Master_MSTAT_WR_CMPLT)) {
+                transaction->state = I2C_ASYNC_DONE;
+            }
+            break;
+            
+        default:
+            // Nothing queued (or head waiting to be polled)
+            return;
+        
+    } // end switch(state)
+    
+    if(error != NO_ERROR) {
+        // Release the bus if the component left it in a halted state
+        if(I2C_Master_MasterStatus() & I2C_Master_MSTAT_XFER_HALT) {
+            I2C_Master_MasterSendStop();
+        }
+        transaction->state = I2C_ASYNC_FAILED;
+    }
+    
+    // Transaction over: notify and move to the next one
+    if((transaction->state == I2C_ASYNC_DONE) || (transaction->state == I2C_ASYNC_FAILED)) {
+        I2C_Async_Complete();
+    }
+    
+} // end I2C_Async_Process
+
+
+/*
+ * Definition of function that aborts the transaction at the head of the queue.
+ * A bus left halted (no stop condition yet) gets its stop condition; a transfer
+ * still in progress (device holding the bus, lost interrupt) is abandoned by
+ * stopping and restarting the component, which takes it back to idle.
+*/
+void I2C_Async_Abort(void) {
+    
+    I2C_AsyncTransaction* transaction = &async_queue[async_head];
+    
+    if((transaction->state != I2C_ASYNC_QUEUED) &&
+       (transaction->state != I2C_ASYNC_ADDRESSING) &&
+       (transaction->state != I2C_ASYNC_TRANSFERRING)) {
+        return;
+    }
+    
+    uint8_t status = I2C_Master_MasterStatus();
+    if(status & I2C_Master_MSTAT_XFER_INP) {
+        I2C_Master_Stop();
+        I2C_Master_Start();
+    }
+    else if(status & I2C_Master_MSTAT_XFER_HALT) {
+        I2C_Master_MasterSendStop();
+    }
+    I2C_Master_MasterClearStatus();
+    
+    transaction->state = I2C_ASYNC_FAILED;
+    I2C_Async_Complete();
+    
+} // end I2C_Async_Abort
+
+
+/*
+ * Definition of function that waits for all the queued transactions to end.
+ * The wait is counted in steps of I2C_ASYNC_FLUSH_STEP us (not with the SysTick,
+ * which may not be running): a transaction still in flight after I2C_ASYNC_TIMEOUT
+ * (device holding the bus, lost interrupt) is aborted so the queue can't get stuck.
+*/
+void I2C_Async_Flush(void) {
+    
+    uint8_t  index = async_head;
+    uint16_t steps = 0;
+    
+    // Serve until the head reaches a slot with nothing to do
+    while((async_queue[index].state == I2C_ASYNC_QUEUED) ||
+          (async_queue[index].state == I2C_ASYNC_ADDRESSING) ||
+          (async_queue[index].state == I2C_ASYNC_TRANSFERRING)) {
+        
+        I2C_Async_Process();
+        
+        // Head moved on: the next transaction gets the whole timeout
+        if(index != async_head) {
+            index = async_head;
+            steps = 0;
+            continue;
+        }
+        
+        if(++steps >= I2C_ASYNC_TIMEOUT/I2C_ASYNC_FLUSH_STEP) {
+            // Release the bus and drop the transaction
+            I2C_Async_Abort();
+            index = async_head;
+            steps = 0;
+            continue;
+        }
+        
+        CyDelayUs(I2C_ASYNC_FLUSH_STEP);
+    }
+    
+} // end I2C_Async_Flush
                                 
 
 /* [] END OF FILE */
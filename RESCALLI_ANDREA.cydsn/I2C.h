@@ -36,6 +36,35 @@
     #define ERROR    1
     #define NO_ERROR 0
     
+    // Asynchronous transactions
+    #define I2C_ASYNC_QUEUE_SIZE   4     // # transactions that can be queued
+    #define I2C_ASYNC_MAX_WRITE    8     // Max # data bytes of a queued write
+    #define I2C_ASYNC_INVALID      0xFF  // Handle returned when the queue is full
+    #define I2C_ASYNC_FLUSH_STEP   10    // [us] Wait between two checks of I2C_Async_Flush
+    #define I2C_ASYNC_TIMEOUT      50000 // [us] Max duration of a transaction (I2C_Async_Flush, main loop)
+                                         // (a 32 samples FIFO read takes ~18 ms at 100 kHz)
+    
+    #define I2C_ASYNC_FREE         0     // States of a queued transaction
+    #define I2C_ASYNC_QUEUED       1
+    #define I2C_ASYNC_ADDRESSING   2
+    #define I2C_ASYNC_TRANSFERRING 3
+    #define I2C_ASYNC_DONE         4
+    #define I2C_ASYNC_FAILED       5
+    
+    // Callback invoked when a transaction ends: handle and NO_ERROR/ERROR
+    typedef void (*I2C_AsyncCallback)(uint8_t handle, uint8_t error);
+    
+    // Queued transaction
+    typedef struct {
+        volatile uint8_t  state;
+        uint8_t           device_address;
+        uint8_t           is_read;
+        uint8_t           register_count;
+        uint8_t*          data;                             // Destination of a read
+        uint8_t           tx_buffer[1+I2C_ASYNC_MAX_WRITE]; // Register address (+ data of a write)
+        I2C_AsyncCallback callback;
+    } I2C_AsyncTransaction;
+    
     
     /*
      * Declaration of function that searches for connected devices on the I2C bus.
@@ -85,6 +114,94 @@
     uint8_t I2C_Peripheral_WriteRegister(uint8_t device_address,
                                          uint8_t register_address,
                                          uint8_t data);
+    
+    
+    /*
+     * Declaration of function that writes multiple consecutive device's registers
+     * in a single transaction through I2C protcol. The parameters needed are:
+     * - adress of the device
+     * - adress of the first register we want to write
+     * - # registers we want to write
+     * - pointer to the data to be written
+     *
+    */
+    uint8_t I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                              uint8_t register_address,
+                                              uint8_t register_count,
+                                              const uint8_t* data);
+    
+    
+    /*
+     * Declaration of function that queues a read of multiple device's registers
+     * without blocking the CPU. The parameters needed are:
+     * - adress of the device
+     * - adress of the first register we want to read
+     * - # registers we want to read
+     * - pointer where to save the read data (must stay valid until the end of the transaction)
+     * - function called at the end of the transaction (NULL to poll the handle instead)
+     * Returns the handle of the transaction, I2C_ASYNC_INVALID if the queue is full
+     * (or if no register is requested)
+     *
+    */
+    uint8_t I2C_Async_SubmitRead(uint8_t device_address,
+                                 uint8_t register_address,
+                                 uint8_t register_count,
+                                 uint8_t* data,
+                                 I2C_AsyncCallback callback);
+    
+    
+    /*
+     * Declaration of function that queues a write of multiple device's registers
+     * without blocking the CPU (data are copied, max I2C_ASYNC_MAX_WRITE bytes).
+     * The parameters needed are:
+     * - adress of the device
+     * - adress of the first register we want to write
+     * - # registers we want to write
+     * - data to be written
+     * - function called at the end of the transaction (NULL to poll the handle instead)
+     * Returns the handle of the transaction, I2C_ASYNC_INVALID if the queue is full
+     *
+    */
+    uint8_t I2C_Async_SubmitWrite(uint8_t device_address,
+                                  uint8_t register_address,
+                                  uint8_t register_count,
+                                  const uint8_t* data,
+                                  I2C_AsyncCallback callback);
+    
+    
+    /*
+     * Declaration of function that returns the state of a transaction submitted
+     * without callback. Once I2C_ASYNC_DONE or I2C_ASYNC_FAILED is returned the
+     * handle is released and must not be polled again.
+     *
+    */
+    uint8_t I2C_Async_Poll(uint8_t handle);
+    
+    
+    /*
+     * Declaration of function that advances the queued transactions. It never waits
+     * for the bus: it has to be called continuously from the main loop.
+     *
+    */
+    void I2C_Async_Process(void);
+    
+    
+    /*
+     * Declaration of function that aborts the transaction at the head of the queue
+     * (the one in flight): the bus is released, the transaction is marked
+     * I2C_ASYNC_FAILED and its callback notified. Nothing happens if the queue is idle.
+     *
+    */
+    void I2C_Async_Abort(void);
+    
+    
+    /*
+     * Declaration of function that waits for all the queued transactions to end.
+     * Called by the blocking functions, which cannot share the bus with a transaction in flight.
+     * A transaction lasting more than I2C_ASYNC_TIMEOUT is aborted and marked I2C_ASYNC_FAILED.
+     *
+    */
+    void I2C_Async_Flush(void);
      
 #endif
 
@@ -0,0 +1,160 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Idle.c
+ * \brief Source file including the functions of the low-power idle between samples
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Idle.h"
+
+#if IDLE_ENABLED
+
+#include "InterruptRoutines.h"
+#include "Transmit.h"
+#include "Utility.h"
+#include "project.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// Time spent at a frequency
+typedef struct {
+    uint32_t total_ms;    // [ms] Time spent at the frequency
+    uint64_t idle_cycles; // [SysTick counts, i.e. BUS_CLK cycles] Time spent waiting for interrupts
+    uint32_t samples;     // # samples read (before the decimation of "Filter.h")
+} IdleStats;
+
+
+// Useful variables
+static IdleStats idle_stats[LIS3DH_ODR_COUNT];
+static uint8_t   idle_odr_index   = 0; // Frequency being accounted
+static uint32_t  idle_start_ms    = 0; // [ms] Beginning of the accounting of the frequency
+static uint32_t  idle_start_samples = 0; // packet_read_samples at the beginning of the accounting
+static uint8_t   idle_polling     = 0; // STATUS_REG polled, SysTick wake-up
+
+static char      idle_message[80] = {'\0'};
+
+
+/*
+ * Definition of function that resets the statistics.
+ * As parameters it requires:
+ * - index of the entry of lis3dh_odr_table in use
+ * - 1 if STATUS_REG is polled (SysTick wake-up), 0 if an interrupt brings the data
+*/
+void Idle_Start(uint8_t odr_index, uint8_t polling) {
+    
+    memset(idle_stats, 0, sizeof(idle_stats));
+    
+    idle_polling     = polling;
+    idle_odr_index   = odr_index;
+    idle_start_ms    = ms_ticks;
+    idle_start_samples = packet_read_samples;
+    
+} // end Idle_Start
+
+
+/*
+ * Definition of function that moves the accounting to another frequency.
+ * As parameter it requires:
+ * - index of the new entry of lis3dh_odr_table
+*/
+void Idle_SetOdr(uint8_t odr_index) {
+    
+    // Close the current frequency
+    idle_stats[idle_odr_index].total_ms += ms_ticks - idle_start_ms;
+    idle_stats[idle_odr_index].samples  += packet_read_samples - idle_start_samples;
+    
+    idle_odr_index   = odr_index;
+    idle_start_ms    = ms_ticks;
+    idle_start_samples = packet_read_samples;
+    
+} // end Idle_SetOdr
+
+
+/*
+ * Definition of function that waits for the next interrupt and accounts the time
+*/
+void Idle_Sleep(void) {
+    
+    // SysTick counts down from the reload value, one count per BUS_CLK cycle, and
+    // its interrupt wakes the CPU up: it wraps at most once while waiting
+    uint32_t reload = CySysTickGetReload()+1;
+    uint32_t before = CySysTickGetValue();
+    
+    CY_PM_WFI;
+    
+    uint32_t after = CySysTickGetValue();
+    
+    idle_stats[idle_odr_index].idle_cycles += (after <= before) ? (before-after) : (before+reload-after);
+    
+} // end Idle_Sleep
+
+
+/*
+ * Definition of function that reports the duty cycle when requested via UART
+*/
+void Idle_Process(char command) {
+    
+    if(command != IDLE_REPORT_CMD) {
+        return;
+    }
+    
+    // Account what has been done so far at the current frequency
+    Idle_SetOdr(idle_odr_index);
+    
+    // One SysTick period is one ms
+    uint32_t cycles_per_us = (CySysTickGetReload()+1)/1000;
+    
+    // No data-ready or FIFO interrupt in polling mode: the duty includes the polls
+    if(idle_polling) {
+        snprintf(idle_message, sizeof(idle_message), "Wake: SysTick, STATUS_REG polled every %lu ms at %u Hz\r\n",
+                 (unsigned long)IDLE_POLL_INTERVAL(lis3dh_odr_table[idle_odr_index].period_us),
+                 lis3dh_odr_table[idle_odr_index].frequency);
+        Transmit_Frame((const uint8_t*)idle_message, strlen(idle_message));
+    }
+    
+    for(uint8_t index = 0; index < LIS3DH_ODR_COUNT; index++) {
+        
+        IdleStats* stats = &idle_stats[index];
+        if((stats->total_ms == 0) || (stats->samples == 0)) {
+            continue;
+        }
+        
+        uint64_t total_us  = (uint64_t)stats->total_ms*1000;
+        uint64_t idle_us   = stats->idle_cycles/cycles_per_us;
+        uint64_t active_us = (total_us > idle_us) ? total_us-idle_us : 0;
+        uint32_t duty      = (uint32_t)(active_us*1000/total_us); // [0.1%]
+        
+        snprintf(idle_message, sizeof(idle_message), "ODR %4u Hz: %lu samples, active %lu us/sample, duty %lu.%lu%%\r\n",
+                lis3dh_odr_table[index].frequency,
+                (unsigned long)stats->samples,
+                (unsigned long)(active_us/stats->samples),
+                (unsigned long)(duty/10), (unsigned long)(duty%10));
+        Transmit_Frame((const uint8_t*)idle_message, strlen(idle_message));
+        
+    } // end for(index)
+    
+} // end Idle_Process
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,109 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Idle.h
+ * \brief Header file including the functions of the low-power idle between samples
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __IDLE_H_
+    #define __IDLE_H_
+    
+    // Includes
+    #include "cytypes.h"
+    
+    
+    // Defines
+    /*
+     * 1 --> when the main loop has nothing to do the CPU waits for the next interrupt
+     *       (WFI: CPU clock gated, UART, I2C and EEPROM keep running, unlike in PSoC
+     *       Sleep mode where their clocks stop). Wake-up sources: ISR_DataReady,
+     *       ISR_Push, I2C_Master and the 1 ms SysTick.
+     *       In polling mode (ACQUISITION_POLLING of main.c) no LIS3DH interrupt is used:
+     *       the CPU is woken up by the SysTick and reads STATUS_REG every
+     *       IDLE_POLL_INTERVAL, i.e. IDLE_POLLS_PER_PERIOD times per period instead of
+     *       continuously. The FIFO mode is woken up by the SysTick too (one drain every
+     *       FIFO_DRAIN_PERIOD, no watermark interrupt): only the interrupt mode wakes up
+     *       on the data ready (INT1)
+    */
+    #ifndef IDLE_ENABLED
+        #define IDLE_ENABLED         0
+    #endif
+    
+    #define IDLE_POLLS_PER_PERIOD 4    // Polls per sample period (latency up to period/4)
+    #define IDLE_REPORT_CMD      'D'   // Character to be received via UART to report the duty cycle
+    
+    
+    #if IDLE_ENABLED
+        
+        /*
+         * Declaration of function that resets the statistics.
+         * As parameters it requires:
+         * - index of the entry of lis3dh_odr_table in use
+         * - 1 if STATUS_REG is polled (SysTick wake-up), 0 if an interrupt brings the data
+        */
+        void Idle_Start(uint8_t odr_index, uint8_t polling);
+        
+        
+        /*
+         * Declaration of function that moves the accounting to another frequency.
+         * As parameter it requires:
+         * - index of the new entry of lis3dh_odr_table
+        */
+        void Idle_SetOdr(uint8_t odr_index);
+        
+        
+        /*
+         * Declaration of function that waits for the next interrupt and accounts the time.
+         * It must be called with the interrupts disabled (CyGlobalIntDisable), right after
+         * having checked that there is nothing to do: an interrupt arriving in between
+         * still wakes the CPU up, and it is served once the interrupts are enabled again.
+        */
+        void Idle_Sleep(void);
+        
+        
+        /*
+         * Declaration of function that, when IDLE_REPORT_CMD is received via UART,
+         * queues one text line per frequency used, after the one stating how the CPU is
+         * woken up in polling mode (SysTick, STATUS_REG read every IDLE_POLL_INTERVAL):
+         * ODR, # samples read (before the decimation of "Filter.h"), CPU-active time per
+         * sample read [us], CPU-active share of the time [%]
+         * As parameter it requires:
+         * - character received via UART (0 if none)
+        */
+        void Idle_Process(char command);
+        
+        #define IDLE_START(odr_index, polling) Idle_Start(odr_index, polling)
+        #define IDLE_SET_ODR(odr_index)        Idle_SetOdr(odr_index)
+        #define IDLE_PROCESS(command)          Idle_Process(command)
+        #define IDLE_POLL_INTERVAL(period)     ((period)/(1000*IDLE_POLLS_PER_PERIOD)) // [ms] from the period [us]
+        
+    #else
+        
+        // Busy loop: no code at all, STATUS_REG polled continuously
+        #define IDLE_START(odr_index, polling)
+        #define IDLE_SET_ODR(odr_index)
+        #define IDLE_PROCESS(command)
+        #define IDLE_POLL_INTERVAL(period)     0
+        
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
@@ -25,6 +25,11 @@
 
 // Includes
 #include "InterruptRoutines.h"
+#include "project.h"
+
+// Cortex-M3 System Control Block
+#define SCB_ICSR_REG         0xE000ED04  // Interrupt Control and State register
+#define SCB_ICSR_PENDSTSET   0x04000000  // SysTick exception pending
 
 
 // Definition of ISR that informs whether the button has been pressed
@@ -44,4 +49,60 @@ CY_ISR(Custom_ISR_Push) {
 
 }
 
+
+// Definition of ISR that informs whether the LIS3DH has new data available
+// (data ready signal routed to the INT1 pin of the accelerometer)
+CY_ISR(Custom_ISR_DataReady) {
+
+    /* 
+     * No need to clear any interrupt source:
+     * interrupt component is configured for RISING_EDGE mode.
+     * INT1 stays high until the output registers are read, so the main code
+     * must read the axes every time this flag is set to get the next edge.
+    */
+    
+    // Time of the sample (see PACKET_TIMESTAMP) and flag that tells the main code
+    // new data are available
+    data_ready_us   = Custom_SysTick_Micros();
+    flag_data_ready = 1;
+
+}
+
+
+// Definition of SysTick callback that counts the milliseconds from startup
+void Custom_SysTick_Callback(void) {
+
+    // CySysTickStart configures the SysTick to interrupt every 1 ms
+    ms_ticks++;
+
+}
+
+
+// Definition of function that returns the microseconds from startup
+uint32_t Custom_SysTick_Micros(void) {
+
+    uint32_t reload = CySysTickGetReload()+1; // BUS_CLK cycles per ms
+    uint32_t ms;
+    uint32_t value;
+    uint32_t pending;
+    
+    // SysTick counts down: read again if the ms changed in between, or if the
+    // counter reloaded between the read of the value and the one of the pending bit
+    do {
+        ms      = ms_ticks;
+        value   = CySysTickGetValue();
+        pending = CY_GET_REG32(SCB_ICSR_REG) & SCB_ICSR_PENDSTSET;
+    } while((ms != ms_ticks) || (CySysTickGetValue() > value));
+    
+    // Called from an ISR or with the interrupts disabled, the SysTick may have
+    // reloaded without ms_ticks being incremented yet: that ms is not lost
+    // (more than one ms spent with the interrupts disabled is)
+    if(pending) {
+        ms++;
+    }
+    
+    return ms*1000 + (reload-1-value)*1000/reload;
+
+}
+
 /* [] END OF FILE */
@@ -28,12 +28,29 @@
     #include "cytypes.h"
     
     // Globals
-    volatile uint8_t flag_push; // Flag that informs whether the button has been pressed
+    volatile uint8_t flag_push;       // Flag that informs whether the button has been pressed
+    volatile uint8_t flag_data_ready; // Flag that informs whether the LIS3DH has new data
+    volatile uint32_t ms_ticks;       // Milliseconds from startup (SysTick)
+    volatile uint32_t data_ready_us;  // Microseconds from startup of the last data ready edge
     
     // Declaration of ISR that informs whether the button has been pressed
     // in order to update the sampling frequency for the accelerometer
     CY_ISR_PROTO(Custom_ISR_Push);
     
+    // Declaration of ISR that informs whether the LIS3DH has new data available
+    // (data ready signal routed to the INT1 pin of the accelerometer)
+    CY_ISR_PROTO(Custom_ISR_DataReady);
+    
+    // Declaration of SysTick callback that counts the milliseconds from startup
+    // (registered with CySysTickSetCallback after CySysTickStart)
+    void Custom_SysTick_Callback(void);
+    
+    // Declaration of function that returns the microseconds from startup
+    // (ms_ticks and the SysTick count within the current ms): wraps after ~71 minutes.
+    // Also correct from an ISR or with the interrupts disabled, as long as the SysTick
+    // interrupt has been pending for less than 1 ms
+    uint32_t Custom_SysTick_Micros(void);
+    
 #endif
 
 /* [] END OF FILE */
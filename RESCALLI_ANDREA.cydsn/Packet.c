@@ -0,0 +1,375 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Packet.c
+ * \brief Source file including the functions that build the packets sent via UART
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Packet.h"
+#include "Conversion.h"
+#include "Transmit.h"
+#include "Profiler.h"
+#include "Filter.h"
+#include "InterruptRoutines.h"
+#include "I2C.h"
+
+
+// Packet being filled for a sensor
+typedef struct {
+    uint8_t DataBuffer[TRANSMIT_BUFFER_SIZE]; // Buffer with XYZ data to be sent
+    uint8_t samples;                          // # samples already in the packet
+#if PACKET_TIMESTAMP
+    uint32_t time;                            // [us] First sample found ready
+#endif
+#if PACKET_ENCODING == PACKET_ENCODING_DELTA
+    uint8_t bytes;                            // # bytes of samples already in the packet
+    int16_t previous[AXES];                   // Last sample added (counts)
+#endif
+} PacketState;
+
+
+// Useful variables
+static PacketState packet_states[PACKET_MAX_SENSORS];
+
+static uint8_t packet_batch = 1; // # samples per packet
+
+uint32_t packet_raw_bytes  = 0;
+uint32_t packet_sent_bytes = 0;
+uint32_t packet_read_samples = 0;
+
+#if PACKET_INTEGRITY
+static uint8_t packet_sequence = 0; // Sequence number of the next packet
+
+// CRC-8 (polynomial x^8+x^2+x+1): one lookup per byte
+static const uint8_t crc8_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65, 0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2, 0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42, 0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C, 0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B, 0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+#endif
+
+
+/*
+ * Definition of function that fills header and tail of a packet and queues it.
+ * As parameters it requires:
+ * - pointer to the packet, payload already in place after PACKET_HEAD_BYTES
+ * - ID of the sensor
+ * - # samples
+ * - # bytes of the whole packet
+ * Returns NO_ERROR or ERROR (dropped, see Transmit_Frame)
+*/
+static uint8_t Packet_Queue(uint8_t* DataBuffer,
+                            uint8_t sensor,
+                            uint8_t samples,
+                            uint8_t length) {
+    
+    DataBuffer[0] = HEADER;
+#if PACKET_SENSOR_ID
+    DataBuffer[1] = sensor;
+#else
+    (void)sensor;
+#endif
+#if PACKET_BATCHING
+    DataBuffer[1+PACKET_SENSOR_ID] = samples;
+#else
+    (void)samples;
+#endif
+#if PACKET_INTEGRITY
+    DataBuffer[1+PACKET_SENSOR_ID+PACKET_BATCHING] = packet_sequence++;
+    
+    uint8_t crc = 0;
+    for(uint8_t i = 1; i < length-2; i++) {
+        crc = crc8_table[crc ^ DataBuffer[i]];
+    }
+    DataBuffer[length-2] = crc;
+#endif
+    DataBuffer[length-1] = TAIL;
+    
+    // Queue the packet (dropped and counted if the UART cannot keep up)
+    return Transmit_Frame(DataBuffer, length);
+    
+} // end Packet_Queue
+
+
+#if PACKET_TIMESTAMP
+
+/*
+ * Definition of function that writes the 24-bit time of a packet after the sequence number.
+ * As parameters it requires:
+ * - pointer to the packet
+ * - time [us]
+*/
+static void Packet_PutTime(uint8_t* DataBuffer, uint32_t time) {
+    
+    uint8_t* position = &DataBuffer[PACKET_HEAD_BYTES-PACKET_TIME_BYTES];
+    
+    position[0] = (uint8_t) (time & 0xFF);
+    position[1] = (uint8_t) ((time>>8) & 0xFF);
+    position[2] = (uint8_t) ((time>>16) & 0xFF);
+    
+} // end Packet_PutTime
+
+
+/*
+ * Definition of function that stores the time the first sample of a packet has been found ready.
+ * As parameters it requires:
+ * - index of the sensor
+ * - time [us]
+*/
+void Packet_Stamp(uint8_t sensor,
+                  uint32_t time) {
+    
+    if(packet_states[sensor].samples == 0) {
+        packet_states[sensor].time = time;
+    }
+    
+} // end Packet_Stamp
+
+#endif
+
+
+/*
+ * Definition of function that queues the packet of a sensor.
+ * As parameter it requires:
+ * - index of the sensor
+*/
+static void Packet_FlushSensor(uint8_t sensor) {
+    
+    PacketState* state = &packet_states[sensor];
+    
+    if(state->samples == 0) {
+        return;
+    }
+    
+#if PACKET_ENCODING == PACKET_ENCODING_DELTA
+    uint8_t length = PACKET_OVERHEAD + state->bytes;
+    state->bytes = 0;
+#else
+    uint8_t length = PACKET_OVERHEAD + PACKET_SAMPLES_BYTES(state->samples);
+#endif
+    
+#if PACKET_TIMESTAMP
+    Packet_PutTime(state->DataBuffer, state->time);
+#endif
+    
+    if(Packet_Queue(state->DataBuffer, sensor, state->samples, length) == NO_ERROR) {
+        packet_sent_bytes += length;
+    }
+    
+    state->samples = 0;
+    
+} // end Packet_FlushSensor
+
+
+/*
+ * Definition of function that sets the # samples per packet.
+ * As parameter it requires:
+ * - # samples per packet
+*/
+void Packet_SetBatch(uint8_t batch) {
+    
+    // Do not mix samples taken at different frequencies in the same packet
+    Packet_Flush();
+    
+    if(batch < 1) {
+        batch = 1;
+    }
+    if(batch > PACKET_MAX_BATCH) {
+        batch = PACKET_MAX_BATCH;
+    }
+    
+    packet_batch = PACKET_BATCH(batch);
+    
+} // end Packet_SetBatch
+
+
+/*
+ * Definition of function that encodes one raw XYZ sample and adds it
+ * to the packet of its sensor. As parameters it requires:
+ * - index of the sensor
+ * - pointer to the raw sample
+*/
+void Packet_AddSample(uint8_t sensor,
+                      const uint8_t* raw_data) {
+    
+    PROFILER_MARK();
+    
+    packet_read_samples++;
+    
+#if FILTER_ENABLED
+    // Filters between the read and the packing: decimated samples stop here
+    uint8_t filtered_data[BYTE_TO_SEND];
+    uint8_t ready = Filter_Process(sensor, raw_data, filtered_data);
+    PROFILER_STAGE(PROFILER_FILTER);
+    if(!ready) {
+        return;
+    }
+    raw_data = filtered_data;
+#endif
+    
+    PacketState* state = &packet_states[sensor];
+    uint8_t* DataBuffer = state->DataBuffer;
+    uint8_t packet_samples = state->samples;
+    
+#if PACKET_ENCODING == PACKET_ENCODING_RAW12
+    
+    // Samples come in couples of 9 bytes, the second one starts at half of the 5th byte
+    uint8_t* position = &DataBuffer[PACKET_HEAD_BYTES + 9*(packet_samples>>1)];
+    
+    // Right shift of 4 bit: data are left-justified, the 12-bit counts are enough
+    // (in normal and LP mode the lowest bits are 0)
+    uint64_t bits = 0;
+    for(uint8_t axis = 0; axis < AXES; axis++) {
+        uint16_t counts = (uint16_t)((int16_t)(raw_data[2*axis] | (raw_data[2*axis+1]<<8)) >> 4) & 0x0FFF;
+        bits |= (uint64_t)counts << (12*axis);
+    }
+    
+    if((packet_samples & 0x01) == 0) {
+        // First of the couple: 4 bytes and the low nibble of the 5th
+        position[0] = (uint8_t) bits;
+        position[1] = (uint8_t) (bits>>8);
+        position[2] = (uint8_t) (bits>>16);
+        position[3] = (uint8_t) (bits>>24);
+        position[4] = (uint8_t) (bits>>32);
+    }
+    else {
+        // Second of the couple: high nibble of the 5th byte and 4 bytes
+        position[4] |= (uint8_t) (bits<<4);
+        position[5]  = (uint8_t) (bits>>4);
+        position[6]  = (uint8_t) (bits>>12);
+        position[7]  = (uint8_t) (bits>>20);
+        position[8]  = (uint8_t) (bits>>28);
+    }
+    
+#elif PACKET_ENCODING == PACKET_ENCODING_DELTA
+    
+    uint8_t* position = &DataBuffer[PACKET_HEAD_BYTES + state->bytes];
+    
+    for(uint8_t axis = 0; axis < AXES; axis++) {
+        
+        // Right shift of 4 bit: data are left-justified, the 12-bit counts are enough
+        int16_t counts = (int16_t)(raw_data[2*axis] | (raw_data[2*axis+1]<<8)) >> 4;
+        
+        if(packet_samples == 0) {
+            // Keyframe
+            *position++ = (uint8_t) (counts & 0xFF);
+            *position++ = (uint8_t) (counts>>8);
+        }
+        else {
+            // Zig-zag: small differences of both signs become small unsigned values
+            int16_t  delta  = counts - state->previous[axis];
+            uint16_t zigzag = (uint16_t)((uint16_t)delta<<1) ^ (uint16_t)(delta>>15);
+            
+            while(zigzag >= 0x80) {
+                *position++ = (uint8_t) (zigzag | 0x80);
+                zigzag >>= 7;
+            }
+            *position++ = (uint8_t) zigzag;
+        }
+        
+        state->previous[axis] = counts;
+        
+    } // end for(axis)
+    
+    state->bytes = position - &DataBuffer[PACKET_HEAD_BYTES];
+    
+#else
+    
+    // Position of the sample in the packet (after header and # samples)
+    uint8_t* position = &DataBuffer[PACKET_HEAD_BYTES + packet_samples*BYTE_TO_SEND];
+    
+    // In HR mode (+-2g) one digit corresponds to one mg --> the value in mm/s^2 is
+    // digit*9.81, truncated: integer math only (see "Conversion.c"), the CPU has no FPU
+    for(uint8_t axis = 0; axis < AXES; axis++) {
+        int16_t OutAcc = (int16_t) Conversion_ToMilliMs2(&raw_data[2*axis]);
+        
+        position[2*axis]   = (uint8_t) (OutAcc & 0xFF);
+        position[2*axis+1] = (uint8_t) (OutAcc>>8);
+    }
+    
+#endif
+    state->samples = packet_samples+1;
+    packet_raw_bytes += BYTE_TO_SEND;
+    
+    PROFILER_STAGE(PROFILER_CONVERT);
+    
+    if(state->samples >= packet_batch) {
+        Packet_FlushSensor(sensor);
+        PROFILER_STAGE(PROFILER_TRANSMIT);
+    }
+    
+} // end Packet_AddSample
+
+
+/*
+ * Definition of function that queues the packets of all the sensors
+*/
+void Packet_Flush(void) {
+    
+    for(uint8_t sensor = 0; sensor < PACKET_MAX_SENSORS; sensor++) {
+        Packet_FlushSensor(sensor);
+    }
+    
+} // end Packet_Flush
+
+
+#if PACKET_ODR_MARKER
+
+/*
+ * Definition of function that queues the marker of a new frequency.
+ * As parameter it requires:
+ * - new frequency [Hz]
+*/
+void Packet_MarkOdr(uint16_t frequency) {
+    
+    uint8_t marker[PACKET_OVERHEAD+2];
+    
+    // The marker follows every sample taken at the previous frequency
+    Packet_Flush();
+    
+    marker[PACKET_HEAD_BYTES]   = (uint8_t) (frequency & 0xFF);
+    marker[PACKET_HEAD_BYTES+1] = (uint8_t) (frequency>>8);
+#if PACKET_TIMESTAMP
+    Packet_PutTime(marker, Custom_SysTick_Micros());
+#endif
+    
+    Packet_Queue(marker, PACKET_ALL_SENSORS, 0, sizeof(marker));
+    
+} // end Packet_MarkOdr
+
+#endif
+
+
+/* [] END OF FILE */
@@ -0,0 +1,228 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Packet.h
+ * \brief Header file including the functions that build the packets sent via UART
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __PACKET_H_
+    #define __PACKET_H_
+    
+    // Includes
+    #include "cytypes.h"
+    
+    
+    // Defines
+        // Macros for the packet of data to be sent via UART
+    #define HEADER               0xA0
+    #define TAIL                 0xC0
+    #define AXES                 3
+    #define BYTE_TO_SEND         2*AXES
+    
+    /*
+     * 0 --> one sample per packet: HEADER, X, Y, Z, TAIL (Bridge Control Panel format)
+     * 1 --> N consecutive samples per packet: HEADER, N, X0, Y0, Z0, ... X(N-1), Y(N-1), Z(N-1), TAIL
+     *       N depends on the operating frequency (see lis3dh_odr_table)
+    */
+    #ifndef PACKET_BATCHING
+        #define PACKET_BATCHING      0
+    #endif
+    #define PACKET_MAX_BATCH     16
+    
+    #if PACKET_BATCHING
+        #define PACKET_BATCH(batch)    (batch)
+    #else
+        #define PACKET_BATCH(batch)    1
+    #endif
+    
+    /*
+     * 1 --> the index of the LIS3DH the samples come from (see lis3dh_sensors) follows
+     *       the header: HEADER, ID, ... Every packet holds samples of one sensor only.
+     *       Needed to sample more than one LIS3DH on the bus
+     * 0 --> only the first LIS3DH found is sampled
+    */
+    #ifndef PACKET_SENSOR_ID
+        #define PACKET_SENSOR_ID     0
+    #endif
+    
+    #if PACKET_SENSOR_ID
+        #define PACKET_MAX_SENSORS     2   // LIS3DH at 0x18 and 0x19 (SA0)
+    #else
+        #define PACKET_MAX_SENSORS     1
+    #endif
+    
+    /*
+     * 1 --> a rolling sequence number (one per packet, also when the packet is dropped
+     *       because the UART cannot keep up) follows the header/# samples, and a CRC-8
+     *       (polynomial 0x07, initial value 0x00) of everything between the header and
+     *       the CRC itself precedes the tail:
+     *       HEADER, [ID], [N], SEQUENCE, samples, CRC, TAIL
+     *       The sequence number is shared by all the sensors
+    */
+    #ifndef PACKET_INTEGRITY
+        #define PACKET_INTEGRITY     0
+    #endif
+    
+    /*
+     * 1 --> every change of frequency (and the startup) is marked in the stream by a
+     *       packet with no samples, carrying the new frequency in Hz (uint16, LSB first):
+     *       HEADER, [ID], 0, [SEQUENCE], ODR, [CRC], TAIL
+     *       ID is PACKET_ALL_SENSORS. A recording can be indexed by frequency without
+     *       knowing when the button was pressed. Needs PACKET_BATCHING: N = 0 tells the
+     *       marker apart from a packet of samples. The packets are then no longer the
+     *       fixed-size ones of the Bridge Control Panel configuration: read the stream
+     *       with host/decoder (decode, capture) instead
+    */
+    #ifndef PACKET_ODR_MARKER
+        #define PACKET_ODR_MARKER    0
+    #endif
+    
+    #if PACKET_ODR_MARKER && !PACKET_BATCHING
+        #error "PACKET_ODR_MARKER needs PACKET_BATCHING"
+    #endif
+    
+    #define PACKET_ALL_SENSORS   0xFF  // ID of the packets that refer to every sensor
+    
+    /*
+     * 1 --> a timestamp follows the sequence number:
+     *       HEADER, [ID], [N], [SEQUENCE], TIME, samples, [CRC], TAIL
+     *       TIME = us from startup (see Custom_SysTick_Micros) at which the first sample of
+     *       the packet was found ready, 24 bits LSB first: wraps every 16.8 s. The receiver
+     *       rebuilds a 64-bit time adding (TIME - previous TIME) mod 2^24 of the same ID.
+     *       Found ready: ZYXDA seen (polling), INT1 edge (interrupt). FIFO: time of the
+     *       drain minus one period per sample drained after the first one of the packet.
+     *       Markers (PACKET_ODR_MARKER) carry the time they are queued
+    */
+    #ifndef PACKET_TIMESTAMP
+        #define PACKET_TIMESTAMP     0
+    #endif
+    #define PACKET_TIME_BYTES    3
+    
+    #define PACKET_HEAD_BYTES    (1+PACKET_SENSOR_ID+PACKET_BATCHING+PACKET_INTEGRITY+PACKET_TIMESTAMP*PACKET_TIME_BYTES) // Header, [ID], [# samples], [sequence], [time]
+    #define PACKET_TAIL_BYTES    (1+PACKET_INTEGRITY)                 // [CRC], tail
+    #define PACKET_OVERHEAD      (PACKET_HEAD_BYTES+PACKET_TAIL_BYTES)
+    
+    /*
+     * Encoding of the samples:
+     * MMS2  --> X, Y, Z as int16 in mm/s^2, LSB first (6 bytes per sample)
+     * RAW12 --> X, Y, Z as 12-bit two's complement counts (1 mg/digit at +-2g, whatever
+     *           the resolution): sample i takes bits [36*i, 36*i+35] of a little-endian
+     *           bit stream, X in the lowest 12 bits --> 2 samples every 9 bytes.
+     *           The conversion into m/s^2 (*9.81/1000) is left to the receiver
+     * DELTA --> same counts as RAW12. The first sample of the packet (keyframe) is sent as
+     *           3 int16, LSB first; the following ones as the difference from the previous
+     *           sample, per axis, zig-zag mapped ((d<<1)^(d>>15)) and written as a varint
+     *           (7 bits per byte, MSb set when another byte follows). A difference takes
+     *           1 byte up to +-63 and never more than 2, so a packet is never bigger than
+     *           with MMS2. Needs PACKET_BATCHING: every packet can be decoded on its own
+    */
+    #define PACKET_ENCODING_MMS2   0
+    #define PACKET_ENCODING_RAW12  1
+    #define PACKET_ENCODING_DELTA  2
+    #ifndef PACKET_ENCODING
+        #define PACKET_ENCODING        PACKET_ENCODING_MMS2
+    #endif
+    
+    #if PACKET_ENCODING == PACKET_ENCODING_RAW12
+        #define PACKET_SAMPLE_BITS       (12*AXES)
+        #define PACKET_SAMPLES_BYTES(n)  (((n)*PACKET_SAMPLE_BITS+7)/8)
+    #elif PACKET_ENCODING == PACKET_ENCODING_DELTA
+        #if !PACKET_BATCHING
+            #error "PACKET_ENCODING_DELTA needs PACKET_BATCHING"
+        #endif
+        #define PACKET_SAMPLES_BYTES(n)  ((n)*BYTE_TO_SEND) // Worst case
+    #else
+        #define PACKET_SAMPLES_BYTES(n)  ((n)*BYTE_TO_SEND)
+    #endif
+    
+    #define TRANSMIT_BUFFER_SIZE (PACKET_OVERHEAD+PACKET_SAMPLES_BYTES(PACKET_BATCH(PACKET_MAX_BATCH)))
+    
+        // UART bits needed by a packet of 'batch' samples (8N1 --> 10 bits per byte)
+    #define PACKET_BITS(batch)   ((PACKET_OVERHEAD+PACKET_SAMPLES_BYTES(PACKET_BATCH(batch)))*10)
+    
+    
+    /*
+     * Declaration of function that sets the # samples per packet (ignored if
+     * PACKET_BATCHING is 0). The samples already collected are sent first.
+     * As parameter it requires:
+     * - # samples per packet (1 ... PACKET_MAX_BATCH)
+    */
+    void Packet_SetBatch(uint8_t batch);
+    
+    
+    /*
+     * Declaration of function that encodes one raw XYZ sample (6 bytes, LSB first)
+     * and adds it to the packet of its sensor, which is queued for transmission
+     * when complete. As parameters it requires:
+     * - index of the sensor (0 ... PACKET_MAX_SENSORS-1)
+     * - pointer to the raw sample
+    */
+    void Packet_AddSample(uint8_t sensor,
+                          const uint8_t* raw_data);
+    
+    
+    /*
+     * Declaration of function that queues the packets of all the sensors even if
+     * they hold less samples than the batch
+    */
+    void Packet_Flush(void);
+    
+    
+    #if PACKET_TIMESTAMP
+        
+        /*
+         * Declaration of function that stores the time a sample has been found ready:
+         * kept only if the packet of the sensor is empty (first sample). As parameters
+         * it requires:
+         * - index of the sensor
+         * - time [us] (see Custom_SysTick_Micros)
+        */
+        void Packet_Stamp(uint8_t sensor,
+                          uint32_t time);
+        
+        #define PACKET_STAMP(sensor, time)  Packet_Stamp(sensor, time)
+        
+    #else
+        
+        #define PACKET_STAMP(sensor, time)
+        
+    #endif
+    
+    
+    #if PACKET_ODR_MARKER
+        
+        /*
+         * Declaration of function that queues the marker of a new frequency (see
+         * PACKET_ODR_MARKER). The samples already collected are sent first.
+         * As parameter it requires:
+         * - new frequency [Hz]
+        */
+        void Packet_MarkOdr(uint16_t frequency);
+        
+    #endif
+    
+    // Statistics of the encoding (compression ratio = packet_raw_bytes/packet_sent_bytes)
+    extern uint32_t packet_raw_bytes;  // Bytes the samples would take as 3 int16
+    extern uint32_t packet_sent_bytes; // Bytes of the packets actually queued
+    extern uint32_t packet_read_samples; // Samples given to Packet_AddSample (before the filters)
+    
+#endif
+
+/* [] END OF FILE */
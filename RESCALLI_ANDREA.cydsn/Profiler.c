@@ -0,0 +1,330 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Profiler.c
+ * \brief Source file including the cycle-count instrumentation of the acquisition loop
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Profiler.h"
+
+// Modules compiled only when enabled (this one, "Idle.c") include their header outside
+// the #if: its cytypes.h typedefs keep the unit non-empty, as ISO C requires
+#if PROFILER_ENABLED
+
+#include "Conversion.h"
+#include "I2C.h"
+#include "Transmit.h"
+#include "Utility.h"
+#include "project.h"
+#include <string.h>
+
+
+// Cortex-M3 debug registers
+#define DEMCR_REG            0xE000EDFC  // Debug Exception and Monitor Control register
+#define DEMCR_TRCENA         0x01000000  // Enables the DWT unit
+#define DWT_CTRL_REG         0xE0001000  // DWT control register
+#define DWT_CTRL_CYCCNTENA   0x00000001  // Enables the cycle counter
+#define DWT_CTRL_EVTENA      0x003E0000  // Enables CPICNT, EXCCNT, SLEEPCNT, LSUCNT, FOLDCNT
+#define DWT_CYCCNT_REG       0xE0001004  // Cycle counter
+#define DWT_CPICNT_REG       0xE0001008  // Extra cycles of multi-cycle instructions (8 bit)
+#define DWT_EXCCNT_REG       0xE000100C  // Cycles of exception entry and exit (8 bit)
+#define DWT_SLEEPCNT_REG     0xE0001010  // Cycles asleep (8 bit)
+#define DWT_LSUCNT_REG       0xE0001014  // Extra cycles of loads and stores (8 bit)
+#define DWT_FOLDCNT_REG      0xE0001018  // Instructions folded, executed in no cycle (8 bit)
+
+#define PROFILER_RECORD_SIZE (1+1+4*4+2*PROFILER_BUCKETS+1)
+
+
+// Statistics of a stage
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;  // Wraps after ~3 minutes at 24 MHz of a stage always running: dump before
+    uint32_t count;
+    uint16_t histogram[PROFILER_BUCKETS];
+} ProfilerStage;
+
+static ProfilerStage profiler_stages[PROFILER_STAGES];
+static uint32_t      profiler_mark = 0;
+
+static ProfilerStage   profiler_benches[PROFILER_BENCHES];
+static ProfilerStage   profiler_instructions[PROFILER_BENCHES];
+static volatile int32_t profiler_sink = 0; // Results of the benchmarks (not optimized away)
+
+
+/*
+ * Definition of function that enables the DWT cycle counter and resets the statistics
+*/
+void Profiler_Start(void) {
+    
+    CY_SET_REG32(DEMCR_REG, CY_GET_REG32(DEMCR_REG) | DEMCR_TRCENA);
+    CY_SET_REG32(DWT_CYCCNT_REG, 0);
+    CY_SET_REG32(DWT_CTRL_REG, CY_GET_REG32(DWT_CTRL_REG) | DWT_CTRL_CYCCNTENA | DWT_CTRL_EVTENA);
+    
+    memset(profiler_stages, 0, sizeof(profiler_stages));
+    for(uint8_t stage = 0; stage < PROFILER_STAGES; stage++) {
+        profiler_stages[stage].min = 0xFFFFFFFF;
+    }
+    
+    profiler_mark = CY_GET_REG32(DWT_CYCCNT_REG);
+    
+} // end Profiler_Start
+
+
+/*
+ * Definition of function that marks the beginning of the next stage
+*/
+void Profiler_Mark(void) {
+    
+    profiler_mark = CY_GET_REG32(DWT_CYCCNT_REG);
+    
+} // end Profiler_Mark
+
+
+/*
+ * Definition of function that adds a duration to the statistics.
+ * As parameters it requires:
+ * - pointer to the statistics
+ * - # cycles
+*/
+static void Profiler_Account(ProfilerStage* stats, uint32_t cycles) {
+    
+    if(cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if(cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->sum += cycles;
+    stats->count++;
+    
+    // Bucket = # significant bits of the duration (CLZ instruction)
+    uint8_t bucket = (cycles == 0) ? 0 : (32 - __builtin_clz(cycles));
+    if(bucket >= PROFILER_BUCKETS) {
+        bucket = PROFILER_BUCKETS-1;
+    }
+    if(stats->histogram[bucket] < 0xFFFF) {
+        stats->histogram[bucket]++;
+    }
+    
+} // end Profiler_Account
+
+
+/*
+ * Definition of function that accounts the cycles elapsed from the last mark to a stage.
+ * As parameter it requires:
+ * - stage
+*/
+void Profiler_Stage(uint8_t stage) {
+    
+    uint32_t now = CY_GET_REG32(DWT_CYCCNT_REG);
+    
+    // Unsigned difference handles the wrap around
+    Profiler_Account(&profiler_stages[stage], now - profiler_mark);
+    
+    // Do not account the profiler itself to the next stage
+    profiler_mark = CY_GET_REG32(DWT_CYCCNT_REG);
+    
+} // end Profiler_Stage
+
+
+/*
+ * Definition of function that writes a uint32 in a buffer, LSB first
+*/
+static uint8_t* Profiler_Put32(uint8_t* buffer, uint32_t value) {
+    
+    buffer[0] = (uint8_t) (value & 0xFF);
+    buffer[1] = (uint8_t) ((value>>8) & 0xFF);
+    buffer[2] = (uint8_t) ((value>>16) & 0xFF);
+    buffer[3] = (uint8_t) (value>>24);
+    
+    return buffer+4;
+    
+} // end Profiler_Put32
+
+
+/*
+ * Definition of function that queues the record of a stage or of a benchmark.
+ * As parameters it requires:
+ * - header of the record
+ * - index of the stage/benchmark
+ * - pointer to the statistics
+*/
+static void Profiler_Dump(uint8_t header, uint8_t index, const ProfilerStage* stats) {
+    
+    uint8_t record[PROFILER_RECORD_SIZE];
+    uint8_t* position = record;
+    
+    *position++ = header;
+    *position++ = index;
+    position = Profiler_Put32(position, stats->count ? stats->min : 0);
+    position = Profiler_Put32(position, stats->max);
+    position = Profiler_Put32(position, stats->count ? stats->sum/stats->count : 0);
+    position = Profiler_Put32(position, stats->count);
+    for(uint8_t bucket = 0; bucket < PROFILER_BUCKETS; bucket++) {
+        *position++ = (uint8_t) (stats->histogram[bucket] & 0xFF);
+        *position++ = (uint8_t) (stats->histogram[bucket]>>8);
+    }
+    *position = PROFILER_TAIL;
+    
+    // The records of 'B' take more than the ring buffer: wait for the UART to make room
+    // (the record is queued only once it fits, so it is never counted as dropped)
+    while(Transmit_Free() < PROFILER_RECORD_SIZE) {
+        Transmit_Process();
+    }
+    Transmit_Frame(record, PROFILER_RECORD_SIZE);
+    
+} // end Profiler_Dump
+
+
+/*
+ * Definition of function that returns the cycles the DWT event counters do not count
+ * as instructions, modulo 256: instructions = cycles - (CPI + EXC + SLEEP + LSU) + FOLD
+*/
+static uint8_t Profiler_EventCycles(void) {
+    
+    return (uint8_t) (CY_GET_REG32(DWT_CPICNT_REG) + CY_GET_REG32(DWT_EXCCNT_REG) +
+                      CY_GET_REG32(DWT_SLEEPCNT_REG) + CY_GET_REG32(DWT_LSUCNT_REG) -
+                      CY_GET_REG32(DWT_FOLDCNT_REG));
+    
+} // end Profiler_EventCycles
+
+
+/*
+ * Definition of function that runs one benchmark on a sample and accounts its cycles
+ * and instructions.
+ * As parameters it requires:
+ * - benchmark
+ * - pointer to the raw sample (6 bytes, LSB first)
+*/
+static void Profiler_Bench(uint8_t bench, const uint8_t* raw_data) {
+    
+    uint8_t registers[LIS3DH_CTRL_REGS];
+    int32_t result = 0;
+    
+    uint8_t  start_events = Profiler_EventCycles();
+    uint32_t start = CY_GET_REG32(DWT_CYCCNT_REG);
+    
+    switch(bench) {
+        
+        case PROFILER_BENCH_RECONSTRUCT:
+            for(uint8_t axis = 0; axis < AXES; axis++) {
+                result += (int16_t)(raw_data[2*axis] | (raw_data[2*axis+1]<<8)) >> 4;
+            }
+            break;
+            
+        case PROFILER_BENCH_FLOAT:
+            // As in the first version of the firmware: digit/1000.0*9.81, then *1000
+            for(uint8_t axis = 0; axis < AXES; axis++) {
+                int16_t counts = (int16_t)(raw_data[2*axis] | (raw_data[2*axis+1]<<8)) >> 4;
+                float   conv   = counts/1000.0*9.81;
+                result += (int16_t) (conv*1000);
+            }
+            break;
+            
+        case PROFILER_BENCH_INTEGER:
+            for(uint8_t axis = 0; axis < AXES; axis++) {
+                result += Conversion_ToMilliMs2(&raw_data[2*axis]);
+            }
+            break;
+            
+        case PROFILER_BENCH_READ:
+            result = I2C_Peripheral_ReadRegister(lis3dh_address, LIS3DH_CTRL_REG1, registers);
+            break;
+            
+        case PROFILER_BENCH_READ_MULTI:
+            result = I2C_Peripheral_ReadRegisterMulti(lis3dh_address, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REGS, registers);
+            break;
+            
+        default:
+            break;
+            
+    } // end switch(bench)
+    
+    uint32_t cycles = CY_GET_REG32(DWT_CYCCNT_REG) - start;
+    uint8_t  events = Profiler_EventCycles() - start_events;
+    
+    profiler_sink = result;
+    Profiler_Account(&profiler_benches[bench], cycles);
+    Profiler_Account(&profiler_instructions[bench], cycles - events);
+    
+} // end Profiler_Bench
+
+
+/*
+ * Definition of function that dumps the statistics or runs the benchmarks
+ * when requested via UART
+*/
+void Profiler_Process(char command) {
+    
+    if(command == PROFILER_DUMP_CMD) {
+        for(uint8_t stage = 0; stage < PROFILER_STAGES; stage++) {
+            Profiler_Dump(PROFILER_HEADER, stage, &profiler_stages[stage]);
+        }
+    }
+    
+    if(command == PROFILER_BENCH_CMD) {
+        
+        memset(profiler_benches, 0, sizeof(profiler_benches));
+        memset(profiler_instructions, 0, sizeof(profiler_instructions));
+        for(uint8_t bench = 0; bench < PROFILER_BENCHES; bench++) {
+            profiler_benches[bench].min      = 0xFFFFFFFF;
+            profiler_instructions[bench].min = 0xFFFFFFFF;
+        }
+        
+        // Same pseudo-random samples at every run (xorshift32): the results can be
+        // compared between builds
+        uint32_t seed = 0x2545F491;
+        uint8_t raw_data[BYTE_TO_SEND];
+        
+        for(uint16_t sample = 0; sample < PROFILER_BENCH_SAMPLES; sample++) {
+            
+            for(uint8_t i = 0; i < BYTE_TO_SEND; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                raw_data[i] = (uint8_t) seed;
+            }
+            
+            for(uint8_t bench = 0; bench < PROFILER_BENCHES; bench++) {
+                Profiler_Bench(bench, raw_data);
+            }
+            
+        } // end for(sample)
+        
+        for(uint8_t bench = 0; bench < PROFILER_BENCHES; bench++) {
+            Profiler_Dump(PROFILER_BENCH_HEADER, bench, &profiler_benches[bench]);
+        }
+        for(uint8_t bench = 0; bench < PROFILER_BENCHES; bench++) {
+            Profiler_Dump(PROFILER_INSTR_HEADER, bench, &profiler_instructions[bench]);
+        }
+        
+        // The benchmarks are not part of the stage that is running
+        profiler_mark = CY_GET_REG32(DWT_CYCCNT_REG);
+        
+    } // end if(benchmarks)
+    
+} // end Profiler_Process
+
+#endif
+
+/* [] END OF FILE */
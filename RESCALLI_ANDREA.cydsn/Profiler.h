@@ -0,0 +1,126 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Profiler.h
+ * \brief Header file including the cycle-count instrumentation of the acquisition loop
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __PROFILER_H_
+    #define __PROFILER_H_
+    
+    // Includes
+    #include "cytypes.h"
+    
+    
+    // Defines
+    #ifndef PROFILER_ENABLED
+        #ifdef NDEBUG
+            #define PROFILER_ENABLED 0 // Release configuration: no instrumentation
+        #else
+            #define PROFILER_ENABLED 1 // Debug configuration: instrumentation compiled in
+        #endif
+    #endif
+    
+        // Stages of the acquisition loop
+    #define PROFILER_STATUS      0     // STATUS_REG poll (or FIFO level read)
+    #define PROFILER_READ        1     // Axes burst read
+    #define PROFILER_CONVERT     2     // Conversion and packing
+    #define PROFILER_TRANSMIT    3     // Packet queued/sent via UART
+    #define PROFILER_FILTER      4     // Filters and decimation (see "Filter.h")
+    #define PROFILER_STORAGE     5     // Storage_Process: max = stall of the loop on an EEPROM commit
+    #define PROFILER_STAGES      6
+    
+    #define PROFILER_BUCKETS     24    // log2 histogram: bucket n counts durations in [2^(n-1), 2^n) cycles
+    #define PROFILER_DUMP_CMD    'P'   // Character to be received via UART to dump the statistics
+    #define PROFILER_HEADER      0xB0  // Header of the binary record of a stage
+    #define PROFILER_TAIL        0xC0  // Tail of the binary record of a stage
+    
+        // Benchmarks of the routines run on every sample (see Profiler_Process)
+    #define PROFILER_BENCH_EMPTY       0  // Nothing: cost of the measurement itself
+    #define PROFILER_BENCH_RECONSTRUCT 1  // Raw bytes --> 12-bit counts, 3 axes
+    #define PROFILER_BENCH_FLOAT       2  // Counts --> mm/s^2 in floating point, 3 axes (before "Conversion.c")
+    #define PROFILER_BENCH_INTEGER     3  // Conversion_ToMilliMs2, 3 axes
+    #define PROFILER_BENCH_READ        4  // I2C_Peripheral_ReadRegister (CTRL_REG1)
+    #define PROFILER_BENCH_READ_MULTI  5  // I2C_Peripheral_ReadRegisterMulti (CTRL_REG1 ... CTRL_REG6)
+    #define PROFILER_BENCHES           6
+    
+    #define PROFILER_BENCH_SAMPLES 256   // # runs of each benchmark
+    #define PROFILER_BENCH_CMD     'B'   // Character to be received via UART to run the benchmarks
+    #define PROFILER_BENCH_HEADER  0xB1  // Header of the binary record of a benchmark (cycles)
+    #define PROFILER_INSTR_HEADER  0xB2  // Header of the binary record of a benchmark (instructions)
+    
+    
+    #if PROFILER_ENABLED
+        
+        /*
+         * Declaration of function that enables the DWT cycle counter and resets the statistics
+        */
+        void Profiler_Start(void);
+        
+        
+        /*
+         * Declaration of function that stores the current cycle count
+         * as the beginning of the next stage
+        */
+        void Profiler_Mark(void);
+        
+        
+        /*
+         * Declaration of function that accounts the cycles elapsed from the last mark
+         * to a stage, and marks the beginning of the next one. As parameter it requires:
+         * - stage (PROFILER_STATUS ... PROFILER_STORAGE)
+        */
+        void Profiler_Stage(uint8_t stage);
+        
+        
+        /*
+         * Declaration of function that, when PROFILER_DUMP_CMD is received via UART,
+         * queues one binary record per stage:
+         * HEADER, stage, min, max, mean, count (uint32, LSB first), PROFILER_BUCKETS x uint16, TAIL
+         * When PROFILER_BENCH_CMD is received, runs every benchmark PROFILER_BENCH_SAMPLES
+         * times on pseudo-random samples (same sequence at every run) and queues one record
+         * per benchmark, same layout with PROFILER_BENCH_HEADER: cycles per sample, the
+         * PROFILER_BENCH_EMPTY ones included (subtract them). Then one record per benchmark
+         * with PROFILER_INSTR_HEADER: instructions per sample, from the DWT event counters
+         * (exact only while their extra cycles stay below 256 in a run: not the I2C benchmarks,
+         * that spin on the bus). The acquisition stops meanwhile
+         * As parameter it requires:
+         * - character received via UART (0 if none)
+        */
+        void Profiler_Process(char command);
+        
+        #define PROFILER_START()       Profiler_Start()
+        #define PROFILER_MARK()        Profiler_Mark()
+        #define PROFILER_STAGE(stage)  Profiler_Stage(stage)
+        #define PROFILER_PROCESS(command) Profiler_Process(command)
+        
+    #else
+        
+        // Release builds: no code at all
+        #define PROFILER_START()
+        #define PROFILER_MARK()
+        #define PROFILER_STAGE(stage)
+        #define PROFILER_PROCESS(command)
+        
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,194 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Storage.c
+ * \brief Source file including the functions that keep the LIS3DH settings in EEPROM
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Storage.h"
+#include "InterruptRoutines.h"
+#include "project.h"
+
+
+// Useful variables
+static uint8_t  storage_row     = 0; // Row of the newest record
+static uint8_t  storage_stored  = 0; // Value of the newest record
+static uint8_t  storage_value   = 0; // Value waiting to be written
+static uint8_t  storage_pending = 0; // A value is waiting to be written
+static uint8_t  storage_writing = 0; // The SPC is writing a row
+static uint32_t storage_request_time = 0; // [ms] Time of the last request
+
+static uint8_t  storage_record[STORAGE_RECORD_SIZE]; // Row being written
+
+uint16_t storage_commits  = 0;
+uint16_t storage_sequence = 0;
+
+
+/*
+ * Definition of function that computes the CRC-8 of a record
+ * (bitwise: it runs on 15 bytes per row, only at startup and once per write)
+*/
+static uint8_t Storage_Crc(const uint8_t* record) {
+    
+    uint8_t crc = 0;
+    
+    for(uint8_t i = 0; i < STORAGE_RECORD_CRC; i++) {
+        crc ^= record[i];
+        for(uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc<<1) ^ 0x07) : (uint8_t)(crc<<1);
+        }
+    }
+    
+    return crc;
+    
+} // end Storage_Crc
+
+
+/*
+ * Definition of function that looks for the newest valid record of the journal.
+ * As parameter it requires:
+ * - pointer to the variable where the stored CTRL_REG1 value is saved
+*/
+void Storage_Start(uint8_t* ctrl_reg1) {
+    
+    uint8_t found = 0;
+    
+    for(uint8_t row = STORAGE_FIRST_ROW; row < STORAGE_FIRST_ROW+STORAGE_JOURNAL_ROWS; row++) {
+        
+        for(uint8_t i = 0; i < STORAGE_RECORD_SIZE; i++) {
+            storage_record[i] = EEPROM_ReadByte(row*STORAGE_RECORD_SIZE + i);
+        }
+        
+        if((storage_record[STORAGE_RECORD_MAGIC] != STORAGE_MAGIC) ||
+           (storage_record[STORAGE_RECORD_CRC] != Storage_Crc(storage_record))) {
+            continue;
+        }
+        
+        uint16_t sequence = storage_record[STORAGE_RECORD_SEQ_L] | (storage_record[STORAGE_RECORD_SEQ_H]<<8);
+        
+        // Sequence numbers wrap around: compare the difference
+        if(!found || ((int16_t)(sequence - storage_sequence) > 0)) {
+            found            = 1;
+            storage_row      = row;
+            storage_sequence = sequence;
+            storage_stored   = storage_record[STORAGE_RECORD_CTRL_REG1];
+        }
+        
+    } // end for(row)
+    
+    if(!found) {
+        // Empty journal: keep the value of the previous firmware,
+        // the first record will go in the first row
+        storage_row      = STORAGE_FIRST_ROW+STORAGE_JOURNAL_ROWS-1;
+        storage_sequence = 0;
+        storage_stored   = EEPROM_ReadByte(STARTUP_REG);
+    }
+    
+    storage_value   = storage_stored;
+    storage_pending = 0;
+    storage_writing = 0;
+    
+    // The write timing depends on the die temperature: it changes slowly, so
+    // it is measured once here and not before every write (it blocks the CPU)
+    EEPROM_UpdateTemperature();
+    
+    *ctrl_reg1 = storage_stored;
+    
+} // end Storage_Start
+
+
+/*
+ * Definition of function that asks for a new CTRL_REG1 value to be stored.
+ * As parameter it requires:
+ * - value of CTRL_REG1
+*/
+void Storage_Request(uint8_t ctrl_reg1) {
+    
+    storage_value        = ctrl_reg1;
+    storage_pending      = 1;
+    storage_request_time = ms_ticks;
+    
+} // end Storage_Request
+
+
+/*
+ * Definition of function that writes the pending value once it is stable
+*/
+void Storage_Process(void) {
+    
+    if(storage_writing) {
+        
+        // The SPC takes a few ms per row: check back at the next call
+        cystatus status = EEPROM_Query();
+        if(status == CYRET_STARTED) {
+            return;
+        }
+        
+        storage_writing = 0;
+        
+        if(status == CYRET_SUCCESS) {
+            storage_stored = storage_record[STORAGE_RECORD_CTRL_REG1];
+            storage_commits++;
+        }
+        else if(!storage_pending) {
+            // Try again (in the next row): the torn one is discarded by the CRC
+            Storage_Request(storage_record[STORAGE_RECORD_CTRL_REG1]);
+        }
+        
+    } // end if(storage_writing)
+    
+    if(!storage_pending || ((uint32_t)(ms_ticks - storage_request_time) < STORAGE_COMMIT_DELAY)) {
+        return;
+    }
+    
+    // Back to the stored value (e.g. after a full cycle of presses): nothing to write
+    if(storage_value == storage_stored) {
+        storage_pending = 0;
+        return;
+    }
+    
+    uint8_t row = storage_row+1;
+    if(row >= STORAGE_FIRST_ROW+STORAGE_JOURNAL_ROWS) {
+        row = STORAGE_FIRST_ROW;
+    }
+    
+    for(uint8_t i = 0; i < STORAGE_RECORD_SIZE; i++) {
+        storage_record[i] = 0;
+    }
+    storage_record[STORAGE_RECORD_MAGIC]     = STORAGE_MAGIC;
+    storage_record[STORAGE_RECORD_SEQ_L]     = (uint8_t) ((storage_sequence+1) & 0xFF);
+    storage_record[STORAGE_RECORD_SEQ_H]     = (uint8_t) ((storage_sequence+1)>>8);
+    storage_record[STORAGE_RECORD_CTRL_REG1] = storage_value;
+    storage_record[STORAGE_RECORD_CRC]       = Storage_Crc(storage_record);
+    
+    // Non-blocking: the SPC erases and writes the row while the CPU goes on
+    if(EEPROM_StartWrite(storage_record, row) == CYRET_SUCCESS) {
+        storage_row = row;
+        storage_sequence++;
+        storage_pending = 0;
+        storage_writing = 1;
+    }
+    
+} // end Storage_Process
+
+
+/* [] END OF FILE */
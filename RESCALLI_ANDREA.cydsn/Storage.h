@@ -0,0 +1,97 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Storage.h
+ * \brief Header file including the functions that keep the LIS3DH settings in EEPROM
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ * 
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __STORAGE_H_
+    #define __STORAGE_H_
+    
+    // Includes
+    #include "cytypes.h"
+    
+    
+    // Defines
+        // EEPROM register where the frequency for the LIS3DH was stored by the previous
+        // firmware (one byte, rewritten in place at every button press): read only when
+        // the journal is empty
+    #define STARTUP_REG             0x0000
+    
+    /*
+     * The settings are written as a journal of 16-byte records, one per EEPROM row,
+     * each one in the row following the previous record (wrapping around at the end
+     * of the journal) so that the wear is spread over STORAGE_JOURNAL_ROWS rows.
+     * Record: MAGIC, SEQUENCE (LSB first), CTRL_REG1, 0x00 ... 0x00, CRC-8
+     * (polynomial 0x07, initial value 0x00, of the first 15 bytes).
+     * At startup the valid record with the highest sequence number wins: a record
+     * torn by a reset in the middle of the write fails the CRC and the previous
+     * one is used.
+    */
+    #define STORAGE_FIRST_ROW       1   // Row 0 holds STARTUP_REG
+    #define STORAGE_JOURNAL_ROWS    32  // 512 bytes --> 32x the endurance of a single cell
+    #define STORAGE_MAGIC           0x5A
+    
+    #define STORAGE_RECORD_MAGIC    0
+    #define STORAGE_RECORD_SEQ_L    1
+    #define STORAGE_RECORD_SEQ_H    2
+    #define STORAGE_RECORD_CTRL_REG1 3
+    #define STORAGE_RECORD_CRC      15
+    #define STORAGE_RECORD_SIZE     16  // One EEPROM row
+    
+        // A new value is written only after it has been stable for this long, so that
+        // a burst of button presses ends up in a single write
+    #define STORAGE_COMMIT_DELAY    2000 // [ms]
+    
+    
+    /*
+     * Declaration of function that looks for the newest valid record of the journal.
+     * EEPROM_Start() must have been called before. It also measures the die
+     * temperature for the writes (the only blocking EEPROM call, done once here).
+     * As parameter it requires:
+     * - pointer to the variable where the stored CTRL_REG1 value is saved
+     *   (the STARTUP_REG byte if the journal is empty)
+    */
+    void Storage_Start(uint8_t* ctrl_reg1);
+    
+    
+    /*
+     * Declaration of function that asks for a new CTRL_REG1 value to be stored.
+     * It never waits: the value is written by Storage_Process.
+     * As parameter it requires:
+     * - value of CTRL_REG1
+    */
+    void Storage_Request(uint8_t ctrl_reg1);
+    
+    
+    /*
+     * Declaration of function that writes the pending value once it is stable.
+     * It never waits: the row is written by the SPC in background while the
+     * loop keeps running, so it has to be called continuously from the main loop.
+    */
+    void Storage_Process(void);
+    
+    // Statistics of the journal
+    extern uint16_t storage_commits;  // # records written since startup
+    extern uint16_t storage_sequence; // Sequence number of the newest record
+    
+#endif
+
+/* [] END OF FILE */
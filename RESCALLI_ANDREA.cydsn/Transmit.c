@@ -0,0 +1,168 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Transmit.c
+ * \brief Source file including the functions of the UART transmission ring buffer
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ *
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+
+// Includes
+#include "Transmit.h"
+#include "I2C.h"
+#include "project.h"
+
+#if TX_USE_DMA && !defined(DMA_TX__DRQ_NUMBER)
+    #error "TX_USE_DMA needs a DMA component named DMA_TX in the TopDesign (see Transmit.h)"
+#endif
+
+// Ring buffer: bytes are written at head and sent from tail
+static uint8_t  tx_ring[TX_RING_SIZE];
+static uint16_t tx_head  = 0;
+static uint16_t tx_tail  = 0;
+static uint16_t tx_count = 0; // # bytes queued (including the ones the DMA is sending)
+
+uint16_t tx_high_water_mark = 0;
+uint16_t tx_dropped_frames  = 0;
+
+#if TX_USE_DMA
+    // DMA configuration: one byte per request, from SRAM to the UART TX FIFO
+    #define DMA_TX_BYTES_PER_BURST   1
+    #define DMA_TX_REQUEST_PER_BURST 1
+
+    static uint8_t  tx_channel   = 0;
+    static uint8_t  tx_td        = 0;
+    static uint16_t tx_in_flight = 0; // # bytes handed to the DMA
+#endif
+
+
+/*
+ * Definition of function that initializes the ring buffer (and the DMA channel)
+*/
+void Transmit_Start(void) {
+
+    tx_head  = 0;
+    tx_tail  = 0;
+    tx_count = 0;
+
+#if TX_USE_DMA
+    tx_channel = DMA_TX_DmaInitialize(DMA_TX_BYTES_PER_BURST,
+                                      DMA_TX_REQUEST_PER_BURST,
+                                      HI16(CYDEV_SRAM_BASE),
+                                      HI16(CYDEV_PERIPH_BASE));
+    tx_td        = CyDmaTdAllocate();
+    tx_in_flight = 0;
+#endif
+
+} // end Transmit_Start
+
+
+/*
+ * Definition of function that queues a frame to be sent via UART.
+ * The parameters needed are:
+ * - pointer to the frame
+ * - # bytes of the frame
+*/
+uint8_t Transmit_Frame(const uint8_t* frame,
+                       uint8_t length) {
+
+    // A frame is queued as a whole or not at all
+    if(tx_count + length > TX_RING_SIZE) {
+        tx_dropped_frames++;
+        return ERROR;
+    }
+
+    for(uint8_t i = 0; i < length; i++) {
+        tx_ring[tx_head] = frame[i];
+        tx_head = (tx_head+1) % TX_RING_SIZE;
+    }
+
+    // tx_count is also decreased by Transmit_Process, always from the main loop
+    tx_count += length;
+
+    if(tx_count > tx_high_water_mark) {
+        tx_high_water_mark = tx_count;
+    }
+
+    return NO_ERROR;
+
+} // end Transmit_Frame
+
+
+/*
+ * Definition of function that returns the # bytes the ring buffer can still take
+*/
+uint16_t Transmit_Free(void) {
+
+    return TX_RING_SIZE - tx_count;
+
+} // end Transmit_Free
+
+
+/*
+ * Definition of function that feeds the UART with the queued bytes
+*/
+void Transmit_Process(void) {
+
+#if TX_USE_DMA
+
+    uint8_t current_td = 0;
+    uint8_t state      = 0;
+
+    // Check whether the previous chunk has been sent
+    if(tx_in_flight > 0) {
+        CyDmaChStatus(tx_channel, &current_td, &state);
+        if(state & CY_DMA_STATUS_CHAIN_ACTIVE) {
+            return;
+        }
+        tx_tail   = (tx_tail+tx_in_flight) % TX_RING_SIZE;
+        tx_count -= tx_in_flight;
+        tx_in_flight = 0;
+    }
+
+    if(tx_count == 0) {
+        return;
+    }
+
+    // A single TD covers the contiguous bytes up to the end of the ring:
+    // the wrapped part goes out with the next chunk
+    tx_in_flight = (tx_tail + tx_count > TX_RING_SIZE) ? (TX_RING_SIZE - tx_tail) : tx_count;
+
+    CyDmaTdSetConfiguration(tx_td, tx_in_flight, CY_DMA_DISABLE_TD, CY_DMA_TD_INC_SRC_ADR);
+    // Only the lower 16 bits of the addresses go in the TD: the upper ones were given to DMA_TX_DmaInitialize
+    const uint8_t* source = &tx_ring[tx_tail];
+    CyDmaTdSetAddress(tx_td, LO16((uint32)source), LO16((uint32)UART_TXDATA_PTR));
+    CyDmaChSetInitialTd(tx_channel, tx_td);
+    CyDmaChEnable(tx_channel, 1);
+
+#else
+
+    // Fill the UART TX FIFO as long as there is room in it
+    while((tx_count > 0) && (UART_ReadTxStatus() & UART_TX_STS_FIFO_NOT_FULL)) {
+        UART_PutChar(tx_ring[tx_tail]);
+        tx_tail = (tx_tail+1) % TX_RING_SIZE;
+        tx_count--;
+    }
+
+#endif
+
+} // end Transmit_Process
+
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/* ========================================
+ *
+ * Copyright LTEBS srl, 2020
+ * All Rights Reserved
+ * UNPUBLISHED, LICENSED SOFTWARE.
+ *
+ * CONFIDENTIAL AND PROPRIETARY INFORMATION
+ * WHICH IS THE PROPERTY OF LTEBS srl.
+ *
+ * \file  Transmit.h
+ * \brief Header file including the functions of the UART transmission ring buffer
+ *
+ * I2C communication from PSoC (master) to a slave accelerometer (LIS3DH). Operating frequency
+ * of the device can be changed (and stored into EEPROM, from where will be loaded into the
+ * LIS3DH's register at startup) by using the on-board button of the PSoC.
+ * Data collected on the 3 axes will be sent via UART to the Bridge Panel Control in m/s^2
+ *
+ *
+ * \author: Andrea Rescalli
+ * \date:   14/11/2020
+ *
+ * ========================================
+*/
+
+#ifndef __TRANSMIT_H_
+    #define __TRANSMIT_H_
+
+    // Includes
+    #include "cytypes.h"
+
+
+    // Defines
+    #define TX_RING_SIZE    512  // Bytes of the ring buffer (frames waiting to be sent)
+
+    /*
+     * 0 --> the ring buffer is emptied by Transmit_Process, a few bytes at a time,
+     *       whenever there is room in the UART TX FIFO (the TopDesign as it is)
+     * 1 --> the ring buffer is emptied by the DMA_TX channel. The TopDesign has no
+     *       such component: a DMA named DMA_TX must be added first, its drq connected
+     *       to the tx_interrupt of the UART configured on "TX FIFO not full"
+    */
+    #define TX_USE_DMA      0
+
+    // Statistics of the ring buffer
+    extern uint16_t tx_high_water_mark; // Max # bytes queued in the ring buffer
+    extern uint16_t tx_dropped_frames;  // # frames discarded because the ring buffer was full
+
+
+    /*
+     * Declaration of function that initializes the ring buffer (and the DMA channel).
+     * UART_Start() must have been called before.
+     *
+    */
+    void Transmit_Start(void);
+
+
+    /*
+     * Declaration of function that queues a frame to be sent via UART.
+     * It never waits: if the ring buffer has no room for the whole frame, the frame
+     * is discarded (and counted). The parameters needed are:
+     * - pointer to the frame
+     * - # bytes of the frame
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+     *
+    */
+    uint8_t Transmit_Frame(const uint8_t* frame,
+                           uint8_t length);
+
+
+    /*
+     * Declaration of function that returns the # bytes the ring buffer can still take:
+     * a frame up to this length is queued by Transmit_Frame without being dropped.
+     *
+    */
+    uint16_t Transmit_Free(void);
+
+
+    /*
+     * Declaration of function that feeds the UART with the queued bytes.
+     * It never waits: it has to be called continuously from the main loop.
+     *
+    */
+    void Transmit_Process(void);
+
+#endif
+
+/* [] END OF FILE */
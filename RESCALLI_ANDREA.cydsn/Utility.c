@@ -27,47 +27,567 @@
 // Includes
 #include "Utility.h"
 #include "I2C.h"
+#include "Transmit.h"
 #include "project.h"
 #include <stdio.h>
+#include <string.h>
 
 
 // Useful variables
 char message[50] = {'\0'};
 
+LIS3DH_Sensor lis3dh_sensors[LIS3DH_MAX_SENSORS] = {{LIS3DH_DEVICE_ADDRESS, {0}, 0, 0}};
+uint8_t       lis3dh_sensor_count = 1;
+uint8_t       lis3dh_address      = LIS3DH_DEVICE_ADDRESS;
+
+static LIS3DH_Sensor* lis3dh_active = &lis3dh_sensors[0]; // Selected sensor
+
+uint16_t lis3dh_shadow_repairs = 0;
+
+static uint32_t fifo_drains[LIS3DH_FIFO_SIZE+1] = {0}; // [n] # drains that pulled n samples (every sensor)
+
+#define SHADOW_BIT(register_address)   (1ULL << ((register_address)-LIS3DH_SHADOW_FIRST))
+
+
+// Helper for the table: nominal period and needed bandwidths of a frequency
+#define ODR_ENTRY(ctrl_reg1, ctrl_reg4, resolution, batch, frequency_mhz)              \
+    { (ctrl_reg1), (ctrl_reg4), (resolution), (batch),                                 \
+      (uint16_t)(((frequency_mhz)+500)/1000),                                          \
+      (uint32_t)(1000000000ULL/(frequency_mhz)),                                       \
+      (uint32_t)(((uint64_t)(frequency_mhz)*PACKET_BITS(batch) + 1000*PACKET_BATCH(batch)-1) \
+                 / (1000*PACKET_BATCH(batch))),                                        \
+      (uint32_t)(((uint64_t)(frequency_mhz)*I2C_BITS_PER_SAMPLE+999)/1000) }
+
+/*
+ * Operating frequencies of the LIS3DH (datasheet table 31), in mHz.
+ * 1.6 kHz and 5.376 kHz are available only in Low Power mode (8-bit data).
+ * The batch keeps the packets around 50 per second when batching is enabled.
+*/
+const LIS3DH_OdrDescriptor lis3dh_odr_table[LIS3DH_ODR_COUNT] = {
+    ODR_ENTRY(LIS3DH_1_HZ_CTRL_REG1,       LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  1,    1000),
+    ODR_ENTRY(LIS3DH_10_HZ_CTRL_REG1,      LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  1,   10000),
+    ODR_ENTRY(LIS3DH_25_HZ_CTRL_REG1,      LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  1,   25000),
+    ODR_ENTRY(LIS3DH_50_HZ_CTRL_REG1,      LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  1,   50000),
+    ODR_ENTRY(LIS3DH_100_HZ_CTRL_REG1,     LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  2,  100000),
+    ODR_ENTRY(LIS3DH_200_HZ_CTRL_REG1,     LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  4,  200000),
+    ODR_ENTRY(LIS3DH_400_HZ_CTRL_REG1,     LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION,  8,  400000),
+    ODR_ENTRY(LIS3DH_1344_HZ_CTRL_REG1,    LIS3DH_HR_MODE_CTRL_REG4, CONVERSION_HIGH_RESOLUTION, 16, 1344000),
+    ODR_ENTRY(LIS3DH_1600_HZ_LP_CTRL_REG1, LIS3DH_LP_MODE_CTRL_REG4, CONVERSION_LOW_POWER,       16, 1600000),
+    ODR_ENTRY(LIS3DH_5376_HZ_LP_CTRL_REG1, LIS3DH_LP_MODE_CTRL_REG4, CONVERSION_LOW_POWER,       16, 5376000)
+};
+
+
+/*
+ * Definition of function that chooses the LIS3DH the following functions work on.
+ * As parameter it requires:
+ * - index of the sensor
+*/
+void LIS3DH_Select(uint8_t sensor) {
+    
+    lis3dh_active  = &lis3dh_sensors[sensor];
+    lis3dh_address = lis3dh_active->address;
+    
+} // end LIS3DH_Select
+
 
 /*
  * Definition of function that sets the operating frequency of the LIS3DH.
+ * As parameter it requires:
+ * - desired value to be written in the Control Register 1
+*/
+void SetOperatingFrequency(uint8_t desired_value) {
+    
+    // The shadow tells whether the register already holds the value: no read needed.
+    // This also ensures LPen bit is 0 (it's embedded in the desired_value)
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG1, desired_value);
+    
+    uint8_t error = LIS3DH_Shadow_Flush();
+    if(error == ERROR) {
+        UART_PutString("Error occurred during I2C communication.\r\n");
+    }
+    
+} // end SetOperatingFrequency
+
+
+/*
+ * Definition of function that updates a register in the shadow.
  * As parameters it requires:
- * - current value of the Control Register 1 (where the frequency is set)
- * - desired value to be written in the register
+ * - adress of the register
+ * - value of the register
 */
-void SetOperatingFrequency(uint8_t register_value, 
-                           uint8_t desired_value) {
+void LIS3DH_Shadow_Set(uint8_t register_address,
+                       uint8_t value) {
+    
+    if((register_address < LIS3DH_SHADOW_FIRST) || 
+       (register_address >= LIS3DH_SHADOW_FIRST+LIS3DH_SHADOW_SIZE) ||
+       !(LIS3DH_SHADOW_WRITABLE & SHADOW_BIT(register_address))) {
+        return;
+    }
+    
+    uint8_t index = register_address-LIS3DH_SHADOW_FIRST;
+    
+    // Already in the LIS3DH (or about to be): nothing to do
+    if((lis3dh_active->shadow_valid & SHADOW_BIT(register_address)) && (lis3dh_active->shadow[index] == value)) {
+        return;
+    }
+    
+    lis3dh_active->shadow[index] = value;
+    lis3dh_active->shadow_valid |= SHADOW_BIT(register_address);
+    lis3dh_active->shadow_dirty |= SHADOW_BIT(register_address);
     
-    // Read the register: we will update only if there is a different value in it
-    uint8_t error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                LIS3DH_CTRL_REG1,
-                                                &register_value);
+} // end LIS3DH_Shadow_Set
+
+
+/*
+ * Definition of function that returns the value of a register in the shadow
+*/
+uint8_t LIS3DH_Shadow_Get(uint8_t register_address) {
+    
+    if((register_address < LIS3DH_SHADOW_FIRST) || 
+       (register_address >= LIS3DH_SHADOW_FIRST+LIS3DH_SHADOW_SIZE)) {
+        return 0;
+    }
+    
+    return lis3dh_active->shadow[register_address-LIS3DH_SHADOW_FIRST];
+    
+} // end LIS3DH_Shadow_Get
+
+
+/*
+ * Definition of function that writes the changed registers to the LIS3DH
+*/
+uint8_t LIS3DH_Shadow_Flush(void) {
+    
+    uint8_t error = NO_ERROR;
+    uint8_t first = 0;
+    
+    while((lis3dh_active->shadow_dirty != 0) && (first < LIS3DH_SHADOW_SIZE) && (error == NO_ERROR)) {
+        
+        if(!(lis3dh_active->shadow_dirty & (1ULL << first))) {
+            first++;
+            continue;
+        }
+        
+        // Extend the write up to the last changed register that can be reached through
+        // writable registers of known content (rewritten with the same value): 
+        // one more byte costs much less than another transaction
+        uint8_t last = first;
+        for(uint8_t i = first+1; (i < LIS3DH_SHADOW_SIZE) && (lis3dh_active->shadow_valid & (1ULL << i)); i++) {
+            if(lis3dh_active->shadow_dirty & (1ULL << i)) {
+                last = i;
+            }
+        }
+        
+        if(first == last) {
+            error = I2C_Peripheral_WriteRegister(lis3dh_address,
+                                                 LIS3DH_SHADOW_FIRST+first,
+                                                 lis3dh_active->shadow[first]);
+        }
+        else {
+            error = I2C_Peripheral_WriteRegisterMulti(lis3dh_address,
+                                                      LIS3DH_SHADOW_FIRST+first,
+                                                      last-first+1,
+                                                      &lis3dh_active->shadow[first]);
+        }
+        
+        if(error == NO_ERROR) {
+            for(uint8_t i = first; i <= last; i++) {
+                lis3dh_active->shadow_dirty &= ~(1ULL << i);
+            }
+        }
+        
+        first = last+1;
+        
+    } // end while(dirty registers)
+    
+    return error;
+    
+} // end LIS3DH_Shadow_Flush
+
+
+/*
+ * Definition of function that loads the shadow with the content of the control registers
+*/
+uint8_t LIS3DH_Shadow_Sync(void) {
+    
+    // CTRL_REG0 ... REFERENCE in a single read
+    const uint8_t count = LIS3DH_CTRL_REG6-LIS3DH_SHADOW_FIRST+2;
+    
+    uint8_t error = I2C_Peripheral_ReadRegisterMulti(lis3dh_address,
+                                                     LIS3DH_SHADOW_FIRST,
+                                                     count,
+                                                     lis3dh_active->shadow);
     if(error == NO_ERROR) {
+        error = I2C_Peripheral_ReadRegister(lis3dh_address,
+                                            LIS3DH_FIFO_CTRL_REG,
+                                            &lis3dh_active->shadow[LIS3DH_FIFO_CTRL_REG-LIS3DH_SHADOW_FIRST]);
+    }
+    
+    if(error == NO_ERROR) {
+        for(uint8_t i = 0; i < count; i++) {
+            lis3dh_active->shadow_valid |= (1ULL << i);
+        }
+        lis3dh_active->shadow_valid |= SHADOW_BIT(LIS3DH_FIFO_CTRL_REG);
+        lis3dh_active->shadow_dirty  = 0;
+    }
+    
+    return error;
+    
+} // end LIS3DH_Shadow_Sync
+
+
+/*
+ * Definition of function that reads back the registers of known content
+ * and rewrites the ones that differ from the shadow
+*/
+uint8_t LIS3DH_Shadow_Verify(void) {
+    
+    uint8_t data[LIS3DH_SHADOW_SIZE];
+    uint8_t first = 0;
+    
+    // What has not been written yet would look different
+    uint8_t error = LIS3DH_Shadow_Flush();
+    
+    while((first < LIS3DH_SHADOW_SIZE) && (error == NO_ERROR)) {
         
-        if (register_value != desired_value) {
-            // Set the frequency by writing on the register the correct value
-            // This also ensures LPen bit is 0 (it's embedded in the desired_value)
-            register_value = desired_value;
-            error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                                 LIS3DH_CTRL_REG1,
-                                                 register_value);
-            if(error == ERROR) {
-                UART_PutString("Error occurred during I2C communication.\r\n");
+        if(!(lis3dh_active->shadow_valid & (1ULL << first))) {
+            first++;
+            continue;
+        }
+        
+        // One read per block of consecutive registers of known content
+        uint8_t last = first;
+        while((last+1 < LIS3DH_SHADOW_SIZE) && (lis3dh_active->shadow_valid & (1ULL << (last+1)))) {
+            last++;
+        }
+        
+        error = I2C_Peripheral_ReadRegisterMulti(lis3dh_address,
+                                                 LIS3DH_SHADOW_FIRST+first,
+                                                 last-first+1,
+                                                 &data[first]);
+        if(error == NO_ERROR) {
+            for(uint8_t i = first; i <= last; i++) {
+                if(data[i] != lis3dh_active->shadow[i]) {
+                    lis3dh_active->shadow_dirty |= (1ULL << i);
+                    lis3dh_shadow_repairs++;
+                }
             }
-        } // end write
+        }
         
-    } // end if(read is ok)
-    else {
+        first = last+1;
+        
+    } // end while(registers)
+    
+    if(error == NO_ERROR) {
+        error = LIS3DH_Shadow_Flush();
+    }
+    
+    return error;
+    
+} // end LIS3DH_Shadow_Verify
+
+
+/*
+ * Definition of function that checks whether an operating frequency can be
+ * sustained by the configured UART baud rate and I2C bus speed
+*/
+uint8_t LIS3DH_ODR_IsSustainable(uint8_t index) {
+    
+    if(index >= LIS3DH_ODR_COUNT) {
+        return 0;
+    }
+    
+    // The sensors share the UART and the bus: the aggregate rate is what counts
+    return (lis3dh_odr_table[index].link_bps*lis3dh_sensor_count <= UART_BAUD_RATE) && 
+           (lis3dh_odr_table[index].bus_bps*lis3dh_sensor_count  <= I2C_BUS_SPEED);
+    
+} // end LIS3DH_ODR_IsSustainable
+
+
+/*
+ * Definition of function that looks for the entry matching a CONTROL REGISTER 1 value
+*/
+uint8_t LIS3DH_ODR_Find(uint8_t ctrl_reg1) {
+    
+    for(uint8_t index = 0; index < LIS3DH_ODR_COUNT; index++) {
+        if(lis3dh_odr_table[index].ctrl_reg1 == ctrl_reg1) {
+            return LIS3DH_ODR_IsSustainable(index) ? index : LIS3DH_ODR_INVALID;
+        }
+    }
+    
+    return LIS3DH_ODR_INVALID;
+    
+} // end LIS3DH_ODR_Find
+
+
+/*
+ * Definition of function that returns the next sustainable entry of the table
+*/
+uint8_t LIS3DH_ODR_Next(uint8_t index) {
+    
+    // The first entry (1 Hz) is always sustainable, so the loop ends
+    do {
+        index = (index+1 < LIS3DH_ODR_COUNT) ? index+1 : 0;
+    } while(!LIS3DH_ODR_IsSustainable(index) && (index != 0));
+    
+    return index;
+    
+} // end LIS3DH_ODR_Next
+
+
+/*
+ * Definition of function that sets the LIS3DH to an operating frequency.
+ * As parameter it requires:
+ * - index of the new entry
+*/
+void LIS3DH_ODR_Apply(uint8_t index) {
+    
+    const LIS3DH_OdrDescriptor* odr = &lis3dh_odr_table[index];
+    
+    // Frequency (and LPen bit), and the HR bit that has to follow the LPen bit:
+    // only the registers that change are written, in a single transaction
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG1, odr->ctrl_reg1);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG4, odr->ctrl_reg4);
+    
+    uint8_t error = LIS3DH_Shadow_Flush();
+    if(error == ERROR) {
         UART_PutString("Error occurred during I2C communication.\r\n");
     }
     
-} // end SetOperatingFrequency
+    // Data are always read at +-2g
+    Conversion_SetMode(odr->resolution, CONVERSION_FS_2G);
+    
+} // end LIS3DH_ODR_Apply
+
+
+/*
+ * Definition of function that enables (Stream mode) or disables (Bypass mode)
+ * the FIFO of the LIS3DH.
+ * As parameter it requires:
+ * - 1 to enable the FIFO, 0 to disable it
+*/
+uint8_t LIS3DH_FIFO_Setup(uint8_t enable) {
+    
+    // Going through Bypass mode resets the FIFO content before (re)starting the Stream mode
+    LIS3DH_Shadow_Set(LIS3DH_FIFO_CTRL_REG, LIS3DH_BYPASS_FIFO_CTRL_REG);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG5, enable ? LIS3DH_FIFO_EN_CTRL_REG5 : LIS3DH_FIFO_DIS_CTRL_REG5);
+    uint8_t error = LIS3DH_Shadow_Flush();
+    
+    if((error == NO_ERROR) && enable) {
+        LIS3DH_Shadow_Set(LIS3DH_FIFO_CTRL_REG, LIS3DH_STREAM_FIFO_CTRL_REG);
+        error = LIS3DH_Shadow_Flush();
+    }
+    
+    if(error == ERROR) {
+        UART_PutString("Error occurred during I2C communication.\r\n");
+    }
+    
+    return error;
+    
+} // end LIS3DH_FIFO_Setup
+
+
+/*
+ * Definition of function that drains all the samples queued in the LIS3DH FIFO.
+ * As parameters it requires:
+ * - pointer where to save the read data
+ * - pointer where to save the # of samples that have been read
+*/
+uint8_t LIS3DH_FIFO_Drain(uint8_t* data,
+                          uint8_t* sample_count) {
+    
+    uint8_t fifo_src = 0;
+    *sample_count = 0;
+    
+    // Read the FIFO level
+    uint8_t error = I2C_Peripheral_ReadRegister(lis3dh_address,
+                                                LIS3DH_FIFO_SRC_REG,
+                                                &fifo_src);
+    if(error == NO_ERROR) {
+        
+        // FSS counts up to 31 unread samples: the overrun flag means the FIFO is full
+        uint8_t count = (fifo_src & LIS3DH_FIFO_OVRN_MASK) ? LIS3DH_FIFO_SIZE 
+                                                           : (fifo_src & LIS3DH_FIFO_FSS_MASK);
+        
+        if(count > 0) {
+            // With the FIFO enabled the auto-increment rolls back from OUT_Z_H to OUT_X_L,
+            // so all the queued samples come out of a single burst read
+            error = I2C_Peripheral_ReadRegisterMulti(lis3dh_address,
+                                                     LIS3DH_OUT_X_L,
+                                                     count*LIS3DH_BYTES_PER_SAMPLE,
+                                                     data);
+            if(error == NO_ERROR) {
+                *sample_count = count;
+            }
+        } // end burst read
+        
+        if(error == NO_ERROR) {
+            fifo_drains[count]++;
+        }
+        
+    } // end if(read is ok)
+    
+    return error;
+    
+} // end LIS3DH_FIFO_Drain
+
+
+/*
+ * Definition of function that looks for the LIS3DH at its two possible adresses
+*/
+uint8_t LIS3DH_Probe(void) {
+    
+    const uint8_t addresses[] = {LIS3DH_DEVICE_ADDRESS, LIS3DH_DEVICE_ADDRESS_SA0};
+    uint8_t who_am_i = 0;
+    uint8_t count    = 0;
+    
+    for(uint8_t i = 0; (i < sizeof(addresses)) && (count < LIS3DH_MAX_SENSORS); i++) {
+        
+        // A missing device does not acknowledge its adress: the read fails
+        uint8_t error = I2C_Peripheral_ReadRegister(addresses[i],
+                                                    LIS3DH_WHO_AM_I_REG,
+                                                    &who_am_i);
+        if((error == NO_ERROR) && (who_am_i == LIS3DH_WHO_AM_I)) {
+            // Nothing known about its registers yet
+            lis3dh_sensors[count].address      = addresses[i];
+            lis3dh_sensors[count].shadow_valid = 0;
+            lis3dh_sensors[count].shadow_dirty = 0;
+            count++;
+        }
+        
+    } // end for(addresses)
+    
+    if(count == 0) {
+        return ERROR;
+    }
+    
+    lis3dh_sensor_count = count;
+    LIS3DH_Select(0);
+    
+    return NO_ERROR;
+    
+} // end LIS3DH_Probe
+
+
+/*
+ * Definition of function that writes the whole set of control registers.
+ * As parameters it requires:
+ * - index of the entry of lis3dh_odr_table
+ * - 1 to enable the FIFO, 0 to disable it
+ * - 1 to route the data ready signal to INT1, 0 otherwise
+*/
+uint8_t LIS3DH_Configure(uint8_t index,
+                         uint8_t fifo,
+                         uint8_t data_ready) {
+    
+    const LIS3DH_OdrDescriptor* odr = &lis3dh_odr_table[index];
+    
+    // CTRL_REG2 (high-pass filter) and CTRL_REG6 (INT2) at their reset value:
+    // the first time all of them go out in a single write, then only the changed ones
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG1, odr->ctrl_reg1);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG2, 0x00);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG3, data_ready ? LIS3DH_I1_ZYXDA_CTRL_REG3 : LIS3DH_NO_INT_CTRL_REG3);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG4, odr->ctrl_reg4);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG5, fifo ? LIS3DH_FIFO_EN_CTRL_REG5 : LIS3DH_FIFO_DIS_CTRL_REG5);
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG6, 0x00);
+    
+    uint8_t error = LIS3DH_Shadow_Flush();
+    
+    // Going through Bypass mode resets the FIFO content before (re)starting the Stream mode
+    if((error == NO_ERROR) && fifo) {
+        LIS3DH_Shadow_Set(LIS3DH_FIFO_CTRL_REG, LIS3DH_BYPASS_FIFO_CTRL_REG);
+        error = LIS3DH_Shadow_Flush();
+        if(error == NO_ERROR) {
+            LIS3DH_Shadow_Set(LIS3DH_FIFO_CTRL_REG, LIS3DH_STREAM_FIFO_CTRL_REG);
+            error = LIS3DH_Shadow_Flush();
+        }
+    }
+    
+    // Data are always read at +-2g
+    Conversion_SetMode(odr->resolution, CONVERSION_FS_2G);
+    
+    return error;
+    
+} // end LIS3DH_Configure
+
+
+/*
+ * Definition of function that queues a line of text to be sent via UART
+*/
+static void LIS3DH_Print(void) {
+    
+    Transmit_Frame((const uint8_t*)message, strlen(message));
+    
+} // end LIS3DH_Print
+
+
+/*
+ * Definition of function that queues the diagnostic information as text lines.
+ * As parameter it requires:
+ * - [ms] time from startup to the first sample
+*/
+void LIS3DH_Diagnostic(uint32_t first_sample_ms) {
+    
+    uint8_t register_value = 0;
+    
+    // Scan the whole I2C bus
+    for(uint8_t i = 0; i < 128; i++) {
+        if(I2C_Peripheral_IsDeviceConnected(i)) {
+            sprintf(message, "CONNECTED DEVICE: 0x%02X\r\n", i);
+            LIS3DH_Print();
+        }
+    }
+    
+    // Main registers of every LIS3DH in use
+    const uint8_t registers[] = {LIS3DH_WHO_AM_I_REG, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG4};
+    for(uint8_t sensor = 0; sensor < lis3dh_sensor_count; sensor++) {
+        uint8_t address = lis3dh_sensors[sensor].address;
+        for(uint8_t i = 0; i < sizeof(registers); i++) {
+            if(I2C_Peripheral_ReadRegister(address, registers[i], &register_value) == NO_ERROR) {
+                sprintf(message, "0x%02X REGISTER 0x%02X: 0x%02X\r\n", address, registers[i], register_value);
+            }
+            else {
+                sprintf(message, "Error occurred during I2C communication.\r\n");
+            }
+            LIS3DH_Print();
+        }
+    } // end for(sensor)
+    
+    sprintf(message, "Time to first sample: %lu ms\r\n", (unsigned long)first_sample_ms);
+    LIS3DH_Print();
+    
+} // end LIS3DH_Diagnostic
+
+
+/*
+ * Definition of function that queues the statistics of the FIFO drains as text lines
+*/
+void LIS3DH_FIFO_Report(void) {
+    
+    uint32_t drains  = 0;
+    uint32_t samples = 0;
+    uint8_t  max     = 0;
+    for(uint8_t count = 0; count <= LIS3DH_FIFO_SIZE; count++) {
+        drains  += fifo_drains[count];
+        samples += fifo_drains[count]*count;
+        if(fifo_drains[count] > 0) {
+            max = count;
+        }
+    }
+    snprintf(message, sizeof(message), "FIFO: %lu drains, %lu samples, max %u\r\n",
+             (unsigned long)drains, (unsigned long)samples, max);
+    LIS3DH_Print();
+    
+    // Histogram: one line per size seen (32: full FIFO, samples overwritten)
+    for(uint8_t count = 0; count <= LIS3DH_FIFO_SIZE; count++) {
+        if(fifo_drains[count] > 0) {
+            snprintf(message, sizeof(message), "FIFO %2u samples: %lu drains\r\n",
+                     count, (unsigned long)fifo_drains[count]);
+            LIS3DH_Print();
+        }
+    }
+    
+} // end LIS3DH_FIFO_Report
                                               
 
 /* [] END OF FILE */
@@ -29,12 +29,21 @@
     
     // Includes
     #include "cytypes.h"
+    #include "Conversion.h"
+    #include "Packet.h"
     
     // Accelerometer macros
     #define LIS3DH_DEVICE_ADDRESS       0x18  // Adress of slave device (accelerometer)
+    #define LIS3DH_DEVICE_ADDRESS_SA0   0x19  // Adress of slave device with the SA0 pin high
     #define LIS3DH_WHO_AM_I_REG         0x0F  // WHO AM I register adress
+    #define LIS3DH_WHO_AM_I             0x33  // Content of the WHO AM I register
     #define LIS3DH_CTRL_REG1            0x20  // Control register 1 adress
+    #define LIS3DH_CTRL_REG2            0x21  // Control register 2 adress
+    #define LIS3DH_CTRL_REG3            0x22  // Control register 3 adress
     #define LIS3DH_CTRL_REG4            0x23  // Control register 4 adress
+    #define LIS3DH_CTRL_REG5            0x24  // Control register 5 adress
+    #define LIS3DH_CTRL_REG6            0x25  // Control register 6 adress
+    #define LIS3DH_CTRL_REGS            6     // # control registers (CTRL_REG1 ... CTRL_REG6)
     #define LIS3DH_STATUS_REG           0x27  // Status register adress
     #define LIS3DH_OUT_X_L              0x28  // X-axis output LSB register adress
     #define LIS3DH_OUT_X_H              0x29  // X-axis output MSB register adress
@@ -42,8 +51,11 @@
     #define LIS3DH_OUT_Y_H              0x2B  // Y-axis output MSB register adress
     #define LIS3DH_OUT_Z_L              0x2C  // Z-axis output LSB register adress
     #define LIS3DH_OUT_Z_H              0x2D  // Z-axis output MSB register adress
+    #define LIS3DH_FIFO_CTRL_REG        0x2E  // FIFO control register adress
+    #define LIS3DH_FIFO_SRC_REG         0x2F  // FIFO source register adress
 
     #define LIS3DH_HR_MODE_CTRL_REG4    0x88  // Set BDU and operating mode to HR
+    #define LIS3DH_LP_MODE_CTRL_REG4    0x80  // Set BDU, HR bit at 0 (needed by LP mode)
 
     #define LIS3DH_1_HZ_CTRL_REG1       0x17  // Set sampling frequency to 1 Hz
     #define LIS3DH_10_HZ_CTRL_REG1      0x27  // Set sampling frequency to 10 Hz
@@ -51,18 +63,269 @@
     #define LIS3DH_50_HZ_CTRL_REG1      0x47  // Set sampling frequency to 50 Hz
     #define LIS3DH_100_HZ_CTRL_REG1     0x57  // Set sampling frequency to 100 Hz
     #define LIS3DH_200_HZ_CTRL_REG1     0x67  // Set sampling frequency to 200 Hz
+    #define LIS3DH_400_HZ_CTRL_REG1     0x77  // Set sampling frequency to 400 Hz
+    #define LIS3DH_1344_HZ_CTRL_REG1    0x97  // Set sampling frequency to 1.344 kHz (HR/normal)
+    #define LIS3DH_1600_HZ_LP_CTRL_REG1 0x8F  // Set sampling frequency to 1.6 kHz (LP only, LPen at 1)
+    #define LIS3DH_5376_HZ_LP_CTRL_REG1 0x9F  // Set sampling frequency to 5.376 kHz (LP only, LPen at 1)
     
     #define LIS3DH_ZYXDA_MASK           0x08  // Mask for X, Y and Z-axis new data available
+    #define LIS3DH_ZYXOR_MASK           0x80  // Mask for X, Y and Z-axis data overrun (sample lost)
     
+    // Bandwidth macros (overridden only by the host simulator, see host/README.txt)
+    #ifndef UART_BAUD_RATE
+        #define UART_BAUD_RATE          19200   // Must match the UART component in TopDesign
+    #endif
+    #ifndef I2C_BUS_SPEED
+        #define I2C_BUS_SPEED           100000  // Must match the I2C_Master component in TopDesign
+    #endif
     
     /*
-     * Declaration of function that sets the operating frequency of the LIS3DH.
+     * 1 --> in polling mode STATUS_REG and the axes (0x27 ... 0x2D) come out of a single
+     *       7-byte auto-increment read, and the axes are discarded when ZYXDA is clear:
+     *       93 bits per sample instead of 123, but an empty poll costs 93 bits instead of 39
+     * 0 --> STATUS_REG first, then the axes only when ZYXDA is set
+    */
+    #ifndef LIS3DH_COMBINED_READ
+        #define LIS3DH_COMBINED_READ        0
+    #endif
+    
+    #if LIS3DH_COMBINED_READ
+        #define I2C_BITS_PER_SAMPLE     93      // 7-byte read (9 bits per byte + start/restart/stop)
+    #else
+        #define I2C_BITS_PER_SAMPLE     (39+84) // STATUS_REG read + 6-byte axes read (9 bits per byte + start/restart/stop)
+    #endif
+    
+    // Operating frequencies (ODR) 
+    #define LIS3DH_ODR_COUNT            10     // # entries of lis3dh_odr_table
+    #define LIS3DH_ODR_INVALID          0xFF   // Index returned when no entry matches
+    
+    
+    // Descriptor of an operating frequency of the LIS3DH
+    typedef struct {
+        uint8_t  ctrl_reg1;  // CONTROL REGISTER 1 value (ODR, LPen, XYZ enabled)
+        uint8_t  ctrl_reg4;  // CONTROL REGISTER 4 value (BDU, HR)
+        uint8_t  resolution; // Data resolution (see "Conversion.h")
+        uint8_t  batch;      // # samples per packet when batching is enabled (see "Packet.h")
+        uint16_t frequency;  // [Hz] Nominal frequency (rounded)
+        uint32_t period_us;  // [us] Nominal period
+        uint32_t link_bps;   // [bit/s] UART bandwidth needed to send every sample
+        uint32_t bus_bps;    // [bit/s] I2C bandwidth needed to read every sample
+    } LIS3DH_OdrDescriptor;
+    
+    // Table of all the operating frequencies, in increasing order
+    extern const LIS3DH_OdrDescriptor lis3dh_odr_table[LIS3DH_ODR_COUNT];
+    
+    // # registers found different from the shadow by LIS3DH_Shadow_Verify (and rewritten)
+    extern uint16_t lis3dh_shadow_repairs;
+    
+    #define LIS3DH_I1_ZYXDA_CTRL_REG3   0x10  // Route the data ready signal to INT1
+    #define LIS3DH_NO_INT_CTRL_REG3     0x00  // No interrupt routed to INT1
+    
+    #define LIS3DH_FIFO_EN_CTRL_REG5    0x40  // Enable the FIFO
+    #define LIS3DH_FIFO_DIS_CTRL_REG5   0x00  // Disable the FIFO
+    #define LIS3DH_STREAM_FIFO_CTRL_REG 0x80  // FIFO in Stream mode (oldest data overwritten)
+    #define LIS3DH_BYPASS_FIFO_CTRL_REG 0x00  // FIFO in Bypass mode
+    #define LIS3DH_FIFO_FSS_MASK        0x1F  // Mask for # of unread samples in the FIFO
+    #define LIS3DH_FIFO_OVRN_MASK       0x40  // Mask for FIFO overrun (FIFO completely filled)
+    #define LIS3DH_FIFO_SIZE            32    // # samples the FIFO can hold
+    #define LIS3DH_BYTES_PER_SAMPLE     6     // X, Y and Z-axis, 2 bytes each
+    
+    /*
+     * Shadow of the LIS3DH registers from CTRL_REG0 (0x1E) to ACT_DUR (0x3F):
+     * the writable ones are kept in RAM, so that a configuration change is decided
+     * without reading the device and the changed registers go out together
+     * Writable: 0x1E-0x26, 0x2E, 0x30, 0x32-0x34, 0x36-0x38, 0x3A-0x3F
+    */
+    #define LIS3DH_SHADOW_FIRST         0x1E
+    #define LIS3DH_SHADOW_SIZE          34
+    #define LIS3DH_SHADOW_WRITABLE      0x3F77501FFULL // Bit n --> register LIS3DH_SHADOW_FIRST+n
+    
+    #define LIS3DH_MAX_SENSORS          PACKET_MAX_SENSORS // See PACKET_SENSOR_ID in "Packet.h"
+    
+    
+    // Instance of a LIS3DH on the bus
+    typedef struct {
+        uint8_t  address;                    // Adress of the device
+        uint8_t  shadow[LIS3DH_SHADOW_SIZE]; // Shadow of the registers (see LIS3DH_SHADOW_FIRST)
+        uint64_t shadow_valid;               // Bit n --> content of shadow[n] known (written or read)
+        uint64_t shadow_dirty;               // Bit n --> shadow[n] not written to the LIS3DH yet
+    } LIS3DH_Sensor;
+    
+    /*
+     * LIS3DH found on the bus by LIS3DH_Probe (lis3dh_sensors[0] at LIS3DH_DEVICE_ADDRESS
+     * until then). The functions below work on the sensor chosen with LIS3DH_Select.
+     * All sensors share one ODR (odr_index of main.c): it is written to each one, and the
+     * conversion mode, the batch of "Packet.h" and the ODR markers of the stream (ID 0xFF)
+     * follow it for all of them. A sensor has its own shadow, not its own frequency
+    */
+    extern LIS3DH_Sensor lis3dh_sensors[LIS3DH_MAX_SENSORS];
+    extern uint8_t       lis3dh_sensor_count;
+    extern uint8_t       lis3dh_address;     // Adress of the selected sensor
+    
+    
+    /*
+     * Declaration of function that chooses the LIS3DH the following functions work on.
+     * As parameter it requires:
+     * - index of the sensor (0 ... lis3dh_sensor_count-1)
+    */
+    void LIS3DH_Select(uint8_t sensor);
+    
+    
+    /*
+     * Declaration of function that sets the operating frequency of the LIS3DH
+     * (written only if different from the shadow). As parameter it requires:
+     * - desired value to be written in the Control Register 1
+    */
+    void SetOperatingFrequency(uint8_t desired_value);
+    
+    
+    /*
+     * Declaration of function that updates a register in the shadow.
+     * Nothing is sent to the LIS3DH until LIS3DH_Shadow_Flush is called.
+     * As parameters it requires:
+     * - adress of the register (writable, see LIS3DH_SHADOW_WRITABLE)
+     * - value of the register
+    */
+    void LIS3DH_Shadow_Set(uint8_t register_address,
+                           uint8_t value);
+    
+    
+    /*
+     * Declaration of function that returns the value of a register in the shadow.
+     * As parameter it requires:
+     * - adress of the register
+    */
+    uint8_t LIS3DH_Shadow_Get(uint8_t register_address);
+    
+    
+    /*
+     * Declaration of function that writes the changed registers to the LIS3DH.
+     * Changed registers separated only by writable registers of known content
+     * go out in a single auto-increment write.
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_Shadow_Flush(void);
+    
+    
+    /*
+     * Declaration of function that loads the shadow with the content of the control
+     * registers (CTRL_REG0 ... REFERENCE and FIFO_CTRL_REG) read from the LIS3DH.
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_Shadow_Sync(void);
+    
+    
+    /*
+     * Declaration of function that reads back the registers of known content and
+     * rewrites the ones that differ from the shadow (e.g. the LIS3DH went through
+     * a brown-out reset and lost its configuration). On demand only: one read
+     * per block of consecutive registers.
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_Shadow_Verify(void);
+    
+    
+    /*
+     * Declaration of function that checks whether an operating frequency can be
+     * sustained by the configured UART baud rate and I2C bus speed, with all
+     * the lis3dh_sensor_count sensors sampled at that frequency.
+     * As parameter it requires:
+     * - index of the entry in lis3dh_odr_table
+     * Returns 1 if the frequency can be used, 0 otherwise
+    */
+    uint8_t LIS3DH_ODR_IsSustainable(uint8_t index);
+    
+    
+    /*
+     * Declaration of function that looks for the entry matching a CONTROL REGISTER 1 value
+     * (e.g. the one stored in EEPROM). As parameter it requires:
+     * - CONTROL REGISTER 1 value
+     * Returns the index of the entry, LIS3DH_ODR_INVALID if the value is unknown or
+     * cannot be sustained
+    */
+    uint8_t LIS3DH_ODR_Find(uint8_t ctrl_reg1);
+    
+    
+    /*
+     * Declaration of function that returns the next sustainable entry of the table,
+     * restarting from the first one after the last. As parameter it requires:
+     * - index of the current entry
+    */
+    uint8_t LIS3DH_ODR_Next(uint8_t index);
+    
+    
+    /*
+     * Declaration of function that sets the LIS3DH to an operating frequency
+     * (CONTROL REGISTER 1, CONTROL REGISTER 4 if the resolution changes, conversion constants):
+     * the registers that change are written in a single transaction.
+     * As parameter it requires:
+     * - index of the new entry
+    */
+    void LIS3DH_ODR_Apply(uint8_t index);
+    
+    
+    /*
+     * Declaration of function that enables (Stream mode) or disables (Bypass mode)
+     * the FIFO of the LIS3DH.
+     * As parameter it requires:
+     * - 1 to enable the FIFO, 0 to disable it
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_FIFO_Setup(uint8_t enable);
+    
+    
+    /*
+     * Declaration of function that drains all the samples queued in the LIS3DH FIFO
+     * with a single auto-increment read. As parameters it requires:
+     * - pointer where to save the read data (at least LIS3DH_FIFO_SIZE*LIS3DH_BYTES_PER_SAMPLE bytes)
+     * - pointer where to save the # of samples that have been read
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_FIFO_Drain(uint8_t* data,
+                              uint8_t* sample_count);
+    
+    
+    /*
+     * Declaration of function that queues, as text lines, the # of drains, samples and
+     * largest drain since startup, then the histogram of the samples pulled per drain
+     * (one line per size seen, every sensor together; 32 means the FIFO was full)
+    */
+    void LIS3DH_FIFO_Report(void);
+    
+    
+    /*
+     * Declaration of function that looks for the LIS3DH at its two possible adresses
+     * (LIS3DH_DEVICE_ADDRESS, LIS3DH_DEVICE_ADDRESS_SA0) by reading the WHO AM I
+     * register, instead of scanning the whole bus. The ones found (up to
+     * LIS3DH_MAX_SENSORS) fill lis3dh_sensors, the first one is selected.
+     * Returns NO_ERROR or ERROR (see "I2C.h") if no LIS3DH answers
+    */
+    uint8_t LIS3DH_Probe(void);
+    
+    
+    /*
+     * Declaration of function that writes the whole set of control registers
+     * (CTRL_REG1 ... CTRL_REG6) with a single auto-increment write, without
+     * reading them first, and starts the FIFO in Stream mode if requested.
      * As parameters it requires:
-     * - current value of the Control Register 1 (where the frequency is set)
-     * - desired value to be written in the register
+     * - index of the entry of lis3dh_odr_table
+     * - 1 to enable the FIFO, 0 to disable it
+     * - 1 to route the data ready signal to INT1, 0 otherwise
+     * Returns NO_ERROR or ERROR (see "I2C.h")
+    */
+    uint8_t LIS3DH_Configure(uint8_t index,
+                             uint8_t fifo,
+                             uint8_t data_ready);
+    
+    
+    /*
+     * Declaration of function that queues, as text lines, a full scan of the I2C bus,
+     * the content of the main registers of every LIS3DH and the time to the first sample.
+     * Diagnostic only: the scan keeps the CPU busy for some tens of ms.
+     * As parameter it requires:
+     * - [ms] time from startup to the first sample
     */
-    void SetOperatingFrequency(uint8_t register_value, 
-                               uint8_t desired_value);
+    void LIS3DH_Diagnostic(uint32_t first_sample_ms);
     
 #endif
 
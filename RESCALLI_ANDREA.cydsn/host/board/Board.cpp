@@ -0,0 +1,716 @@
+/* ========================================
+ *
+ * \file  Board.cpp
+ * \brief Model of the CY8CKIT-059 running the firmware on the host
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Board.h"
+
+#include "CyLib.h"
+#include "I2C_Master.h"
+#include "UART.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace board {
+
+namespace {
+
+// Core registers read by the firmware (see "InterruptRoutines.c", "Profiler.c")
+constexpr uint32_t kScbIcsr      = 0xE000ED04;
+constexpr uint32_t kPendStSet    = 0x04000000;
+constexpr uint32_t kDemcr        = 0xE000EDFC;
+constexpr uint32_t kDwtCtrl      = 0xE0001000;
+constexpr uint32_t kDwtCyccnt    = 0xE0001004;
+
+constexpr uint8_t  kFirstAddress = 0x18;
+
+} // namespace
+
+
+Board& Board::Get() {
+
+    static Board board;
+    return board;
+
+} // end Board::Get
+
+
+void Board::Configure(const Params& params) {
+
+    params_ = params;
+    sensors_.clear();
+    for(int i = 0; i < params.sensors; i++) {
+        sensors_.emplace_back(new Lis3dh((uint8_t)(kFirstAddress+i), params.odr_error_ppm));
+    }
+    i2c_nacks_.assign(params.i2c_nacks.begin(), params.i2c_nacks.end());
+    i2c_hangs_.assign(params.i2c_hangs.begin(), params.i2c_hangs.end());
+    std::sort(i2c_nacks_.begin(), i2c_nacks_.end());
+    std::sort(i2c_hangs_.begin(), i2c_hangs_.end());
+
+} // end Board::Configure
+
+
+void Board::PressButton(Cycles time) {
+
+    presses_.insert(std::upper_bound(presses_.begin(), presses_.end(), time), time);
+
+} // end Board::PressButton
+
+
+void Board::ReceiveChar(Cycles time, uint8_t character) {
+
+    auto position = std::upper_bound(uart_input_.begin(), uart_input_.end(), time,
+                                     [](Cycles t, const std::pair<Cycles, uint8_t>& input) {
+                                         return t < input.first;
+                                     });
+    uart_input_.insert(position, std::make_pair(time, character));
+
+} // end Board::ReceiveChar
+
+
+Counters Board::Snapshot() const {
+
+    Counters counters;
+    counters.time       = now_;
+    counters.i2c_busy   = i2c_busy_;
+    counters.uart_busy  = uart_busy_;
+    counters.sleep      = sleep_;
+    counters.uart_bytes = uart_output_.size();
+    counters.api_calls  = api_calls_;
+    counters.interrupts = interrupts_;
+    counters.max_loop   = max_loop_;
+    for(const auto& sensor : sensors_) {
+        const Lis3dh::Stats& stats = sensor->stats();
+        counters.sensors.generated   += stats.generated;
+        counters.sensors.read        += stats.read;
+        counters.sensors.overwritten += stats.overwritten;
+        counters.sensors.latency_sum += stats.latency_sum;
+        counters.sensors.latency_max  = std::max(counters.sensors.latency_max, stats.latency_max);
+        counters.sensors.int1_edges  += stats.int1_edges;
+    }
+    return counters;
+
+} // end Board::Snapshot
+
+
+/* ---------------------------------- */
+/*          TIME AND EVENTS           */
+/* ---------------------------------- */
+
+void Board::Charge() {
+
+    // The cost of the interrupt routines is not modelled
+    if(in_isr_) {
+        return;
+    }
+    api_calls_++;
+    RunUntil(now_ + params_.call_cycles);
+
+} // end Board::Charge
+
+
+void Board::Wait(Cycles cycles) {
+
+    if(in_isr_) {
+        return;
+    }
+    RunUntil(now_ + cycles);
+
+} // end Board::Wait
+
+
+// Moves the time forward, handling the events met on the way
+void Board::RunUntil(Cycles target) {
+
+    for(;;) {
+        Cycles next = NextEvent();
+        if(next > target) {
+            break;
+        }
+        now_ = next;
+        HandleEvents();
+    }
+    now_ = target;
+
+} // end Board::RunUntil
+
+
+Cycles Board::NextEvent() const {
+
+    Cycles next = params_.end;
+    if(systick_on_) {
+        next = std::min(next, next_tick_);
+    }
+    for(const auto& sensor : sensors_) {
+        next = std::min(next, sensor->NextSample());
+    }
+    if(!presses_.empty()) {
+        next = std::min(next, presses_.front());
+    }
+    if(transfer_.active && !transfer_.raised) {
+        next = std::min(next, transfer_.end);
+    }
+    return next;
+
+} // end Board::NextEvent
+
+
+void Board::HandleEvents() {
+
+    if(now_ >= params_.end) {
+        throw End();
+    }
+
+    if(systick_on_ && (now_ >= next_tick_)) {
+        next_tick_ += kCyclesPerMs;
+        Raise(kSysTick);
+    }
+
+    for(size_t index = 0; index < sensors_.size(); index++) {
+        while(sensors_[index]->NextSample() <= now_) {
+            // INT1 of the first sensor only is wired to ISR_DataReady
+            if(sensors_[index]->Produce(now_) && (index == 0)) {
+                Raise(kDataReady);
+            }
+        }
+    }
+
+    while(!presses_.empty() && (presses_.front() <= now_)) {
+        presses_.pop_front();
+        Raise(kPush);
+    }
+
+    if(transfer_.active && !transfer_.raised && (now_ >= transfer_.end)) {
+        transfer_.raised = true;
+        Raise(kI2c);
+    }
+
+} // end Board::HandleEvents
+
+
+/* ---------------------------------- */
+/*             INTERRUPTS             */
+/* ---------------------------------- */
+
+// Edge on an interrupt line: lost if the line is not enabled
+void Board::Raise(Line line) {
+
+    if(!(enabled_ & (1u << line))) {
+        return;
+    }
+    pending_ |= (1u << line);
+    woke_     = true;
+    Deliver();
+
+} // end Board::Raise
+
+
+void Board::Deliver() {
+
+    if(!global_enabled_ || in_isr_) {
+        return;
+    }
+    while(pending_ & enabled_) {
+        for(int line = 0; line < kLines; line++) {
+            if(pending_ & enabled_ & (1u << line)) {
+                pending_ &= ~(1u << line);
+                RunIsr((Line)line);
+                break;
+            }
+        }
+    }
+
+} // end Board::Deliver
+
+
+void Board::RunIsr(Line line) {
+
+    in_isr_ = true;
+    interrupts_++;
+
+    switch(line) {
+        case kSysTick:
+            for(Isr callback : systick_callbacks_) {
+                if(callback) {
+                    callback();
+                }
+            }
+            break;
+        case kI2c:
+            CompleteTransfer();
+            break;
+        default:
+            if(isr_[line]) {
+                isr_[line]();
+            }
+            break;
+    }
+
+    in_isr_ = false;
+
+} // end Board::RunIsr
+
+
+void Board::EnableInterrupts() {
+
+    global_enabled_ = true;
+    Deliver();
+
+} // end Board::EnableInterrupts
+
+
+void Board::DisableInterrupts() {
+
+    global_enabled_ = false;
+
+} // end Board::DisableInterrupts
+
+
+// WFI: wakes up as soon as an enabled interrupt is pending, even if PRIMASK masks it
+void Board::WaitForInterrupt() {
+
+    if(pending_ & enabled_) {
+        return;
+    }
+
+    woke_ = false;
+    while(!woke_) {
+        Cycles next = NextEvent();
+        sleep_ += next - now_;
+        now_    = next;
+        HandleEvents();
+    }
+
+} // end Board::WaitForInterrupt
+
+
+void Board::StartIsr(Line line, Isr isr) {
+
+    isr_[line] = isr;
+    pending_  &= ~(1u << line);
+    enabled_  |= (1u << line);
+
+} // end Board::StartIsr
+
+
+void Board::StopIsr(Line line) {
+
+    enabled_ &= ~(1u << line);
+
+} // end Board::StopIsr
+
+
+/* ---------------------------------- */
+/*         SYSTICK AND REGISTERS      */
+/* ---------------------------------- */
+
+void Board::SysTickStart() {
+
+    systick_on_    = true;
+    systick_start_ = now_;
+    next_tick_     = now_ + kCyclesPerMs;
+
+} // end Board::SysTickStart
+
+
+// Counts down from the reload value, one count per cycle
+uint32_t Board::SysTickValue() const {
+
+    if(!systick_on_) {
+        return 0;
+    }
+    return (uint32_t)(kCyclesPerMs - 1 - (now_ - systick_start_) % kCyclesPerMs);
+
+} // end Board::SysTickValue
+
+
+Isr Board::SetSysTickCallback(uint32_t number, Isr callback) {
+
+    if(number >= systick_callbacks_.size()) {
+        return nullptr;
+    }
+    Isr previous = systick_callbacks_[number];
+    systick_callbacks_[number] = callback;
+    return previous;
+
+} // end Board::SetSysTickCallback
+
+
+uint32_t Board::ReadRegister(uint32_t address) const {
+
+    switch(address) {
+        case kScbIcsr:
+            return (pending_ & (1u << kSysTick)) ? kPendStSet : 0;
+        case kDemcr:
+            return demcr_;
+        case kDwtCtrl:
+            return dwt_ctrl_;
+        case kDwtCyccnt:
+            return (uint32_t)(now_ - cyccnt_zero_);
+        default:
+            return 0;
+    }
+
+} // end Board::ReadRegister
+
+
+void Board::WriteRegister(uint32_t address, uint32_t value) {
+
+    switch(address) {
+        case kDemcr:
+            demcr_ = value;
+            break;
+        case kDwtCtrl:
+            dwt_ctrl_ = value;
+            break;
+        case kDwtCyccnt:
+            cyccnt_zero_ = now_ - value;
+            break;
+        default:
+            break;
+    }
+
+} // end Board::WriteRegister
+
+
+/* ---------------------------------- */
+/*                I2C                 */
+/* ---------------------------------- */
+
+Lis3dh* Board::Find(uint8_t address) {
+
+    for(const auto& sensor : sensors_) {
+        if(sensor->address() == address) {
+            return sensor.get();
+        }
+    }
+    return nullptr;
+
+} // end Board::Find
+
+
+void Board::BusTime(Cycles bits) {
+
+    Cycles cycles = bits*params_.i2c_bit_cycles;
+    i2c_busy_ += cycles;
+    RunUntil(now_ + cycles);
+
+} // end Board::BusTime
+
+
+void Board::SensorStop(Lis3dh* sensor) {
+
+    if(sensor->Stop(now_) && (sensor == sensors_[0].get())) {
+        Raise(kDataReady);
+    }
+
+} // end Board::SensorStop
+
+
+// Start or restart condition and address byte
+uint8_t Board::I2cStart(uint8_t address, bool read, bool restart) {
+
+    if(transfer_.active && !restart) {
+        return I2C_Master_MSTR_BUS_BUSY;
+    }
+
+    BusTime(1+9);
+
+    i2c_device_ = Find(address);
+    if(!i2c_device_) {
+        return I2C_Master_MSTR_ERR_LB_NAK;
+    }
+    i2c_device_->Start(now_, read);
+    return I2C_Master_MSTR_NO_ERROR;
+
+} // end Board::I2cStart
+
+
+uint8_t Board::I2cWriteByte(uint8_t byte) {
+
+    BusTime(9);
+
+    if(!i2c_device_) {
+        return I2C_Master_MSTR_ERR_LB_NAK;
+    }
+    i2c_device_->Write(now_, byte);
+    return I2C_Master_MSTR_NO_ERROR;
+
+} // end Board::I2cWriteByte
+
+
+uint8_t Board::I2cReadByte() {
+
+    BusTime(9);
+
+    return i2c_device_ ? i2c_device_->Read(now_) : 0xFF;
+
+} // end Board::I2cReadByte
+
+
+uint8_t Board::I2cStop() {
+
+    BusTime(1);
+
+    if(i2c_device_) {
+        Lis3dh* device = i2c_device_;
+        i2c_device_ = nullptr;
+        SensorStop(device);
+    }
+    i2c_status_ &= ~I2C_Master_MSTAT_XFER_HALT;
+    return I2C_Master_MSTR_NO_ERROR;
+
+} // end Board::I2cStop
+
+
+// MasterWriteBuf/MasterReadBuf: the bus is taken for the whole transfer, the data
+// move at its end (interrupt of the component)
+uint8_t Board::I2cTransfer(uint8_t address, uint8_t* data, uint8_t count, uint8_t mode, bool read) {
+
+    if(transfer_.active) {
+        return I2C_Master_MSTR_BUS_BUSY;
+    }
+
+    Cycles bits = (1+9) + 9*(Cycles)count + ((mode & I2C_Master_MODE_NO_STOP) ? 0 : 1);
+
+    transfer_.active  = true;
+    transfer_.raised  = false;
+    transfer_.read    = read;
+    transfer_.address = address;
+    transfer_.data    = data;
+    transfer_.count   = count;
+    transfer_.mode    = mode;
+    transfer_.end     = now_ + bits*params_.i2c_bit_cycles;
+    transfer_.nack    = false;
+
+    // Scripted faults
+    if(!i2c_nacks_.empty() && (i2c_nacks_.front() <= now_)) {
+        i2c_nacks_.pop_front();
+        transfer_.nack = true;
+    }
+    if(!i2c_hangs_.empty() && (i2c_hangs_.front() <= now_)) {
+        i2c_hangs_.pop_front();
+        transfer_.end = kNever;
+    }
+
+    i2c_busy_   += bits*params_.i2c_bit_cycles;
+    i2c_status_ |= I2C_Master_MSTAT_XFER_INP;
+
+    return I2C_Master_MSTR_NO_ERROR;
+
+} // end Board::I2cTransfer
+
+
+void Board::CompleteTransfer() {
+
+    Transfer transfer = transfer_;
+    transfer_.active  = false;
+    i2c_status_ &= ~(I2C_Master_MSTAT_XFER_INP | I2C_Master_MSTAT_XFER_HALT);
+
+    Lis3dh* device = transfer.nack ? nullptr : Find(transfer.address);
+    if(!device) {
+        i2c_status_ |= I2C_Master_MSTAT_ERR_ADDR_NAK | I2C_Master_MSTAT_ERR_XFER;
+        return;
+    }
+
+    device->Start(now_, transfer.read);
+    for(uint8_t i = 0; i < transfer.count; i++) {
+        if(transfer.read) {
+            transfer.data[i] = device->Read(now_);
+        }
+        else {
+            device->Write(now_, transfer.data[i]);
+        }
+    }
+
+    if(transfer.mode & I2C_Master_MODE_NO_STOP) {
+        i2c_status_ |= I2C_Master_MSTAT_XFER_HALT;
+    }
+    else {
+        SensorStop(device);
+    }
+    i2c_status_ |= transfer.read ? I2C_Master_MSTAT_RD_CMPLT : I2C_Master_MSTAT_WR_CMPLT;
+
+} // end Board::CompleteTransfer
+
+
+// The state of the bus (transfer in progress, halted) is not cleared
+uint8_t Board::I2cClearStatus() {
+
+    uint8_t status = i2c_status_;
+    i2c_status_ &= (I2C_Master_MSTAT_XFER_INP | I2C_Master_MSTAT_XFER_HALT);
+    return status;
+
+} // end Board::I2cClearStatus
+
+
+// The component goes back to idle: a transfer in progress is abandoned (no data moved)
+void Board::I2cReset() {
+
+    transfer_.active = false;
+    i2c_device_      = nullptr;
+    i2c_status_      = 0;
+
+} // end Board::I2cReset
+
+
+/* ---------------------------------- */
+/*                UART                */
+/* ---------------------------------- */
+
+// Bytes that left the TX FIFO for the shift register
+void Board::UartUpdate() {
+
+    while(!uart_fifo_.empty() && (uart_fifo_.front() <= now_)) {
+        uart_fifo_.pop_front();
+    }
+
+} // end Board::UartUpdate
+
+
+// UART_PutChar: waits for room in the TX FIFO
+void Board::UartPut(uint8_t byte) {
+
+    UartUpdate();
+    while(uart_fifo_.size() >= UART_TX_FIFO_SIZE) {
+        RunUntil(uart_fifo_.front());
+        UartUpdate();
+    }
+
+    Cycles start = std::max(now_, uart_line_free_);
+    uart_line_free_ = start + params_.uart_byte_cycles;
+    if(start > now_) {
+        uart_fifo_.push_back(start);
+    }
+    uart_busy_ += params_.uart_byte_cycles;
+    uart_output_.push_back(byte);
+
+} // end Board::UartPut
+
+
+uint8_t Board::UartTxStatus() {
+
+    UartUpdate();
+
+    uint8_t status = 0;
+    if(uart_fifo_.size() < UART_TX_FIFO_SIZE) {
+        status |= UART_TX_STS_FIFO_NOT_FULL;
+    }
+    else {
+        status |= UART_TX_STS_FIFO_FULL;
+    }
+    if(uart_fifo_.empty()) {
+        status |= UART_TX_STS_FIFO_EMPTY;
+    }
+    if(now_ >= uart_line_free_) {
+        status |= UART_TX_STS_COMPLETE;
+    }
+    return status;
+
+} // end Board::UartTxStatus
+
+
+// UART_GetChar: called once per iteration of the main loop, which is timed here
+uint8_t Board::UartGet() {
+
+    if(last_get_ && (now_ - last_get_ > max_loop_)) {
+        max_loop_ = now_ - last_get_;
+    }
+    last_get_ = now_;
+
+    if(uart_input_.empty() || (uart_input_.front().first > now_)) {
+        return 0;
+    }
+    uint8_t character = uart_input_.front().second;
+    uart_input_.pop_front();
+    return character;
+
+} // end Board::UartGet
+
+
+/* ---------------------------------- */
+/*               EEPROM               */
+/* ---------------------------------- */
+
+// Row written by StartWrite: the content changes at the end of the write
+void Board::EepromUpdate() {
+
+    if(eeprom_writing_ && (now_ >= eeprom_busy_until_)) {
+        std::copy(eeprom_row_.begin(), eeprom_row_.end(), eeprom_.begin()+eeprom_row_address_);
+        eeprom_writing_ = false;
+    }
+
+} // end Board::EepromUpdate
+
+
+uint8_t Board::EepromRead(uint16_t address) const {
+
+    return (address < eeprom_.size()) ? eeprom_[address] : 0;
+
+} // end Board::EepromRead
+
+
+// EEPROM_WriteByte/EEPROM_Write: temperature measurement and row write, the CPU waits
+uint32_t Board::EepromWrite(const uint8_t* data, uint16_t address, uint16_t size) {
+
+    EepromUpdate();
+    if(eeprom_writing_) {
+        return CYRET_LOCKED;
+    }
+    if(address + size > eeprom_.size()) {
+        return CYRET_BAD_PARAM;
+    }
+
+    Wait(params_.eeprom_temp_cycles + params_.eeprom_row_cycles);
+    std::memcpy(&eeprom_[address], data, size);
+    return CYRET_SUCCESS;
+
+} // end Board::EepromWrite
+
+
+uint32_t Board::EepromStartWrite(const uint8_t* row, uint8_t row_number) {
+
+    EepromUpdate();
+    if(eeprom_writing_) {
+        return CYRET_LOCKED;
+    }
+    if((row_number+1)*16u > eeprom_.size()) {
+        return CYRET_BAD_PARAM;
+    }
+
+    eeprom_row_.assign(row, row+16);
+    eeprom_row_address_ = (uint16_t)(row_number*16);
+    eeprom_busy_until_  = now_ + params_.eeprom_row_cycles;
+    eeprom_writing_     = true;
+    return CYRET_SUCCESS;
+
+} // end Board::EepromStartWrite
+
+
+uint32_t Board::EepromQuery() {
+
+    if(eeprom_writing_ && (now_ < eeprom_busy_until_)) {
+        return CYRET_STARTED;
+    }
+    EepromUpdate();
+    return CYRET_SUCCESS;
+
+} // end Board::EepromQuery
+
+
+uint32_t Board::EepromUpdateTemperature() {
+
+    Wait(params_.eeprom_temp_cycles);
+    return CYRET_SUCCESS;
+
+} // end Board::EepromUpdateTemperature
+
+} // namespace board
+
+/* [] END OF FILE */
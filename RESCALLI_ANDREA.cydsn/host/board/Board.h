@@ -0,0 +1,252 @@
+/* ========================================
+ *
+ * \file  Board.h
+ * \brief Model of the CY8CKIT-059 running the firmware on the host
+ *
+ * The PSoC APIs of "../psoc" act on a single Board (see "PsocApi.cpp"):
+ * - virtual time in BUS_CLK cycles (24 MHz). The C code of the firmware runs in
+ *   no time: every API call costs Params::call_cycles, busy waits (CyDelay, UART
+ *   FIFO full, blocking I2C and EEPROM operations) cost what the hardware takes
+ * - interrupts: SysTick (1 ms), button, LIS3DH INT1 (sensor 0), I2C_Master (end of
+ *   a MasterWriteBuf/MasterReadBuf transfer). They run when they happen, at an API
+ *   call, in no time; with the interrupts disabled they stay pending (SysTick: one
+ *   pending tick, PENDSTSET in SCB_ICSR). WFI sleeps until one is pending
+ * - I2C at 100 kHz: 9 bits per byte, 1 bit per start/restart/stop; LIS3DH models at
+ *   0x18 (and 0x19) behind it. Faults of the buffer transfers can be scripted: NACK of
+ *   the device, or a transfer that never ends (lost interrupt) until I2C_Master_Stop
+ * - UART 19200 8N1: 4-byte TX FIFO, bytes logged as they are put in it
+ * - EEPROM 2 KB: blocking writes, asynchronous StartWrite/Query
+ *
+ * ========================================
+*/
+
+#ifndef __BOARD_H_
+    #define __BOARD_H_
+
+    #include "Lis3dh.h"
+
+    #include <array>
+    #include <deque>
+    #include <memory>
+    #include <string>
+    #include <vector>
+
+    namespace board {
+
+    constexpr Cycles kBusClockHz     = 24000000;
+    constexpr Cycles kCyclesPerMs    = kBusClockHz/1000;
+    constexpr Cycles kCyclesPerUs    = kBusClockHz/1000000;
+
+    // Thrown by the board at Params::end: the simulation is over
+    struct End {
+    };
+
+    struct Params {
+        Cycles call_cycles        = 1*kCyclesPerUs;       // CPU time of a PSoC API call
+        Cycles i2c_bit_cycles     = kBusClockHz/100000;   // 100 kHz
+        Cycles uart_byte_cycles   = kBusClockHz*10/19200; // 19200 8N1
+        Cycles eeprom_row_cycles  = 2*kCyclesPerMs;       // Row erase + write (datasheet: 2 ms typ, 20 ms max)
+        Cycles eeprom_temp_cycles = 1*kCyclesPerMs;       // Die temperature measurement (assumed)
+        double odr_error_ppm      = 0;                    // LIS3DH clock error
+        int    sensors            = 1;                    // LIS3DH at 0x18 (1), and 0x19 (2)
+        std::vector<Cycles> i2c_nacks;                    // First buffer transfer after each: NACKed
+        std::vector<Cycles> i2c_hangs;                    // First buffer transfer after each: never ends
+        Cycles end                = 60*kBusClockHz;
+    };
+
+    // Cumulative counters: the difference of two snapshots covers the time between them
+    struct Counters {
+        Cycles   time        = 0;
+        Cycles   i2c_busy    = 0; // [cycles] Bus not idle
+        Cycles   uart_busy   = 0; // [cycles] TX line sending
+        Cycles   sleep       = 0; // [cycles] In WFI
+        uint64_t uart_bytes  = 0;
+        uint64_t api_calls   = 0;
+        uint64_t interrupts  = 0;
+        Lis3dh::Stats sensors;    // Sum of the sensors
+        Cycles   max_loop    = 0; // [cycles] Longest time between two UART_GetChar (since ResetMaxLoop)
+    };
+
+    // Interrupt lines
+    enum Line : int {
+        kSysTick = 0,
+        kPush,
+        kDataReady,
+        kI2c,
+        kLines
+    };
+
+    typedef void (*Isr)(void);
+
+    class Board {
+    public:
+
+        // The board the PSoC APIs act on
+        static Board& Get();
+
+        void Configure(const Params& params);
+        const Params& params() const {
+            return params_;
+        }
+
+        Lis3dh* Sensor(size_t index) {
+            return (index < sensors_.size()) ? sensors_[index].get() : nullptr;
+        }
+        size_t SensorCount() const {
+            return sensors_.size();
+        }
+
+        // Script: button presses and characters received via UART
+        void PressButton(Cycles time);
+        void ReceiveChar(Cycles time, uint8_t character);
+
+        std::vector<uint8_t>& Eeprom() {
+            return eeprom_;
+        }
+        const std::vector<uint8_t>& UartOutput() const {
+            return uart_output_;
+        }
+
+        Cycles Now() const {
+            return now_;
+        }
+        Counters Snapshot() const;
+        void ResetMaxLoop() {
+            max_loop_ = 0;
+        }
+
+        // ---- Used by the PSoC API stand-ins ----
+
+        void Charge();                // Cost of an API call
+        void Wait(Cycles cycles);     // Busy wait: interrupts are served meanwhile
+
+        // Interrupts
+        void EnableInterrupts();
+        void DisableInterrupts();
+        bool InterruptsEnabled() const {
+            return global_enabled_;
+        }
+        void WaitForInterrupt();
+        void StartIsr(Line line, Isr isr);
+        void StopIsr(Line line);
+
+        // SysTick and core registers
+        void     SysTickStart();
+        uint32_t SysTickValue() const;
+        uint32_t SysTickReload() const {
+            return (uint32_t)(kCyclesPerMs-1);
+        }
+        Isr      SetSysTickCallback(uint32_t number, Isr callback);
+        uint32_t ReadRegister(uint32_t address) const;
+        void     WriteRegister(uint32_t address, uint32_t value);
+
+        // I2C_Master: manual byte by byte operations
+        uint8_t I2cStart(uint8_t address, bool read, bool restart);
+        uint8_t I2cWriteByte(uint8_t byte);
+        uint8_t I2cReadByte();
+        uint8_t I2cStop();
+        // I2C_Master: buffer transfers carried out by its interrupt
+        uint8_t I2cTransfer(uint8_t address, uint8_t* data, uint8_t count, uint8_t mode, bool read);
+        uint8_t I2cStatus() const {
+            return i2c_status_;
+        }
+        uint8_t I2cClearStatus();
+        void    I2cReset();           // I2C_Master_Stop: transfer in progress abandoned
+
+        // UART
+        void    UartPut(uint8_t byte);
+        uint8_t UartTxStatus();
+        uint8_t UartGet();
+
+        // EEPROM
+        uint8_t  EepromRead(uint16_t address) const;
+        uint32_t EepromWrite(const uint8_t* data, uint16_t address, uint16_t size);
+        uint32_t EepromStartWrite(const uint8_t* row, uint8_t row_number);
+        uint32_t EepromQuery();
+        uint32_t EepromUpdateTemperature();
+
+    private:
+
+        struct Transfer {
+            bool     active  = false;
+            bool     raised  = false;  // Interrupt raised at the end
+            bool     nack    = false;  // Scripted fault: the device does not answer
+            bool     read    = false;
+            uint8_t  address = 0;
+            uint8_t* data    = nullptr;
+            uint8_t  count   = 0;
+            uint8_t  mode    = 0;
+            Cycles   end     = 0;
+        };
+
+        Board() = default;
+
+        void    RunUntil(Cycles target);
+        Cycles  NextEvent() const;
+        void    HandleEvents();
+        void    Raise(Line line);
+        void    Deliver();
+        void    RunIsr(Line line);
+        void    CompleteTransfer();
+        void    SensorStop(Lis3dh* sensor);
+        Lis3dh* Find(uint8_t address);
+        void    BusTime(Cycles bits);
+        void    UartUpdate();
+        void    EepromUpdate();
+
+        Params   params_;
+        Cycles   now_            = 0;
+        uint64_t api_calls_      = 0;
+        uint64_t interrupts_     = 0;
+
+        // Interrupts
+        bool     global_enabled_ = false; // Disabled at reset
+        bool     in_isr_         = false;
+        bool     woke_           = false;
+        uint32_t pending_        = 0;
+        uint32_t enabled_        = (1u << kSysTick) | (1u << kI2c);
+        std::array<Isr, kLines> isr_{};
+        std::deque<Cycles> presses_;
+
+        // SysTick and DWT
+        bool     systick_on_     = false;
+        Cycles   systick_start_  = 0;
+        Cycles   next_tick_      = kNever;
+        std::array<Isr, 5> systick_callbacks_{};
+        uint32_t demcr_          = 0;
+        uint32_t dwt_ctrl_       = 0;
+        Cycles   cyccnt_zero_    = 0;
+
+        // I2C
+        std::vector<std::unique_ptr<Lis3dh>> sensors_;
+        Lis3dh*  i2c_device_     = nullptr; // Addressed by the manual operations
+        uint8_t  i2c_status_     = 0;
+        Transfer transfer_;
+        Cycles   i2c_busy_       = 0;
+        std::deque<Cycles> i2c_nacks_;
+        std::deque<Cycles> i2c_hangs_;
+
+        // UART
+        std::deque<Cycles> uart_fifo_;      // Start times of the bytes waiting in the TX FIFO
+        Cycles   uart_line_free_ = 0;
+        Cycles   uart_busy_      = 0;
+        std::vector<uint8_t> uart_output_;
+        std::deque<std::pair<Cycles, uint8_t>> uart_input_;
+        Cycles   last_get_       = 0;
+        Cycles   max_loop_       = 0;
+
+        // EEPROM
+        std::vector<uint8_t> eeprom_ = std::vector<uint8_t>(2048, 0);
+        std::vector<uint8_t> eeprom_row_;
+        uint16_t eeprom_row_address_ = 0;
+        Cycles   eeprom_busy_until_  = 0;
+        bool     eeprom_writing_     = false;
+
+        Cycles   sleep_          = 0;
+    };
+
+    } // namespace board
+
+#endif
+
+/* [] END OF FILE */
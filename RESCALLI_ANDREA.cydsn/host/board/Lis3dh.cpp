@@ -0,0 +1,370 @@
+/* ========================================
+ *
+ * \file  Lis3dh.cpp
+ * \brief Register model of the LIS3DH behind the I2C stand-in
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Lis3dh.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace board {
+
+namespace {
+
+// Registers (see "Utility.h")
+constexpr uint8_t kWhoAmIReg   = 0x0F;
+constexpr uint8_t kWhoAmI      = 0x33;
+constexpr uint8_t kCtrlReg0    = 0x1E;
+constexpr uint8_t kCtrlReg1    = 0x20;
+constexpr uint8_t kCtrlReg3    = 0x22;
+constexpr uint8_t kCtrlReg4    = 0x23;
+constexpr uint8_t kCtrlReg5    = 0x24;
+constexpr uint8_t kStatusReg   = 0x27;
+constexpr uint8_t kOutXL       = 0x28;
+constexpr uint8_t kOutZH       = 0x2D;
+constexpr uint8_t kFifoCtrlReg = 0x2E;
+constexpr uint8_t kFifoSrcReg  = 0x2F;
+
+constexpr size_t  kFifoSize    = 32;
+constexpr double  kBusClockHz  = 24e6;
+
+// Writable registers (datasheet table 17): CTRL_REG0 ... REFERENCE, FIFO_CTRL_REG,
+// INT1_CFG, INT1_THS/DURATION, INT2_CFG, INT2_THS/DURATION, CLICK_CFG, CLICK_THS ... ACT_DUR
+bool IsWritable(uint8_t address) {
+    return ((address >= 0x1E) && (address <= 0x26)) || (address == 0x2E) || (address == 0x30) ||
+           ((address >= 0x32) && (address <= 0x34)) || ((address >= 0x36) && (address <= 0x38)) ||
+           ((address >= 0x3A) && (address <= 0x3F));
+}
+
+// CTRL_REG1 ODR[3:0] --> Hz (1.6 kHz and 5.376 kHz in Low Power mode only)
+uint16_t OdrHz(uint8_t ctrl_reg1) {
+    static const uint16_t table[16] = {0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344, 0, 0, 0, 0, 0, 0};
+    uint8_t odr = ctrl_reg1 >> 4;
+    if((odr == 9) && (ctrl_reg1 & 0x08)) {
+        return 5376;
+    }
+    return table[odr];
+}
+
+} // namespace
+
+
+Lis3dh::Lis3dh(uint8_t address, double odr_error_ppm)
+    : address_(address), odr_error_ppm_(odr_error_ppm) {
+
+    // Reset values
+    registers_[kWhoAmIReg] = kWhoAmI;
+    registers_[kCtrlReg0]  = 0x10;
+    registers_[kCtrlReg1]  = 0x07;
+
+} // end Lis3dh::Lis3dh
+
+
+void Lis3dh::Start(Cycles, bool read) {
+
+    in_transaction_ = true;
+    sub_address_    = !read;
+
+} // end Lis3dh::Start
+
+
+void Lis3dh::Write(Cycles now, uint8_t byte) {
+
+    if(sub_address_) {
+        pointer_     = byte & 0x7F;
+        increment_   = byte & 0x80;
+        sub_address_ = false;
+        return;
+    }
+
+    WriteRegister(now, pointer_, byte);
+    if(increment_) {
+        pointer_ = (pointer_+1) & 0x7F;
+    }
+
+} // end Lis3dh::Write
+
+
+uint8_t Lis3dh::Read(Cycles now) {
+
+    uint8_t value = ReadRegister(now, pointer_);
+    if(increment_) {
+        // With the FIFO on, the burst read rolls back to OUT_X_L (datasheet 5.1.2)
+        pointer_ = (FifoActive() && (pointer_ == kOutZH)) ? kOutXL : ((pointer_+1) & 0x7F);
+    }
+    return value;
+
+} // end Lis3dh::Read
+
+
+bool Lis3dh::Stop(Cycles) {
+
+    in_transaction_ = false;
+    sub_address_    = false;
+
+    bool before = Int1();
+    for(const Sample& sample : pending_) {
+        Apply(sample);
+    }
+    pending_.clear();
+
+    bool edge = !before && Int1();
+    if(edge) {
+        stats_.int1_edges++;
+    }
+    return edge;
+
+} // end Lis3dh::Stop
+
+
+uint16_t Lis3dh::Odr() const {
+
+    return OdrHz(registers_[kCtrlReg1]);
+
+} // end Lis3dh::Odr
+
+
+double Lis3dh::PeriodCycles() const {
+
+    return kBusClockHz/Odr()*(1.0 + odr_error_ppm_*1e-6);
+
+} // end Lis3dh::PeriodCycles
+
+
+Cycles Lis3dh::NextSample() const {
+
+    if(Odr() == 0) {
+        return kNever;
+    }
+    return odr_start_ + (Cycles)std::llround((double)(odr_index_+1)*PeriodCycles());
+
+} // end Lis3dh::NextSample
+
+
+bool Lis3dh::Produce(Cycles) {
+
+    Sample sample;
+    sample.time = NextSample();
+    odr_index_++;
+
+    int16_t mg[3];
+    if(source_) {
+        source_(sample_count_, sample.time, mg);
+    }
+    else {
+        // 1 g on Z, 250 mg rotating in the XY plane at 1 Hz, +-2 mg of noise
+        double seconds = sample.time/kBusClockHz;
+        double angle   = 2*M_PI*seconds;
+        double value[3] = {250*std::cos(angle), 250*std::sin(angle), 1000};
+        for(int axis = 0; axis < 3; axis++) {
+            noise_ = noise_*1664525u + 1013904223u;
+            mg[axis] = (int16_t)std::lround(value[axis] + (int)(noise_ >> 29) - 3.5);
+        }
+    }
+    sample_count_++;
+
+    // Resolution from LPen and HR, sensitivity from FS (datasheet table 4)
+    static const int16_t sensitivity[4] = {1, 2, 4, 12}; // [mg/digit] HR mode
+    uint8_t fs   = (registers_[kCtrlReg4] >> 4) & 0x03;
+    int     bits = (registers_[kCtrlReg1] & 0x08) ? 8 : ((registers_[kCtrlReg4] & 0x08) ? 12 : 10);
+    int     mg_per_digit = sensitivity[fs] << (12-bits);
+    int     limit = 1 << (bits-1);
+    for(int axis = 0; axis < 3; axis++) {
+        long counts = std::lround((double)mg[axis]/mg_per_digit);
+        counts = std::max<long>(-limit, std::min<long>(limit-1, counts));
+        uint16_t left = (uint16_t)((uint32_t)counts << (16-bits));
+        sample.bytes[2*axis]   = (uint8_t)(left & 0xFF);
+        sample.bytes[2*axis+1] = (uint8_t)(left >> 8);
+    }
+
+    stats_.generated++;
+
+    // BDU: the output registers do not change while they are being read
+    if(in_transaction_) {
+        pending_.push_back(sample);
+        return false;
+    }
+
+    bool before = Int1();
+    Apply(sample);
+    bool edge = !before && Int1();
+    if(edge) {
+        stats_.int1_edges++;
+    }
+    return edge;
+
+} // end Lis3dh::Produce
+
+
+bool Lis3dh::Int1() const {
+
+    if(!(registers_[kCtrlReg3] & 0x10)) {
+        return false;
+    }
+    return FifoActive() ? !fifo_.empty() : zyxda_;
+
+} // end Lis3dh::Int1
+
+
+bool Lis3dh::FifoActive() const {
+
+    return (registers_[kCtrlReg5] & 0x40) && (registers_[kFifoCtrlReg] & 0xC0);
+
+} // end Lis3dh::FifoActive
+
+
+void Lis3dh::Apply(const Sample& sample) {
+
+    if(FifoActive()) {
+        if(fifo_.size() >= kFifoSize) {
+            fifo_overrun_ = true;
+            stats_.overwritten++;
+            // FIFO mode stops collecting, Stream mode drops the oldest sample
+            if((registers_[kFifoCtrlReg] >> 6) == 0x01) {
+                return;
+            }
+            fifo_.pop_front();
+        }
+        fifo_.push_back(sample);
+        return;
+    }
+
+    if(fresh_) {
+        stats_.overwritten++;
+        zyxor_ = true;
+    }
+    output_ = sample;
+    fresh_  = true;
+    zyxda_  = true;
+
+} // end Lis3dh::Apply
+
+
+void Lis3dh::Consume(Cycles now, Cycles generated) {
+
+    Cycles latency = now - generated;
+    stats_.read++;
+    stats_.latency_sum += latency;
+    if(latency > stats_.latency_max) {
+        stats_.latency_max = latency;
+    }
+
+} // end Lis3dh::Consume
+
+
+uint8_t Lis3dh::ReadRegister(Cycles now, uint8_t address) {
+
+    if(address == kStatusReg) {
+        bool data    = FifoActive() ? !fifo_.empty() : zyxda_;
+        bool overrun = FifoActive() ? fifo_overrun_ : zyxor_;
+        return (overrun ? 0xF0 : 0x00) | (data ? 0x0F : 0x00);
+    }
+
+    if(address == kFifoSrcReg) {
+        size_t  level = fifo_.size();
+        uint8_t value = (level >= kFifoSize) ? (0x40 | 0x1F) : (uint8_t)level;
+        if(level == 0) {
+            value |= 0x20;
+        }
+        uint8_t threshold = registers_[kFifoCtrlReg] & 0x1F;
+        if(threshold && (level >= threshold)) {
+            value |= 0x80;
+        }
+        return value;
+    }
+
+    if((address >= kOutXL) && (address <= kOutZH)) {
+
+        if(FifoActive()) {
+            if(fifo_.empty()) {
+                return output_.bytes[address-kOutXL];
+            }
+            uint8_t value = fifo_.front().bytes[address-kOutXL];
+            if(address == kOutZH) {
+                // Sample read: the next one moves to the output registers
+                output_ = fifo_.front();
+                Consume(now, fifo_.front().time);
+                fifo_.pop_front();
+                fifo_overrun_ = false;
+            }
+            return value;
+        }
+
+        uint8_t value = output_.bytes[address-kOutXL];
+        if(address == kOutZH) {
+            if(fresh_) {
+                Consume(now, output_.time);
+                fresh_ = false;
+            }
+            zyxda_ = false;
+            zyxor_ = false;
+        }
+        return value;
+
+    } // end if(output registers)
+
+    return registers_[address];
+
+} // end Lis3dh::ReadRegister
+
+
+void Lis3dh::WriteRegister(Cycles now, uint8_t address, uint8_t value) {
+
+    if(!IsWritable(address)) {
+        return;
+    }
+
+    uint8_t previous = registers_[address];
+    registers_[address] = value;
+
+    switch(address) {
+
+        case kCtrlReg1:
+            // A new ODR restarts the timing: first sample one period later
+            if(OdrHz(previous) != OdrHz(value)) {
+                RestartOdr(now);
+            }
+            break;
+
+        case kCtrlReg5:
+            if(!(value & 0x40)) {
+                fifo_.clear();
+                fifo_overrun_ = false;
+            }
+            break;
+
+        case kFifoCtrlReg:
+            // Bypass mode resets the FIFO
+            if(!(value & 0xC0)) {
+                fifo_.clear();
+                fifo_overrun_ = false;
+            }
+            break;
+
+        default:
+            break;
+
+    } // end switch(address)
+
+} // end Lis3dh::WriteRegister
+
+
+void Lis3dh::RestartOdr(Cycles now) {
+
+    odr_start_ = now;
+    odr_index_ = 0;
+    if(odr_listener_) {
+        odr_listener_(Odr(), now);
+    }
+
+} // end Lis3dh::RestartOdr
+
+} // namespace board
+
+/* [] END OF FILE */
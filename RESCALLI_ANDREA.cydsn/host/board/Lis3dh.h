@@ -0,0 +1,140 @@
+/* ========================================
+ *
+ * \file  Lis3dh.h
+ * \brief Register model of the LIS3DH behind the I2C stand-in (see "Board.h")
+ *
+ * What the firmware relies on, from the datasheet (DocID17530):
+ * - WHO_AM_I, control registers with their reset values, auto-increment with the
+ *   MSb of the sub-address (rolling back from OUT_Z_H to OUT_X_L with the FIFO on)
+ * - samples generated at the ODR of CTRL_REG1 (with an error in ppm), the first one
+ *   a period after the ODR is set; resolution from LPen (8 bits) and HR (12 bits)
+ * - STATUS_REG: ZYXDA set by a new sample, ZYXOR when it overwrites an unread one,
+ *   both cleared by the read of OUT_Z_H. INT1 = ZYXDA if I1_ZYXDA (CTRL_REG3)
+ * - FIFO (CTRL_REG5 FIFO_EN): Bypass, FIFO and Stream modes, 32 samples, FIFO_SRC
+ * - samples generated during a transaction are applied at the stop condition (BDU)
+ *
+ * Time is counted in BUS_CLK cycles (24 MHz), as everything on the board
+ *
+ * ========================================
+*/
+
+#ifndef __LIS3DH_MODEL_H_
+    #define __LIS3DH_MODEL_H_
+
+    #include <cstdint>
+    #include <deque>
+    #include <functional>
+    #include <vector>
+
+    namespace board {
+
+    typedef uint64_t Cycles;
+
+    constexpr Cycles kNever = UINT64_MAX;
+
+    class Lis3dh {
+    public:
+
+        // Acceleration [mg] of a sample, from its index and the time it is generated
+        typedef std::function<void(uint64_t index, Cycles time, int16_t mg[3])> Source;
+
+        // New ODR [Hz] written in CTRL_REG1 (0: power down)
+        typedef std::function<void(uint16_t odr, Cycles time)> OdrListener;
+
+        struct Stats {
+            uint64_t generated   = 0; // Samples produced
+            uint64_t read        = 0; // Samples read (OUT_Z_H read with new data / popped from the FIFO)
+            uint64_t overwritten = 0; // Samples lost: replaced before being read, or FIFO full
+            uint64_t latency_sum = 0; // [cycles] From generation to read
+            Cycles   latency_max = 0;
+            uint64_t int1_edges  = 0; // Rising edges of INT1
+        };
+
+        Lis3dh(uint8_t address, double odr_error_ppm);
+
+        uint8_t address() const {
+            return address_;
+        }
+
+        // Bus side: address acknowledged (start or restart), bytes, stop condition
+        void    Start(Cycles now, bool read);
+        void    Write(Cycles now, uint8_t byte);
+        uint8_t Read(Cycles now);
+        bool    Stop(Cycles now); // True on a rising edge of INT1 (samples applied)
+
+        // Time side: time of the next sample (kNever if powered down), generation of it.
+        // Produce returns true on a rising edge of INT1
+        Cycles NextSample() const;
+        bool   Produce(Cycles now);
+        bool   Int1() const;
+
+        void SetSource(const Source& source) {
+            source_ = source;
+        }
+        void SetOdrListener(const OdrListener& listener) {
+            odr_listener_ = listener;
+        }
+
+        const Stats& stats() const {
+            return stats_;
+        }
+        void ResetLatencyMax() {
+            stats_.latency_max = 0;
+        }
+        uint8_t Register(uint8_t address) const {
+            return registers_[address & 0x7F];
+        }
+        uint16_t Odr() const;
+        size_t FifoLevel() const {
+            return fifo_.size();
+        }
+
+    private:
+
+        struct Sample {
+            uint8_t bytes[6]; // OUT_X_L ... OUT_Z_H
+            Cycles  time;     // Generation
+        };
+
+        void    WriteRegister(Cycles now, uint8_t address, uint8_t value);
+        uint8_t ReadRegister(Cycles now, uint8_t address);
+        void    Apply(const Sample& sample);
+        void    Consume(Cycles now, Cycles generated);
+        bool    FifoActive() const;
+        void    RestartOdr(Cycles now);
+        double  PeriodCycles() const;
+
+        uint8_t  address_;
+        double   odr_error_ppm_;
+        uint8_t  registers_[128] = {};
+        uint8_t  pointer_        = 0;     // Sub-address
+        bool     increment_      = false; // MSb of the sub-address
+        bool     sub_address_    = false; // Next written byte is the sub-address
+        bool     in_transaction_ = false;
+
+        // Bypass mode: output registers
+        Sample   output_         = {};
+        bool     zyxda_          = false;
+        bool     zyxor_          = false;
+        bool     fresh_          = false; // Output not read yet (latency, read count)
+
+        std::deque<Sample>  fifo_;
+        std::vector<Sample> pending_;     // Generated during a transaction
+        bool     fifo_overrun_   = false;
+
+        // Timing of the samples
+        Cycles   odr_start_      = 0;
+        uint64_t odr_index_      = 0;     // Samples generated since the ODR was set
+        uint64_t sample_count_   = 0;
+
+        Source      source_;
+        OdrListener odr_listener_;
+        Stats       stats_;
+        uint32_t    noise_       = 0x2545F491;
+    };
+
+    } // namespace board
+
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,279 @@
+/* ========================================
+ *
+ * \file  PsocApi.cpp
+ * \brief PSoC API stand-ins declared in "../psoc": they act on Board::Get()
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Board.h"
+
+#include "CyLib.h"
+#include "EEPROM.h"
+#include "I2C_Master.h"
+#include "ISR_DataReady.h"
+#include "ISR_Push.h"
+#include "UART.h"
+
+using board::Board;
+
+
+/* ---------------------------------- */
+/*     CORE (cytypes.h, CyLib.h)      */
+/* ---------------------------------- */
+
+uint32 Host_ReadReg32(uint32 address) {
+    return Board::Get().ReadRegister(address);
+}
+
+void Host_WriteReg32(uint32 address, uint32 value) {
+    Board::Get().WriteRegister(address, value);
+}
+
+void CyDelay(uint32 milliseconds) {
+    Board::Get().Charge();
+    Board::Get().Wait(milliseconds*board::kCyclesPerMs);
+}
+
+void CyDelayUs(uint16 microseconds) {
+    Board::Get().Charge();
+    Board::Get().Wait(microseconds*board::kCyclesPerUs);
+}
+
+void CySysTickStart(void) {
+    Board::Get().Charge();
+    Board::Get().SysTickStart();
+}
+
+void CySysTickStop(void) {
+    Board::Get().Charge();
+}
+
+uint32 CySysTickGetValue(void) {
+    Board::Get().Charge();
+    return Board::Get().SysTickValue();
+}
+
+uint32 CySysTickGetReload(void) {
+    Board::Get().Charge();
+    return Board::Get().SysTickReload();
+}
+
+cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function) {
+    Board::Get().Charge();
+    return Board::Get().SetSysTickCallback(number, function);
+}
+
+uint8 CyEnterCriticalSection(void) {
+    uint8 disabled = !Board::Get().InterruptsEnabled();
+    Board::Get().DisableInterrupts();
+    return disabled;
+}
+
+void CyExitCriticalSection(uint8 savedIntrStatus) {
+    if(!savedIntrStatus) {
+        Board::Get().EnableInterrupts();
+    }
+}
+
+void Host_InterruptsEnable(void) {
+    Board::Get().EnableInterrupts();
+}
+
+void Host_InterruptsDisable(void) {
+    Board::Get().DisableInterrupts();
+}
+
+void Host_WaitForInterrupt(void) {
+    Board::Get().WaitForInterrupt();
+}
+
+
+/* ---------------------------------- */
+/*           ISR COMPONENTS           */
+/* ---------------------------------- */
+
+void ISR_Push_StartEx(cyisraddress address) {
+    Board::Get().Charge();
+    Board::Get().StartIsr(board::kPush, address);
+}
+
+void ISR_Push_Stop(void) {
+    Board::Get().Charge();
+    Board::Get().StopIsr(board::kPush);
+}
+
+void ISR_DataReady_StartEx(cyisraddress address) {
+    Board::Get().Charge();
+    Board::Get().StartIsr(board::kDataReady, address);
+}
+
+void ISR_DataReady_Stop(void) {
+    Board::Get().Charge();
+    Board::Get().StopIsr(board::kDataReady);
+}
+
+
+/* ---------------------------------- */
+/*              EEPROM                */
+/* ---------------------------------- */
+
+void EEPROM_Start(void) {
+    Board::Get().Charge();
+}
+
+void EEPROM_Stop(void) {
+    Board::Get().Charge();
+}
+
+uint8 EEPROM_ReadByte(uint16 address) {
+    Board::Get().Charge();
+    return Board::Get().EepromRead(address);
+}
+
+cystatus EEPROM_WriteByte(uint8 dataByte, uint16 address) {
+    Board::Get().Charge();
+    return Board::Get().EepromWrite(&dataByte, address, 1);
+}
+
+cystatus EEPROM_Write(const uint8* rowData, uint8 rowNumber) {
+    Board::Get().Charge();
+    return Board::Get().EepromWrite(rowData, (uint16)(rowNumber*CYDEV_EEPROM_ROW_SIZE), CYDEV_EEPROM_ROW_SIZE);
+}
+
+cystatus EEPROM_StartWrite(const uint8* rowData, uint8 rowNumber) {
+    Board::Get().Charge();
+    return Board::Get().EepromStartWrite(rowData, rowNumber);
+}
+
+cystatus EEPROM_Query(void) {
+    Board::Get().Charge();
+    return Board::Get().EepromQuery();
+}
+
+cystatus EEPROM_UpdateTemperature(void) {
+    Board::Get().Charge();
+    return Board::Get().EepromUpdateTemperature();
+}
+
+
+/* ---------------------------------- */
+/*            I2C_Master              */
+/* ---------------------------------- */
+
+void I2C_Master_Start(void) {
+    Board::Get().Charge();
+}
+
+void I2C_Master_Stop(void) {
+    Board::Get().Charge();
+    Board::Get().I2cReset();
+}
+
+uint8 I2C_Master_MasterSendStart(uint8 slaveAddress, uint8 R_nW) {
+    Board::Get().Charge();
+    return Board::Get().I2cStart(slaveAddress, R_nW == I2C_Master_READ_XFER_MODE, false);
+}
+
+uint8 I2C_Master_MasterSendRestart(uint8 slaveAddress, uint8 R_nW) {
+    Board::Get().Charge();
+    return Board::Get().I2cStart(slaveAddress, R_nW == I2C_Master_READ_XFER_MODE, true);
+}
+
+uint8 I2C_Master_MasterSendStop(void) {
+    Board::Get().Charge();
+    return Board::Get().I2cStop();
+}
+
+uint8 I2C_Master_MasterWriteByte(uint8 theByte) {
+    Board::Get().Charge();
+    return Board::Get().I2cWriteByte(theByte);
+}
+
+uint8 I2C_Master_MasterReadByte(uint8 acknNak) {
+    (void)acknNak;
+    Board::Get().Charge();
+    return Board::Get().I2cReadByte();
+}
+
+uint8 I2C_Master_MasterWriteBuf(uint8 slaveAddress, uint8* wrData, uint8 cnt, uint8 mode) {
+    Board::Get().Charge();
+    return Board::Get().I2cTransfer(slaveAddress, wrData, cnt, mode, false);
+}
+
+uint8 I2C_Master_MasterReadBuf(uint8 slaveAddress, uint8* rdData, uint8 cnt, uint8 mode) {
+    Board::Get().Charge();
+    return Board::Get().I2cTransfer(slaveAddress, rdData, cnt, mode, true);
+}
+
+uint8 I2C_Master_MasterStatus(void) {
+    Board::Get().Charge();
+    return Board::Get().I2cStatus();
+}
+
+uint8 I2C_Master_MasterClearStatus(void) {
+    Board::Get().Charge();
+    return Board::Get().I2cClearStatus();
+}
+
+uint8 I2C_Master_MasterGetReadBufSize(void) {
+    Board::Get().Charge();
+    return 0;
+}
+
+uint8 I2C_Master_MasterGetWriteBufSize(void) {
+    Board::Get().Charge();
+    return 0;
+}
+
+
+/* ---------------------------------- */
+/*               UART                 */
+/* ---------------------------------- */
+
+void UART_Start(void) {
+    Board::Get().Charge();
+}
+
+void UART_Stop(void) {
+    Board::Get().Charge();
+}
+
+void UART_PutChar(uint8 txDataByte) {
+    Board::Get().Charge();
+    Board::Get().UartPut(txDataByte);
+}
+
+void UART_PutString(const char8* string) {
+    Board::Get().Charge();
+    while(*string) {
+        Board::Get().UartPut((uint8)*string++);
+    }
+}
+
+void UART_PutArray(const uint8* string, uint8 byteCount) {
+    Board::Get().Charge();
+    for(uint8 i = 0; i < byteCount; i++) {
+        Board::Get().UartPut(string[i]);
+    }
+}
+
+void UART_PutCRLF(uint8 txDataByte) {
+    Board::Get().Charge();
+    Board::Get().UartPut(txDataByte);
+    Board::Get().UartPut('\r');
+    Board::Get().UartPut('\n');
+}
+
+uint8 UART_ReadTxStatus(void) {
+    Board::Get().Charge();
+    return Board::Get().UartTxStatus();
+}
+
+uint8 UART_GetChar(void) {
+    Board::Get().Charge();
+    return Board::Get().UartGet();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,394 @@
+/* ========================================
+ *
+ * \file  Capture.cpp
+ * \brief Indexed capture files of the decoded stream: writer and memory-mapped reader
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace lis3dh {
+
+/*
+ * Writer
+*/
+
+CaptureWriter::CaptureWriter(const FrameFormat& format, uint32_t block_samples)
+    : decoder_(format) {
+
+    memcpy(header_.magic, kCaptureMagic, sizeof(header_.magic));
+    header_.version       = kCaptureVersion;
+    header_.block_samples = std::max<uint32_t>(8, block_samples & ~7u);
+    header_.timestamp     = format.timestamp;
+    snprintf(header_.format, sizeof(header_.format), "%s", format.ToString().c_str());
+
+} // end CaptureWriter::CaptureWriter
+
+
+CaptureWriter::~CaptureWriter() {
+    if(file_) {
+        Close();
+    }
+}
+
+
+bool CaptureWriter::Fail(const std::string& what) {
+    error_ = path_ + ": " + what;
+    return false;
+}
+
+
+bool CaptureWriter::Open(const std::string& path, std::string* error) {
+
+    path_ = path;
+    file_ = fopen(path.c_str(), "wb");
+    if(!file_) {
+        Fail(strerror(errno));
+        if(error) {
+            *error = error_;
+        }
+        return false;
+    }
+
+    // Page of the header, written again by Close
+    static const uint8_t kEmptyPage[kCapturePage] = {0};
+    if(fwrite(kEmptyPage, 1, kCapturePage, file_) != kCapturePage) {
+        Fail(strerror(errno));
+        if(error) {
+            *error = error_;
+        }
+        return false;
+    }
+    return true;
+
+} // end CaptureWriter::Open
+
+
+bool CaptureWriter::Append(const uint8_t* data, size_t size, int64_t host_ns) {
+
+    if(!file_) {
+        return false;
+    }
+    if(!started_) {
+        header_.start_host_ns = host_ns;
+        started_ = true;
+    }
+    host_ns_ = host_ns;
+
+    // The frame cut at the end of the previous chunk is completed by this one
+    if(pending_.empty()) {
+        size_t consumed = decoder_.Decode(data, size, decoded_);
+        pending_.assign(data+consumed, data+size);
+    }
+    else {
+        pending_.insert(pending_.end(), data, data+size);
+        size_t consumed = decoder_.Decode(pending_.data(), pending_.size(), decoded_);
+        pending_.erase(pending_.begin(), pending_.begin()+consumed);
+    }
+    return TakeSamples(host_ns);
+
+} // end CaptureWriter::Append
+
+
+/*
+ * Moves the samples just decoded into the block being filled, and the markers
+ * into the index, in stream order
+*/
+bool CaptureWriter::TakeSamples(int64_t host_ns) {
+
+    const SampleColumns& samples = decoded_.samples;
+    size_t marker = 0;
+
+    for(size_t i = 0; i <= samples.size(); i++) {
+
+        // Markers come before the samples taken at their frequency
+        while((marker < decoded_.markers.size()) && (decoded_.markers[marker].first_sample <= i)) {
+            const PacketInfo& info = decoded_.markers[marker++];
+            odr_ = info.odr;
+            index_.push_back({samples_, host_ns, info.time_us, odr_, IndexKind::Marker, {0}});
+        }
+        if(i == samples.size()) {
+            break;
+        }
+
+        uint64_t time_us = header_.timestamp ? samples.time_us[i] : 0;
+        if(block_.size() == 0) {
+            index_.push_back({samples_, host_ns, time_us, odr_, IndexKind::Block, {0}});
+        }
+        block_.x.push_back(samples.x[i]);
+        block_.y.push_back(samples.y[i]);
+        block_.z.push_back(samples.z[i]);
+        block_.sensor.push_back(samples.sensor[i]);
+        if(header_.timestamp) {
+            block_.time_us.push_back(time_us);
+        }
+        samples_++;
+
+        if((block_.size() == header_.block_samples) && !WriteBlock()) {
+            return false;
+        }
+    }
+
+    decoded_.clear();
+    return true;
+
+} // end CaptureWriter::TakeSamples
+
+
+bool CaptureWriter::WriteBlock() {
+
+    // Padded with zeros to the fixed size
+    size_t block_samples = header_.block_samples;
+    block_.x.resize(block_samples);
+    block_.y.resize(block_samples);
+    block_.z.resize(block_samples);
+    block_.sensor.resize(block_samples);
+
+    bool written = (fwrite(block_.x.data(), sizeof(float), block_samples, file_) == block_samples) &&
+                   (fwrite(block_.y.data(), sizeof(float), block_samples, file_) == block_samples) &&
+                   (fwrite(block_.z.data(), sizeof(float), block_samples, file_) == block_samples);
+    if(written && header_.timestamp) {
+        block_.time_us.resize(block_samples);
+        written = (fwrite(block_.time_us.data(), sizeof(uint64_t), block_samples, file_) == block_samples);
+    }
+    written = written && (fwrite(block_.sensor.data(), 1, block_samples, file_) == block_samples);
+
+    block_.clear();
+    header_.blocks++;
+    return written ? true : Fail(strerror(errno));
+
+} // end CaptureWriter::WriteBlock
+
+
+bool CaptureWriter::Close(std::string* error) {
+
+    if(!file_) {
+        return false;
+    }
+
+    // End of the stream: nothing is left pending
+    decoder_.Decode(pending_.data(), pending_.size(), decoded_, true);
+    pending_.clear();
+    bool written = TakeSamples(host_ns_) && ((block_.size() == 0) || WriteBlock());
+
+    if(written) {
+        const DecoderStats& stats = decoder_.stats();
+        header_.samples       = samples_;
+        header_.index_offset  = kCapturePage + header_.blocks*CaptureBlockBytes(header_.block_samples, header_.timestamp);
+        header_.index_entries = index_.size();
+        header_.end_host_ns   = host_ns_;
+        header_.frames        = stats.frames;
+        header_.markers       = stats.markers;
+        header_.corrupted     = stats.corrupted;
+        header_.lost_packets  = stats.lost_packets;
+
+        written = (fwrite(index_.data(), sizeof(CaptureIndexEntry), index_.size(), file_) == index_.size()) &&
+                  (fseek(file_, 0, SEEK_SET) == 0) &&
+                  (fwrite(&header_, sizeof(header_), 1, file_) == 1);
+        if(!written) {
+            Fail(strerror(errno));
+        }
+    }
+    if((fclose(file_) != 0) && written) {
+        written = Fail(strerror(errno));
+    }
+    file_ = nullptr;
+
+    if(!written && error) {
+        *error = error_;
+    }
+    return written;
+
+} // end CaptureWriter::Close
+
+
+/*
+ * Reader
+*/
+
+CaptureReader::~CaptureReader() {
+    Close();
+}
+
+
+void CaptureReader::Close() {
+    if(map_) {
+        munmap((void*)map_, size_);
+    }
+    map_    = nullptr;
+    size_   = 0;
+    header_ = nullptr;
+    index_  = nullptr;
+}
+
+
+bool CaptureReader::Open(const std::string& path, std::string* error) {
+
+    Close();
+
+    auto fail = [&](const std::string& what) {
+        if(error) {
+            *error = path + ": " + what;
+        }
+        Close();
+        return false;
+    };
+
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0) {
+        return fail(strerror(errno));
+    }
+    struct stat info;
+    if(fstat(file, &info) != 0) {
+        close(file);
+        return fail(strerror(errno));
+    }
+    if((size_t)info.st_size < kCapturePage) {
+        close(file);
+        return fail("not a capture (too short)");
+    }
+
+    size_ = (size_t)info.st_size;
+    void* mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if(mapped == MAP_FAILED) {
+        size_ = 0;
+        return fail(strerror(errno));
+    }
+    map_    = (const uint8_t*)mapped;
+    header_ = (const CaptureHeader*)map_;
+
+    if(memcmp(header_->magic, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+        return fail("not a capture");
+    }
+    if(header_->version != kCaptureVersion) {
+        return fail("capture version " + std::to_string(header_->version) + " not supported");
+    }
+
+    // Every offset inside the file (a capture whose writer did not close is all zeros)
+    uint64_t block_samples = header_->block_samples;
+    block_bytes_ = CaptureBlockBytes(header_->block_samples, header_->timestamp);
+    bool valid = (block_samples > 0) && (block_samples % 8 == 0) &&
+                 (header_->samples <= header_->blocks*block_samples) &&
+                 (header_->index_offset == kCapturePage + header_->blocks*block_bytes_) &&
+                 (header_->index_entries <= (size_ - std::min<uint64_t>(size_, header_->index_offset))/sizeof(CaptureIndexEntry));
+    if(!valid) {
+        return fail("capture truncated or not closed");
+    }
+    index_ = (const CaptureIndexEntry*)(map_ + header_->index_offset);
+    return true;
+
+} // end CaptureReader::Open
+
+
+CaptureBlock CaptureReader::Block(size_t block) const {
+
+    size_t         block_samples = header_->block_samples;
+    const uint8_t* base          = map_ + kCapturePage + block*block_bytes_;
+    const float*   x             = (const float*)base;
+
+    CaptureBlock columns;
+    columns.x       = x;
+    columns.y       = x + block_samples;
+    columns.z       = x + 2*block_samples;
+    columns.time_us = header_->timestamp ? (const uint64_t*)(x + 3*block_samples) : nullptr;
+    columns.sensor  = base + block_bytes_ - block_samples;
+    columns.first   = (uint64_t)block*block_samples;
+    columns.count   = (size_t)std::min<uint64_t>(block_samples, header_->samples - columns.first);
+    return columns;
+
+} // end CaptureReader::Block
+
+
+size_t CaptureReader::Read(uint64_t first, size_t count, SampleColumns& out) const {
+
+    if(first >= header_->samples) {
+        return 0;
+    }
+    count = (size_t)std::min<uint64_t>(count, header_->samples - first);
+
+    size_t copied = 0;
+    while(copied < count) {
+        uint64_t     sample  = first + copied;
+        CaptureBlock columns = Block((size_t)(sample/header_->block_samples));
+        size_t       offset  = (size_t)(sample - columns.first);
+        size_t       n       = std::min(count - copied, columns.count - offset);
+
+        out.x.insert(out.x.end(), columns.x + offset, columns.x + offset + n);
+        out.y.insert(out.y.end(), columns.y + offset, columns.y + offset + n);
+        out.z.insert(out.z.end(), columns.z + offset, columns.z + offset + n);
+        out.sensor.insert(out.sensor.end(), columns.sensor + offset, columns.sensor + offset + n);
+        if(columns.time_us) {
+            out.time_us.insert(out.time_us.end(), columns.time_us + offset, columns.time_us + offset + n);
+        }
+        copied += n;
+    }
+    return copied;
+
+} // end CaptureReader::Read
+
+
+uint64_t CaptureReader::SampleAtHostTime(int64_t host_ns) const {
+
+    const CaptureIndexEntry* begin = index_;
+    const CaptureIndexEntry* end   = index_ + header_->index_entries;
+    const CaptureIndexEntry* next  = std::lower_bound(begin, end, host_ns,
+        [](const CaptureIndexEntry& entry, int64_t time) {
+            return entry.host_ns < time;
+        });
+    if(next == begin) {
+        return 0;
+    }
+
+    // Between the entry before and the next one (or the end of the capture)
+    const CaptureIndexEntry& previous = *(next-1);
+    uint64_t next_sample  = (next == end) ? header_->samples : next->sample;
+    int64_t  next_host_ns = (next == end) ? header_->end_host_ns : next->host_ns;
+    if((host_ns >= next_host_ns) || (next_host_ns <= previous.host_ns)) {
+        return next_sample;
+    }
+    double fraction = (double)(host_ns - previous.host_ns)/(double)(next_host_ns - previous.host_ns);
+    return previous.sample + (uint64_t)(fraction*(double)(next_sample - previous.sample));
+
+} // end CaptureReader::SampleAtHostTime
+
+
+const CaptureIndexEntry* CaptureReader::EntryOfSample(uint64_t sample) const {
+
+    const CaptureIndexEntry* begin = index_;
+    const CaptureIndexEntry* end   = index_ + header_->index_entries;
+    const CaptureIndexEntry* next  = std::upper_bound(begin, end, sample,
+        [](uint64_t value, const CaptureIndexEntry& entry) {
+            return value < entry.sample;
+        });
+    return (next == begin) ? nullptr : next-1;
+
+} // end CaptureReader::EntryOfSample
+
+
+uint16_t CaptureReader::OdrOfSample(uint64_t sample) const {
+    const CaptureIndexEntry* entry = EntryOfSample(sample);
+    return entry ? entry->odr : 0;
+}
+
+
+void CaptureReader::Advise(int advice) const {
+    if(map_) {
+        madvise((void*)map_, size_, advice);
+    }
+}
+
+} // namespace lis3dh
+
+/* [] END OF FILE */
@@ -0,0 +1,230 @@
+/* ========================================
+ *
+ * \file  Capture.h
+ * \brief Indexed capture files of the decoded stream: writer and memory-mapped reader
+ *
+ * A raw recording of the UART has to be decoded from the start every time. A capture
+ * holds the samples already decoded (StreamDecoder, frames of "Packet.h"), in blocks
+ * of fixed size so that sample n is found by arithmetic, plus a sparse index to go
+ * from a host time or a frequency to a sample number without reading the samples.
+ *
+ * File (little-endian, as the host writes it):
+ *   CaptureHeader                          kCapturePage bytes
+ *   block 0, 1, ... blocks-1               CaptureBlockBytes() each
+ *     float    x[block_samples], y[...], z[...]   [m/s^2]
+ *     uint64_t time_us[block_samples]             PACKET_TIMESTAMP only
+ *     uint8_t  sensor[block_samples]
+ *   CaptureIndexEntry[index_entries]       at index_offset
+ * The last block is padded to the full size; samples past 'samples' are zero.
+ *
+ * Index: one entry at the first sample of every block and one at every ODR marker
+ * (PACKET_ODR_MARKER), in sample order. host_ns is the time the writer was given with
+ * the chunk of stream that completed the frame of the sample: between two entries the
+ * host time of a sample is interpolated. Without markers the ODR is 0 (unknown): the
+ * button presses are not visible on the wire.
+ *
+ * ========================================
+*/
+
+#ifndef __CAPTURE_H_
+    #define __CAPTURE_H_
+
+    #include "StreamDecoder.h"
+
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstdio>
+    #include <string>
+    #include <vector>
+
+    namespace lis3dh {
+
+    // Defines
+    constexpr char     kCaptureMagic[8]     = {'L', 'I', 'S', '3', 'C', 'A', 'P', '1'};
+    constexpr uint32_t kCaptureVersion      = 1;
+    constexpr size_t   kCapturePage         = 4096;
+    constexpr uint32_t kCaptureBlockSamples = 8192; // Multiple of kCapturePage: every block starts on a page
+
+    struct CaptureHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t block_samples;
+        uint64_t samples;
+        uint64_t blocks;
+        uint64_t index_offset;      // [bytes] From the start of the file
+        uint64_t index_entries;
+        int64_t  start_host_ns;     // Host time of the first chunk of stream
+        int64_t  end_host_ns;       // Host time of the last chunk of stream
+        uint64_t frames;            // Counters of the decoder (see DecoderStats)
+        uint64_t markers;
+        uint64_t corrupted;
+        uint64_t lost_packets;
+        uint8_t  timestamp;         // 1 --> the blocks have the time_us column
+        uint8_t  reserved[7];
+        char     format[64];        // FrameFormat::ToString of the stream
+    };
+    static_assert(sizeof(CaptureHeader) <= kCapturePage, "CaptureHeader does not fit its page");
+
+    enum class IndexKind : uint8_t {
+        Block  = 0, // First sample of a block
+        Marker = 1  // First sample after an ODR marker
+    };
+
+    struct CaptureIndexEntry {
+        uint64_t  sample;   // Sample number
+        int64_t   host_ns;  // Host time at which the sample was received
+        uint64_t  time_us;  // PSoC time of the sample (0 without PACKET_TIMESTAMP)
+        uint16_t  odr;      // [Hz] Frequency of the sample (0 if no marker seen yet)
+        IndexKind kind;
+        uint8_t   reserved[5];
+    };
+    static_assert(sizeof(CaptureIndexEntry) == 32, "CaptureIndexEntry is written as it is");
+
+    // Columns of one block, pointing into the mapped file
+    struct CaptureBlock {
+        const float*    x;
+        const float*    y;
+        const float*    z;
+        const uint64_t* time_us; // nullptr without PACKET_TIMESTAMP
+        const uint8_t*  sensor;
+        uint64_t        first;   // Sample number of x[0]
+        size_t          count;   // Valid samples in the block
+    };
+
+    // Bytes of a block of 'block_samples' samples
+    inline size_t CaptureBlockBytes(uint32_t block_samples, bool timestamp) {
+        return (size_t)block_samples*(3*sizeof(float) + (timestamp ? sizeof(uint64_t) : 0) + 1);
+    }
+
+
+    class CaptureWriter {
+    public:
+
+        explicit CaptureWriter(const FrameFormat& format,
+                               uint32_t block_samples = kCaptureBlockSamples);
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        // Creates the file. Returns false (and 'error') if it cannot be written
+        bool Open(const std::string& path,
+                  std::string* error = nullptr);
+
+        /*
+         * Decodes a chunk of the UART stream and appends its samples. A frame cut at
+         * the end of the chunk is kept for the next one.
+         * The parameters needed are:
+         * - chunk of the stream
+         * - [ns] host time at which it was received (any monotonic clock)
+         * Returns false if the file cannot be written
+        */
+        bool Append(const uint8_t* data,
+                    size_t size,
+                    int64_t host_ns);
+
+        // Decodes what is left, writes the last block, the index and the header
+        bool Close(std::string* error = nullptr);
+
+        const DecoderStats& stats() const {
+            return decoder_.stats();
+        }
+
+        uint64_t samples() const {
+            return samples_;
+        }
+
+    private:
+
+        bool TakeSamples(int64_t host_ns);
+        bool WriteBlock();
+        bool Fail(const std::string& what);
+
+        StreamDecoder  decoder_;
+        DecodedStream  decoded_;
+        CaptureHeader  header_{};
+        FILE*          file_    = nullptr;
+        std::string    path_;
+        std::string    error_;
+        std::vector<uint8_t> pending_; // Beginning of a frame not complete yet
+
+        SampleColumns  block_;          // Samples of the block being filled
+        std::vector<CaptureIndexEntry> index_;
+        uint64_t       samples_  = 0;
+        uint16_t       odr_      = 0;   // [Hz] From the last marker
+        int64_t        host_ns_  = 0;   // Of the last chunk
+        bool           started_  = false;
+    };
+
+
+    class CaptureReader {
+    public:
+
+        CaptureReader() = default;
+        ~CaptureReader();
+
+        CaptureReader(const CaptureReader&) = delete;
+        CaptureReader& operator=(const CaptureReader&) = delete;
+
+        // Maps the file. Returns false (and 'error') if it is not a valid capture
+        bool Open(const std::string& path,
+                  std::string* error = nullptr);
+        void Close();
+
+        const CaptureHeader& header() const {
+            return *header_;
+        }
+
+        uint64_t samples() const {
+            return header_->samples;
+        }
+
+        size_t blocks() const {
+            return (size_t)header_->blocks;
+        }
+
+        const CaptureIndexEntry* index() const {
+            return index_;
+        }
+
+        size_t index_entries() const {
+            return (size_t)header_->index_entries;
+        }
+
+        // Columns of block 'block' (0 ... blocks()-1)
+        CaptureBlock Block(size_t block) const;
+
+        /*
+         * Copies 'count' samples from sample number 'first' (fewer at the end of the
+         * capture) to the columns of 'out', appended. Returns the # samples copied
+        */
+        size_t Read(uint64_t first,
+                    size_t count,
+                    SampleColumns& out) const;
+
+        // First sample received at host time 'host_ns' or later (interpolated in a block)
+        uint64_t SampleAtHostTime(int64_t host_ns) const;
+
+        // [Hz] Frequency of a sample (0 if not known)
+        uint16_t OdrOfSample(uint64_t sample) const;
+
+        // Hint of the access pattern of the next reads (MADV_SEQUENTIAL, MADV_RANDOM ...)
+        void Advise(int advice) const;
+
+    private:
+
+        // Last index entry at or before 'sample'
+        const CaptureIndexEntry* EntryOfSample(uint64_t sample) const;
+
+        const uint8_t*           map_    = nullptr;
+        size_t                   size_   = 0;
+        const CaptureHeader*     header_ = nullptr;
+        const CaptureIndexEntry* index_  = nullptr;
+        size_t                   block_bytes_ = 0;
+    };
+
+    } // namespace lis3dh
+
+#endif
+
+/* [] END OF FILE */
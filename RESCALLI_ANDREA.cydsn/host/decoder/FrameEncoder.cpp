@@ -0,0 +1,145 @@
+/* ========================================
+ *
+ * \file  FrameEncoder.cpp
+ * \brief Host encoder of the frame formats (tests and benchmarks of the decoder)
+ *
+ * ========================================
+*/
+
+// Includes
+#include "FrameEncoder.h"
+
+
+namespace lis3dh {
+
+namespace {
+
+// Header, [ID], [N], [SEQ], [TIME]
+void PutHead(const FrameFormat& format,
+             uint8_t sensor,
+             uint8_t count,
+             uint8_t sequence,
+             uint32_t time_us,
+             std::vector<uint8_t>& out) {
+
+    out.push_back(kHeader);
+    if(format.sensor_id) {
+        out.push_back(sensor);
+    }
+    if(format.batching) {
+        out.push_back(count);
+    }
+    if(format.integrity) {
+        out.push_back(sequence);
+    }
+    if(format.timestamp) {
+        out.push_back((uint8_t) time_us);
+        out.push_back((uint8_t) (time_us>>8));
+        out.push_back((uint8_t) (time_us>>16));
+    }
+
+} // end PutHead
+
+void Put16(int16_t value, std::vector<uint8_t>& out) {
+
+    out.push_back((uint8_t) ((uint16_t)value & 0xFF));
+    out.push_back((uint8_t) ((uint16_t)value >> 8));
+
+} // end Put16
+
+} // namespace
+
+
+size_t FrameEncoder::Samples(uint8_t sensor,
+                             const int16_t (*samples)[3],
+                             uint8_t count,
+                             uint32_t time_us,
+                             std::vector<uint8_t>& out) {
+
+    size_t start = out.size();
+    PutHead(format_, sensor, count, sequence_, time_us, out);
+
+    switch(format_.encoding) {
+
+        case Encoding::Raw12: {
+            // Little-endian bit stream, 36 bits per sample
+            size_t   first = out.size();
+            size_t   bytes = ((size_t)count*36+7)/8;
+            out.resize(first+bytes, 0);
+            for(uint8_t i = 0; i < count; i++) {
+                for(int axis = 0; axis < 3; axis++) {
+                    uint32_t counts = (uint16_t)samples[i][axis] & 0x0FFF;
+                    for(int bit = 0; bit < 12; bit++) {
+                        size_t position = (size_t)i*36 + axis*12 + bit;
+                        if(counts & (1u << bit)) {
+                            out[first + position/8] |= (uint8_t)(1u << (position%8));
+                        }
+                    }
+                }
+            }
+            break;
+        }
+
+        case Encoding::Delta:
+            for(int axis = 0; axis < 3; axis++) {
+                Put16(samples[0][axis], out);
+            }
+            for(uint8_t i = 1; i < count; i++) {
+                for(int axis = 0; axis < 3; axis++) {
+                    int16_t  delta  = (int16_t)(samples[i][axis] - samples[i-1][axis]);
+                    uint16_t zigzag = (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+                    while(zigzag >= 0x80) {
+                        out.push_back((uint8_t)(zigzag | 0x80));
+                        zigzag >>= 7;
+                    }
+                    out.push_back((uint8_t) zigzag);
+                }
+            }
+            break;
+
+        case Encoding::Mms2:
+        default:
+            for(uint8_t i = 0; i < count; i++) {
+                for(int axis = 0; axis < 3; axis++) {
+                    Put16(samples[i][axis], out);
+                }
+            }
+            break;
+
+    } // end switch(encoding)
+
+    return Finish(out, start);
+
+} // end FrameEncoder::Samples
+
+
+size_t FrameEncoder::Marker(uint16_t odr,
+                            uint32_t time_us,
+                            std::vector<uint8_t>& out) {
+
+    size_t start = out.size();
+    PutHead(format_, kAllSensors, 0, sequence_, time_us, out);
+    out.push_back((uint8_t) (odr & 0xFF));
+    out.push_back((uint8_t) (odr >> 8));
+
+    return Finish(out, start);
+
+} // end FrameEncoder::Marker
+
+
+// [CRC], tail
+size_t FrameEncoder::Finish(std::vector<uint8_t>& out, size_t start) {
+
+    if(format_.integrity) {
+        out.push_back(Crc8(&out[start+1], out.size()-start-1));
+        sequence_++;
+    }
+    out.push_back(kTail);
+
+    return out.size()-start;
+
+} // end FrameEncoder::Finish
+
+} // namespace lis3dh
+
+/* [] END OF FILE */
@@ -0,0 +1,62 @@
+/* ========================================
+ *
+ * \file  FrameEncoder.h
+ * \brief Host encoder of the frame formats, written from the description in
+ *        BRIDGE_CONTROL_PANEL_CONFIG_FILES/README.txt
+ *
+ * For the tests and the benchmarks of the decoder: the firmware encoder is
+ * "Packet.c", which the round-trip tests build for the host as it is
+ *
+ * ========================================
+*/
+
+#ifndef __FRAME_ENCODER_H_
+    #define __FRAME_ENCODER_H_
+
+    #include "StreamDecoder.h"
+
+    namespace lis3dh {
+
+    class FrameEncoder {
+    public:
+
+        explicit FrameEncoder(const FrameFormat& format) : format_(format) {
+        }
+
+        /*
+         * Appends a frame of samples to 'out' and returns its length.
+         * The parameters needed are:
+         * - ID of the sensor
+         * - samples, X Y Z: mm/s^2 (MMS2) or 12-bit counts (RAW12, DELTA)
+         * - # samples (1 without batching)
+         * - [us] time of the first sample (low 24 bits sent)
+        */
+        size_t Samples(uint8_t sensor,
+                       const int16_t (*samples)[3],
+                       uint8_t count,
+                       uint32_t time_us,
+                       std::vector<uint8_t>& out);
+
+        // Appends an ODR marker, returns its length
+        size_t Marker(uint16_t odr,
+                      uint32_t time_us,
+                      std::vector<uint8_t>& out);
+
+        // Packets dropped by the firmware still take a sequence number
+        void SkipSequence(uint8_t count) {
+            sequence_ = (uint8_t)(sequence_+count);
+        }
+
+    private:
+
+        size_t Finish(std::vector<uint8_t>& out, size_t start);
+
+        FrameFormat format_;
+        uint8_t     sequence_ = 0;
+    };
+
+    } // namespace lis3dh
+
+#endif
+
+/* [] END OF FILE */
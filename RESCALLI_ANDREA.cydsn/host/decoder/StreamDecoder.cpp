@@ -0,0 +1,835 @@
+/* ========================================
+ *
+ * \file  StreamDecoder.cpp
+ * \brief Host decoder of the frame stream sent by the firmware via UART
+ *
+ * ========================================
+*/
+
+// Includes
+#include "StreamDecoder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace lis3dh {
+
+namespace {
+
+// CRC-8, polynomial x^8+x^2+x+1 (value[0]: same table as "Packet.c", built at compile
+// time). value[k][b]: CRC of b followed by k zero bytes, to take 8 bytes per step
+struct Crc8Table {
+    uint8_t value[8][256];
+    constexpr Crc8Table() : value{} {
+        for(int i = 0; i < 256; i++) {
+            uint8_t crc = (uint8_t) i;
+            for(int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80) ? (uint8_t)((crc<<1) ^ 0x07) : (uint8_t)(crc<<1);
+            }
+            value[0][i] = crc;
+        }
+        for(int k = 1; k < 8; k++) {
+            for(int i = 0; i < 256; i++) {
+                value[k][i] = value[0][value[k-1][i]];
+            }
+        }
+    }
+};
+constexpr Crc8Table kCrc8Table;
+
+constexpr size_t kColumnStep = 4096; // [samples] Growth of the columns during Decode
+
+constexpr float kMms2ToMs2   = 0.001f;         // MMS2: mm/s^2 --> m/s^2
+constexpr float kCountsToMs2 = 9.81f/1000.0f;  // RAW12/DELTA: 1 mg/digit --> m/s^2
+
+inline int16_t Read16(const uint8_t* data) {
+    return (int16_t)(data[0] | (data[1]<<8));
+}
+
+// 5 bytes, LSB first (the 36 bits of a RAW12 sample, 4 bits of slack)
+inline uint64_t Read40(const uint8_t* data) {
+    return (uint64_t)data[0] | ((uint64_t)data[1]<<8) | ((uint64_t)data[2]<<16) |
+           ((uint64_t)data[3]<<24) | ((uint64_t)data[4]<<32);
+}
+
+inline int16_t SignExtend12(uint64_t bits) {
+    return (int16_t)((int32_t)((uint32_t)(bits & 0x0FFF) << 20) >> 20);
+}
+
+// Report lines of the UART commands ('S', 'D', 'Q', error messages)
+inline bool IsText(uint8_t byte) {
+    return ((byte >= 0x20) && (byte < 0x7F)) || (byte == '\r') || (byte == '\n') || (byte == '\t');
+}
+
+} // namespace
+
+
+uint8_t Crc8(const uint8_t* data, size_t length) {
+
+    uint8_t crc = 0;
+    size_t  i   = 0;
+    for(; i+8 <= length; i += 8) {
+        crc = kCrc8Table.value[7][crc ^ data[i]] ^ kCrc8Table.value[6][data[i+1]] ^
+              kCrc8Table.value[5][data[i+2]]     ^ kCrc8Table.value[4][data[i+3]] ^
+              kCrc8Table.value[3][data[i+4]]     ^ kCrc8Table.value[2][data[i+5]] ^
+              kCrc8Table.value[1][data[i+6]]     ^ kCrc8Table.value[0][data[i+7]];
+    }
+    for(; i < length; i++) {
+        crc = kCrc8Table.value[0][crc ^ data[i]];
+    }
+    return crc;
+
+} // end Crc8
+
+
+std::string FrameFormat::Check() const {
+
+    if(odr_marker && !batching) {
+        return "PACKET_ODR_MARKER needs PACKET_BATCHING";
+    }
+    if((encoding == Encoding::Delta) && !batching) {
+        return "PACKET_ENCODING_DELTA needs PACKET_BATCHING";
+    }
+    return "";
+
+} // end FrameFormat::Check
+
+
+bool FrameFormat::Parse(const std::string& options) {
+
+    *this = FrameFormat();
+
+    size_t start = 0;
+    while(start <= options.size()) {
+
+        size_t end = options.find(',', start);
+        if(end == std::string::npos) {
+            end = options.size();
+        }
+        std::string option = options.substr(start, end-start);
+        start = end+1;
+
+        if(option.empty() || (option == "default")) continue;
+        else if(option == "id")        sensor_id  = true;
+        else if(option == "batching")  batching   = true;
+        else if(option == "integrity") integrity  = true;
+        else if(option == "marker")    odr_marker = true;
+        else if(option == "time")      timestamp  = true;
+        else if(option == "mms2")      encoding   = Encoding::Mms2;
+        else if(option == "raw12")     encoding   = Encoding::Raw12;
+        else if(option == "delta")     encoding   = Encoding::Delta;
+        else return false;
+
+    } // end while(options)
+
+    return true;
+
+} // end FrameFormat::Parse
+
+
+std::string FrameFormat::ToString() const {
+
+    std::string options;
+    auto add = [&options](bool enabled, const char* name) {
+        if(enabled) {
+            options += options.empty() ? "" : ",";
+            options += name;
+        }
+    };
+    add(sensor_id,  "id");
+    add(batching,   "batching");
+    add(integrity,  "integrity");
+    add(odr_marker, "marker");
+    add(timestamp,  "time");
+    add(encoding == Encoding::Raw12, "raw12");
+    add(encoding == Encoding::Delta, "delta");
+
+    return options.empty() ? "default" : options;
+
+} // end FrameFormat::ToString
+
+
+void SampleColumns::clear() {
+
+    x.clear();
+    y.clear();
+    z.clear();
+    sensor.clear();
+    time_us.clear();
+    raw_x.clear();
+    raw_y.clear();
+    raw_z.clear();
+
+} // end SampleColumns::clear
+
+
+void DecodedStream::clear() {
+
+    samples.clear();
+    markers.clear();
+    packets.clear();
+    text.clear();
+
+} // end DecodedStream::clear
+
+
+StreamDecoder::StreamDecoder(const FrameFormat& format)
+    : StreamDecoder(format, Options()) {
+}
+
+
+StreamDecoder::StreamDecoder(const FrameFormat& format, const Options& options)
+    : format_(format), options_(options) {
+
+    for(size_t count = 1; count <= kMaxBatch; count++) {
+        bool complete;
+        payload_bytes_[count] = (format_.encoding == Encoding::Delta) ? 0 :
+                                (uint16_t)SamplesBytes(nullptr, 0, (uint8_t)count, &complete);
+    }
+    SetOdr(0);
+}
+
+
+/*
+ * Decodes the frames of a chunk: fast path on a header where the previous frame ended,
+ * byte by byte (text, records, garbage) otherwise
+*/
+size_t StreamDecoder::Decode(const uint8_t* data,
+                             size_t size,
+                             DecodedStream& out,
+                             bool last) {
+
+    size_t position = 0;
+
+    // The columns are grown ahead and written in place, trimmed at the end
+    filled_ = out.samples.size();
+
+    while(position < size) {
+
+        uint8_t byte = data[position];
+
+        if(in_sync_ && (byte == kHeader)) {
+            size_t run = DecodeRun(&data[position], size-position, position_+position, out);
+            if(run > 0) {
+                position += run;
+                continue;
+            }
+        }
+
+        if(byte == kHeader) {
+
+            size_t length = 0;
+            Candidate candidate = TryFrame(&data[position], size-position, last,
+                                           position_+position, &length, out);
+
+            if(candidate == Candidate::Accepted) {
+                position += length;
+                in_sync_  = true;
+                continue;
+            }
+            if(candidate == Candidate::Incomplete) {
+                break;
+            }
+
+            // A frame was due here: it is lost. Look for the next one from the next byte
+            if(in_sync_) {
+                stats_.corrupted++;
+                corrupted_since_good_++;
+                in_sync_ = false;
+            }
+            stats_.skipped_bytes++;
+            position++;
+            continue;
+
+        } // end if(header)
+
+        if((byte == kRecordHeader) || (byte == kBenchHeader) || (byte == kInstrHeader)) {
+
+            if(size-position < kRecordSize) {
+                if(!last) {
+                    break;
+                }
+            }
+            else if(data[position+kRecordSize-1] == kTail) {
+                Candidate hidden = in_sync_ ? Candidate::Rejected : HiddenFrame(&data[position], size-position, last);
+                if(hidden == Candidate::Incomplete) {
+                    break;
+                }
+                if(hidden != Candidate::Accepted) {
+                    stats_.records++;
+                    position += kRecordSize;
+                    in_sync_  = true;
+                    continue;
+                }
+            }
+
+        } // end if(record header)
+
+        if(IsText(byte)) {
+            stats_.text_bytes++;
+            if(options_.keep_text) {
+                out.text.push_back((char)byte);
+            }
+        }
+        else {
+            // Neither a frame, nor a record, nor text: the header of a frame has been hit
+            if(in_sync_) {
+                stats_.corrupted++;
+                corrupted_since_good_++;
+                in_sync_ = false;
+            }
+            stats_.skipped_bytes++;
+        }
+        position++;
+
+    } // end while(position)
+
+    position_    += position;
+    stats_.bytes += position;
+    ResizeColumns(out.samples, filled_);
+
+    return position;
+
+} // end StreamDecoder::Decode
+
+
+/*
+ * Fast path, in sync: frames of samples one after the other, checked and decoded in a
+ * single pass. Stops at the first frame it does not take as it is (marker, frame not
+ * complete, or failing a check): Decode looks at that one. Returns the bytes consumed
+*/
+size_t StreamDecoder::DecodeRun(const uint8_t* data,
+                                size_t size,
+                                uint64_t offset,
+                                DecodedStream& out) {
+
+    const size_t head     = format_.HeadBytes();
+    const size_t tail     = format_.TailBytes();
+    const size_t at_count = 1 + format_.sensor_id;
+    size_t       position = 0;
+
+    while(size-position >= head) {
+
+        const uint8_t* frame  = &data[position];
+        const uint8_t  sensor = format_.sensor_id ? frame[1] : 0;
+        const uint8_t  count  = format_.batching ? frame[at_count] : 1;
+        if((frame[0] != kHeader) || (count == 0) || (count > kMaxBatch) || (sensor >= kMaxSensors)) {
+            break;
+        }
+
+        size_t payload = payload_bytes_[count];
+        if(format_.encoding == Encoding::Delta) {
+            bool complete;
+            payload = SamplesBytes(&frame[head], size-position-head, count, &complete);
+            if(payload == 0) {
+                break;
+            }
+        }
+
+        const size_t length = head + payload + tail;
+        if((size-position < length) || (frame[length-1] != kTail) ||
+           (format_.integrity && (Crc8(&frame[1], length-3) != frame[length-2]))) {
+            break;
+        }
+
+        AcceptFrame(frame, length, offset+position, out);
+        position += length;
+
+    } // end while(frames)
+
+    return position;
+
+} // end StreamDecoder::DecodeRun
+
+
+/*
+ * Out of sync, a byte of the samples can look like the header of a record whose
+ * last byte is the tail of a frame: the record is taken only if no frame starts
+ * inside it. Returns Accepted if one does, Incomplete if one may (end of the chunk)
+*/
+StreamDecoder::Candidate StreamDecoder::HiddenFrame(const uint8_t* record,
+                                                    size_t available,
+                                                    bool last) const {
+
+    Candidate hidden = Candidate::Rejected;
+    for(size_t index = 1; index < kRecordSize; index++) {
+        if(record[index] != kHeader) {
+            continue;
+        }
+        size_t length = 0;
+        Candidate candidate = CheckFrame(&record[index], available-index, last, &length);
+        if(candidate == Candidate::Accepted) {
+            return candidate;
+        }
+        if(candidate == Candidate::Incomplete) {
+            hidden = candidate;
+        }
+    }
+    return hidden;
+
+} // end StreamDecoder::HiddenFrame
+
+
+/*
+ * Checks the frame starting at a header and decodes it
+*/
+StreamDecoder::Candidate StreamDecoder::TryFrame(const uint8_t* frame,
+                                                 size_t available,
+                                                 bool last,
+                                                 uint64_t offset,
+                                                 size_t* length,
+                                                 DecodedStream& out) {
+
+    Candidate candidate = CheckFrame(frame, available, last, length);
+
+    if(candidate == Candidate::CrcError) {
+        if(in_sync_) {
+            stats_.crc_errors++;
+        }
+        return Candidate::Rejected;
+    }
+    if(candidate != Candidate::Accepted) {
+        return candidate;
+    }
+
+    AcceptFrame(frame, *length, offset, out);
+    return Candidate::Accepted;
+
+} // end StreamDecoder::TryFrame
+
+
+/*
+ * Takes a frame that passed the checks: sequence, time, marker or samples
+*/
+__attribute__((always_inline)) // Into DecodeRun (fast path) and TryFrame
+inline void StreamDecoder::AcceptFrame(const uint8_t* frame,
+                                       size_t length,
+                                       uint64_t offset,
+                                       DecodedStream& out) {
+
+    // Head (already checked)
+    const size_t head  = format_.HeadBytes();
+    size_t       index = 1;
+
+    uint8_t sensor = format_.sensor_id ? frame[index++] : 0;
+    uint8_t count  = format_.batching ? frame[index++] : 1;
+    const bool marker = (count == 0);
+    if(marker) {
+        sensor = kAllSensors;
+    }
+
+    uint8_t sequence = 0;
+    if(format_.integrity) {
+        sequence = frame[index++];
+        AccountSequence(sequence);
+    }
+    corrupted_since_good_ = 0;
+
+    uint64_t time_us = 0;
+    if(format_.timestamp) {
+        uint32_t time24 = frame[index] | (frame[index+1]<<8) | ((uint32_t)frame[index+2]<<16);
+        time_us = Unwrap(marker ? kMaxSensors : sensor, time24);
+    }
+
+    PacketInfo info;
+    info.offset       = offset;
+    info.first_sample = filled_;
+    info.time_us      = time_us;
+    info.sensor       = sensor;
+    info.count        = marker ? 0 : count;
+    info.sequence     = sequence;
+    info.length       = (uint16_t)length;
+
+    if(marker) {
+        SetOdr((uint16_t)(frame[head] | (frame[head+1]<<8)));
+        info.odr = odr_;
+        out.markers.push_back(info);
+        stats_.markers++;
+        return;
+    }
+
+    info.odr = odr_;
+    AppendSamples(&frame[head], count, sensor, time_us, out);
+    if(options_.keep_packets) {
+        out.packets.push_back(info);
+    }
+    stats_.frames++;
+    stats_.samples += count;
+
+} // end StreamDecoder::AcceptFrame
+
+
+/*
+ * Checks the frame starting at a header (head, length, tail, CRC), without decoding it
+*/
+StreamDecoder::Candidate StreamDecoder::CheckFrame(const uint8_t* frame,
+                                                   size_t available,
+                                                   bool last,
+                                                   size_t* length) const {
+
+    const Candidate short_frame = last ? Candidate::Rejected : Candidate::Incomplete;
+    const size_t    head        = format_.HeadBytes();
+
+    if(available < head) {
+        return short_frame;
+    }
+
+    size_t index = 1;
+
+    uint8_t sensor = 0;
+    if(format_.sensor_id) {
+        sensor = frame[index++];
+    }
+
+    uint8_t count = 1;
+    if(format_.batching) {
+        count = frame[index++];
+    }
+
+    // N = 0: marker
+    const bool marker = (count == 0);
+    if(marker) {
+        if(!format_.odr_marker || (format_.sensor_id && (sensor != kAllSensors))) {
+            return Candidate::Rejected;
+        }
+    }
+    else if((count > kMaxBatch) || (sensor >= kMaxSensors)) {
+        return Candidate::Rejected;
+    }
+
+    // Length from the head alone: the tail is checked before the samples are decoded
+    size_t payload = 2;
+    if(!marker) {
+        bool complete = true;
+        payload = SamplesBytes(&frame[head], available-head, count, &complete);
+        if(!complete) {
+            return short_frame;
+        }
+        if(payload == 0) {
+            return Candidate::Rejected;
+        }
+    }
+
+    const size_t total = head + payload + format_.TailBytes();
+    if(available < total) {
+        return short_frame;
+    }
+    if(frame[total-1] != kTail) {
+        return Candidate::Rejected;
+    }
+    if(format_.integrity && (Crc8(&frame[1], total-3) != frame[total-2])) {
+        return Candidate::CrcError;
+    }
+
+    // Without CRC, a frame found while looking for the frame boundary must also be
+    // followed by something that can follow a frame
+    if(!format_.integrity && !in_sync_) {
+        if(available == total) {
+            if(!last) {
+                return Candidate::Incomplete;
+            }
+        }
+        else {
+            uint8_t next = frame[total];
+            if((next != kHeader) && (next != kRecordHeader) && (next != kBenchHeader) &&
+               (next != kInstrHeader) && !IsText(next)) {
+                return Candidate::Rejected;
+            }
+        }
+    }
+
+    *length = total;
+    return Candidate::Accepted;
+
+} // end StreamDecoder::CheckFrame
+
+
+/*
+ * Returns the # bytes of the samples of a frame (0 if they cannot be valid).
+ * Only DELTA has to look at them (varints): 'complete' is false if they go
+ * beyond 'available'
+*/
+size_t StreamDecoder::SamplesBytes(const uint8_t* samples,
+                                   size_t available,
+                                   uint8_t count,
+                                   bool* complete) const {
+
+    *complete = true;
+
+    switch(format_.encoding) {
+
+        case Encoding::Raw12:
+            return ((size_t)count*36+7)/8;
+
+        case Encoding::Delta: {
+            // Keyframe, then 3 varints per sample of at most 3 bytes each (16-bit zig-zag)
+            size_t index = 6;
+            if(available < index) {
+                *complete = false;
+                return 0;
+            }
+            for(size_t value = 0; value < (size_t)3*(count-1); value++) {
+                size_t bytes = 0;
+                uint8_t byte;
+                do {
+                    if(index >= available) {
+                        *complete = false;
+                        return 0;
+                    }
+                    byte = samples[index++];
+                    if(++bytes > 3) {
+                        return 0;
+                    }
+                } while(byte & 0x80);
+            }
+            return index;
+        }
+
+        case Encoding::Mms2:
+        default:
+            return (size_t)count*6;
+
+    } // end switch(encoding)
+
+} // end StreamDecoder::SamplesBytes
+
+
+/*
+ * Appends the samples of a frame (already checked) to the columns, written in place
+*/
+__attribute__((always_inline)) // Into DecodeRun (fast path) and TryFrame
+inline void StreamDecoder::AppendSamples(const uint8_t* samples,
+                                         uint8_t count,
+                                         uint8_t sensor,
+                                         uint64_t time_us,
+                                         DecodedStream& out) {
+
+    SampleColumns& columns = out.samples;
+    const size_t   first   = filled_;
+
+    if(first+count > columns.x.size()) {
+        ResizeColumns(columns, first + std::max<size_t>(count, kColumnStep));
+    }
+    filled_ += count;
+
+    float*   x  = &columns.x[first];
+    float*   y  = &columns.y[first];
+    float*   z  = &columns.z[first];
+    uint8_t* id = &columns.sensor[first];
+    for(uint8_t i = 0; i < count; i++) {
+        id[i] = sensor;
+    }
+
+    int16_t raw[kMaxBatch][3];
+
+    switch(format_.encoding) {
+
+        case Encoding::Raw12:
+            for(uint8_t i = 0; i < count; i++) {
+                // Couples of samples in 9 bytes, the second one from the high nibble of the 5th
+                const uint8_t* position = &samples[9*(i>>1)];
+                uint64_t bits = (i & 0x01) ? (Read40(&position[4]) >> 4) : Read40(position);
+                raw[i][0] = SignExtend12(bits);
+                raw[i][1] = SignExtend12(bits>>12);
+                raw[i][2] = SignExtend12(bits>>24);
+                x[i] = raw[i][0]*kCountsToMs2;
+                y[i] = raw[i][1]*kCountsToMs2;
+                z[i] = raw[i][2]*kCountsToMs2;
+            }
+            break;
+
+        case Encoding::Delta: {
+            const uint8_t* position = samples;
+            for(int axis = 0; axis < 3; axis++) {
+                raw[0][axis] = Read16(position);
+                position += 2;
+            }
+            for(uint8_t i = 1; i < count; i++) {
+                for(int axis = 0; axis < 3; axis++) {
+                    uint32_t zigzag = 0;
+                    int      shift  = 0;
+                    uint8_t  byte;
+                    do {
+                        byte    = *position++;
+                        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+                        shift  += 7;
+                    } while(byte & 0x80);
+                    int16_t delta = (int16_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+                    raw[i][axis] = (int16_t)(raw[i-1][axis] + delta);
+                }
+            }
+            for(uint8_t i = 0; i < count; i++) {
+                x[i] = raw[i][0]*kCountsToMs2;
+                y[i] = raw[i][1]*kCountsToMs2;
+                z[i] = raw[i][2]*kCountsToMs2;
+            }
+            break;
+        }
+
+        case Encoding::Mms2:
+        default:
+            for(uint8_t i = 0; i < count; i++) {
+                raw[i][0] = Read16(&samples[6*i]);
+                raw[i][1] = Read16(&samples[6*i+2]);
+                raw[i][2] = Read16(&samples[6*i+4]);
+                x[i] = raw[i][0]*kMms2ToMs2;
+                y[i] = raw[i][1]*kMms2ToMs2;
+                z[i] = raw[i][2]*kMms2ToMs2;
+            }
+            break;
+
+    } // end switch(encoding)
+
+    if(options_.keep_raw) {
+        for(uint8_t i = 0; i < count; i++) {
+            columns.raw_x[first+i] = raw[i][0];
+            columns.raw_y[first+i] = raw[i][1];
+            columns.raw_z[first+i] = raw[i][2];
+        }
+    }
+
+    if(format_.timestamp) {
+        // TIME is the first sample: the others one nominal period apart
+        uint64_t* time = &columns.time_us[first];
+        for(uint8_t i = 0; i < count; i++) {
+            time[i] = time_us + sample_offset_us_[i];
+        }
+    }
+
+} // end StreamDecoder::AppendSamples
+
+
+/*
+ * Sets the size of the columns the decoder fills
+*/
+void StreamDecoder::ResizeColumns(SampleColumns& columns,
+                                  size_t size) const {
+
+    columns.x.resize(size);
+    columns.y.resize(size);
+    columns.z.resize(size);
+    columns.sensor.resize(size);
+    if(format_.timestamp) {
+        columns.time_us.resize(size);
+    }
+    if(options_.keep_raw) {
+        columns.raw_x.resize(size);
+        columns.raw_y.resize(size);
+        columns.raw_z.resize(size);
+    }
+
+} // end StreamDecoder::ResizeColumns
+
+
+/*
+ * New frequency (marker): offsets of the samples of a frame, one nominal period apart
+*/
+void StreamDecoder::SetOdr(uint16_t odr) {
+
+    odr_ = odr;
+    for(size_t i = 0; i < kMaxBatch; i++) {
+        sample_offset_us_[i] = odr ? (uint32_t)(i*1000000/odr) : 0;
+    }
+
+} // end StreamDecoder::SetOdr
+
+
+/*
+ * Accounts the sequence number of a frame: gaps not explained by corrupted frames are losses
+*/
+void StreamDecoder::AccountSequence(uint8_t sequence) {
+
+    if(has_seq_) {
+
+        uint32_t gap = (uint8_t)(sequence - next_seq_);
+        uint32_t lost = (gap > corrupted_since_good_) ? gap - corrupted_since_good_ : 0;
+
+        if(lost > 0) {
+            stats_.lost_packets += lost;
+            stats_.sequence_gaps++;
+            stats_.loss_bursts[std::min<size_t>(lost, kLossBuckets)-1]++;
+        }
+
+    } // end if(has_seq_)
+
+    has_seq_  = true;
+    next_seq_ = (uint8_t)(sequence+1);
+
+} // end StreamDecoder::AccountSequence
+
+
+/*
+ * Rebuilds the 64-bit time from the 24-bit TIME of an ID
+*/
+uint64_t StreamDecoder::Unwrap(uint8_t id, uint32_t time24) {
+
+    if(!has_time_[id]) {
+        has_time_[id] = true;
+        time64_[id]   = time24;
+    }
+    else {
+        time64_[id] += (time24 - last_time24_[id]) & 0xFFFFFF;
+    }
+    last_time24_[id] = time24;
+
+    return time64_[id];
+
+} // end StreamDecoder::Unwrap
+
+
+/*
+ * Decodes a whole file, mapped in memory
+*/
+bool StreamDecoder::DecodeFile(const std::string& path,
+                               DecodedStream& out,
+                               std::string* error) {
+
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0) {
+        if(error) {
+            *error = path + ": " + strerror(errno);
+        }
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) != 0) {
+        if(error) {
+            *error = path + ": " + strerror(errno);
+        }
+        close(file);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    if(size == 0) {
+        close(file);
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(mapped == MAP_FAILED) {
+        if(error) {
+            *error = path + ": " + strerror(errno);
+        }
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    Decode((const uint8_t*)mapped, size, out, true);
+
+    munmap(mapped, size);
+    return true;
+
+} // end StreamDecoder::DecodeFile
+
+} // namespace lis3dh
+
+/* [] END OF FILE */
@@ -0,0 +1,242 @@
+/* ========================================
+ *
+ * \file  StreamDecoder.h
+ * \brief Host decoder of the frame stream sent by the firmware via UART
+ *
+ * Every variant of "Packet.h": PACKET_SENSOR_ID, PACKET_BATCHING, PACKET_INTEGRITY,
+ * PACKET_TIMESTAMP, PACKET_ODR_MARKER, and the MMS2/RAW12/DELTA encodings. The build
+ * options are not in the stream: they are given at runtime (FrameFormat).
+ *
+ * Single pass, zero-copy: the frames are parsed where they lie (a mapped capture or
+ * a read buffer), the samples are decoded straight into columns (one vector per axis,
+ * grown a few thousand samples at a time). In sync, the frames of samples that follow
+ * each other are checked and decoded by a tight loop (DecodeRun); the rest (markers,
+ * text, records, damaged frames) goes through the byte by byte search.
+ * Resynchronisation as described in BRIDGE_CONTROL_PANEL_CONFIG_FILES/README.txt:
+ * a frame is accepted only if its tail (and CRC) match; text lines and the binary
+ * records of the 'P'/'B' commands (0xB0/0xB1/0xB2 ... 0xC0) in between are skipped.
+ *
+ * ========================================
+*/
+
+#ifndef __STREAM_DECODER_H_
+    #define __STREAM_DECODER_H_
+
+    #include <array>
+    #include <cstddef>
+    #include <cstdint>
+    #include <string>
+    #include <vector>
+
+    namespace lis3dh {
+
+    // Defines (see "Packet.h" and "Profiler.h")
+    constexpr uint8_t kHeader        = 0xA0;
+    constexpr uint8_t kTail          = 0xC0;
+    constexpr uint8_t kAllSensors    = 0xFF; // ID of the ODR markers
+    constexpr uint8_t kMaxBatch      = 16;
+    constexpr uint8_t kMaxSensors    = 2;
+    constexpr uint8_t kRecordHeader  = 0xB0; // Profiler stage record ('P')
+    constexpr uint8_t kBenchHeader   = 0xB1; // Profiler benchmark record ('B'), cycles
+    constexpr uint8_t kInstrHeader   = 0xB2; // Profiler benchmark record ('B'), instructions
+    constexpr size_t  kRecordSize    = 1+1+4*4+2*24+1;
+    constexpr size_t  kLossBuckets   = 17;   // Bursts of 1 ... 16 packets, then >= 17
+
+    // Encoding of the samples (values of PACKET_ENCODING)
+    enum class Encoding : uint8_t {
+        Mms2  = 0, // int16 mm/s^2
+        Raw12 = 1, // 12-bit counts, 2 samples every 9 bytes
+        Delta = 2  // keyframe + zig-zag varint differences
+    };
+
+    // Build options of the firmware the stream comes from
+    struct FrameFormat {
+        bool     sensor_id  = false; // PACKET_SENSOR_ID
+        bool     batching   = false; // PACKET_BATCHING
+        bool     integrity  = false; // PACKET_INTEGRITY
+        bool     odr_marker = false; // PACKET_ODR_MARKER
+        bool     timestamp  = false; // PACKET_TIMESTAMP
+        Encoding encoding   = Encoding::Mms2;
+
+        // Bytes before the samples: header, [ID], [N], [SEQ], [TIME]
+        size_t HeadBytes() const {
+            return 1 + sensor_id + batching + integrity + 3*timestamp;
+        }
+
+        // Bytes after the samples: [CRC], tail
+        size_t TailBytes() const {
+            return 1 + integrity;
+        }
+
+        // Same constraints as the #error of "Packet.h". Returns "" if the format is valid
+        std::string Check() const;
+
+        // Comma separated options, e.g. "batching,integrity,raw12" ("" --> default format):
+        // id, batching, integrity, marker, time, mms2, raw12, delta. Returns false if an
+        // option is unknown
+        bool Parse(const std::string& options);
+
+        std::string ToString() const;
+    };
+
+    // Samples decoded, one column per field: sample i is x[i], y[i], z[i] ...
+    struct SampleColumns {
+        std::vector<float>    x, y, z;  // [m/s^2]
+        std::vector<uint8_t>  sensor;   // ID (0 without PACKET_SENSOR_ID)
+        std::vector<uint64_t> time_us;  // PACKET_TIMESTAMP only: time of the packet + one period
+                                        // (from the last marker) per sample after the first one
+        std::vector<int16_t>  raw_x, raw_y, raw_z; // keep_raw only: mm/s^2 (MMS2) or counts
+
+        size_t size() const {
+            return x.size();
+        }
+        void clear();
+    };
+
+    // One frame of the stream
+    struct PacketInfo {
+        uint64_t offset;       // Position of the header in the stream
+        uint64_t first_sample; // Index of its first sample in SampleColumns
+        uint64_t time_us;      // Rebuilt 64-bit time (0 without PACKET_TIMESTAMP)
+        uint16_t odr;          // [Hz] Marker: new frequency. Samples: last marker (0 if none yet)
+        uint8_t  sensor;       // ID (kAllSensors for a marker)
+        uint8_t  count;        // # samples (0 for a marker)
+        uint8_t  sequence;     // SEQ (0 without PACKET_INTEGRITY)
+        uint16_t length;       // Bytes of the frame, header to tail
+    };
+
+    // Output of the decoder
+    struct DecodedStream {
+        SampleColumns           samples;
+        std::vector<PacketInfo> markers;  // ODR markers (always kept)
+        std::vector<PacketInfo> packets;  // Frames of samples (keep_packets only)
+        std::string             text;     // Text skipped between the frames (keep_text only)
+
+        void clear();
+    };
+
+    // Counters of the decoder
+    struct DecoderStats {
+        uint64_t bytes          = 0; // Bytes consumed
+        uint64_t frames         = 0; // Frames of samples accepted
+        uint64_t markers        = 0; // ODR markers accepted
+        uint64_t samples        = 0;
+        uint64_t records        = 0; // 0xB0/0xB1/0xB2 records skipped
+        uint64_t text_bytes     = 0; // Printable bytes skipped (report lines)
+        uint64_t skipped_bytes  = 0; // Other bytes skipped to find a frame again
+        uint64_t corrupted      = 0; // Frames expected at a position that failed the checks
+                                     // (wrong tail or CRC, N or ID out of range, header lost)
+        uint64_t crc_errors     = 0; // Of which: right length and tail, wrong CRC
+        uint64_t lost_packets   = 0; // SEQ not seen and not explained by a corrupted frame
+                                     // (PACKET_INTEGRITY; a gap of 256 packets is not seen)
+        uint64_t sequence_gaps  = 0; // # places where packets have been lost
+        std::array<uint64_t, kLossBuckets> loss_bursts{}; // [n-1] # gaps of n packets
+    };
+
+    class StreamDecoder {
+    public:
+
+        struct Options {
+            bool keep_raw     = false; // Fill raw_x/raw_y/raw_z
+            bool keep_packets = false; // Fill DecodedStream::packets
+            bool keep_text    = false; // Fill DecodedStream::text (replies to the UART commands)
+        };
+
+        explicit StreamDecoder(const FrameFormat& format);
+        StreamDecoder(const FrameFormat& format, const Options& options);
+
+        /*
+         * Decodes the frames found in a chunk of the stream and appends them to 'out'.
+         * Returns the # bytes consumed: the rest is the beginning of a frame that is not
+         * complete yet, to be given again at the beginning of the next chunk. With
+         * 'last' true nothing is left behind (end of the stream).
+        */
+        size_t Decode(const uint8_t* data,
+                      size_t size,
+                      DecodedStream& out,
+                      bool last = false);
+
+        // Whole file, mapped in memory. Returns false (and 'error') if it cannot be read
+        bool DecodeFile(const std::string& path,
+                        DecodedStream& out,
+                        std::string* error = nullptr);
+
+        const DecoderStats& stats() const {
+            return stats_;
+        }
+
+        const FrameFormat& format() const {
+            return format_;
+        }
+
+    private:
+
+        enum class Candidate { Accepted, Rejected, CrcError, Incomplete };
+
+        size_t    DecodeRun(const uint8_t* data,
+                            size_t size,
+                            uint64_t offset,
+                            DecodedStream& out);
+        Candidate TryFrame(const uint8_t* frame,
+                           size_t available,
+                           bool last,
+                           uint64_t offset,
+                           size_t* length,
+                           DecodedStream& out);
+        void      AcceptFrame(const uint8_t* frame,
+                              size_t length,
+                              uint64_t offset,
+                              DecodedStream& out);
+        Candidate CheckFrame(const uint8_t* frame,
+                             size_t available,
+                             bool last,
+                             size_t* length) const;
+        Candidate HiddenFrame(const uint8_t* record,
+                              size_t available,
+                              bool last) const;
+        size_t    SamplesBytes(const uint8_t* samples,
+                               size_t available,
+                               uint8_t count,
+                               bool* complete) const;
+        void      AppendSamples(const uint8_t* samples,
+                                uint8_t count,
+                                uint8_t sensor,
+                                uint64_t time_us,
+                                DecodedStream& out);
+        void      ResizeColumns(SampleColumns& columns,
+                                size_t size) const;
+        void      SetOdr(uint16_t odr);
+        void      AccountSequence(uint8_t sequence);
+        uint64_t  Unwrap(uint8_t id, uint32_t time24);
+
+        FrameFormat  format_;
+        Options      options_;
+        DecoderStats stats_;
+
+        uint64_t position_    = 0;     // Offset of the chunk in the stream
+        bool     in_sync_     = false; // The previous frame ended where the next one starts
+        bool     has_seq_     = false;
+        uint8_t  next_seq_    = 0;
+        uint32_t corrupted_since_good_ = 0;
+        uint16_t odr_         = 0;     // [Hz] From the last marker
+        size_t   filled_      = 0;     // Samples in the columns (larger during Decode)
+
+        // [bytes] Samples of a frame of N samples (MMS2, RAW12: 0 for DELTA, scanned)
+        std::array<uint16_t, kMaxBatch+1> payload_bytes_{};
+        // [us] Time of sample i of a frame after the first one, at odr_
+        std::array<uint32_t, kMaxBatch>   sample_offset_us_{};
+
+        // Time rebuilt per ID (0, 1 and markers)
+        std::array<bool, kMaxSensors+1>     has_time_{};
+        std::array<uint32_t, kMaxSensors+1> last_time24_{};
+        std::array<uint64_t, kMaxSensors+1> time64_{};
+    };
+
+    // CRC-8 of the firmware (polynomial 0x07, initial value 0x00)
+    uint8_t Crc8(const uint8_t* data, size_t length);
+
+    } // namespace lis3dh
+
+#endif
+
+/* [] END OF FILE */
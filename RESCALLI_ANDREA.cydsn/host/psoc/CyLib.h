@@ -0,0 +1,53 @@
+/* ========================================
+ *
+ * \file  CyLib.h
+ * \brief Host stand-in for the CyLib.h of PSoC Creator (cy_boot)
+ *
+ * Delays, SysTick, global interrupts and WFI act on the virtual time of the
+ * board model (see "../board/Board.h")
+ *
+ * ========================================
+*/
+
+#ifndef CY_BOOT_CYLIB_H
+    #define CY_BOOT_CYLIB_H
+    
+    #include "cytypes.h"
+    
+    #define BCLK__BUS_CLK__HZ  24000000u  // BUS_CLK of the TopDesign
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    typedef void (*cySysTickCallback)(void);
+    
+    #define CY_SYS_SYST_NUM_OF_CALLBACKS  5u
+    
+    void CyDelay(uint32 milliseconds);
+    void CyDelayUs(uint16 microseconds);
+    
+    void  CySysTickStart(void);
+    void  CySysTickStop(void);
+    uint32 CySysTickGetValue(void);
+    uint32 CySysTickGetReload(void);
+    cySysTickCallback CySysTickSetCallback(uint32 number, cySysTickCallback function);
+    
+    uint8 CyEnterCriticalSection(void);
+    void  CyExitCriticalSection(uint8 savedIntrStatus);
+    
+    void Host_InterruptsEnable(void);
+    void Host_InterruptsDisable(void);
+    void Host_WaitForInterrupt(void);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+    #define CyGlobalIntEnable   do { Host_InterruptsEnable(); } while(0)
+    #define CyGlobalIntDisable  do { Host_InterruptsDisable(); } while(0)
+    #define CY_PM_WFI           Host_WaitForInterrupt()
+    
+#endif
+
+/* [] END OF FILE */
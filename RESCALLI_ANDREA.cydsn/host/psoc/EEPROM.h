@@ -0,0 +1,40 @@
+/* ========================================
+ *
+ * \file  EEPROM.h
+ * \brief Host stand-in for the API of the EEPROM component (2 KB, 16-byte rows)
+ *
+ * ========================================
+*/
+
+#ifndef CY_EEPROM_EEPROM_H
+    #define CY_EEPROM_EEPROM_H
+    
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "CyLib.h"
+    
+    #define CYDEV_EE_SIZE           2048u
+    #define CYDEV_EEPROM_ROW_SIZE   16u
+    #define CY_EEPROM_SIZEOF_ROW    CYDEV_EEPROM_ROW_SIZE
+    #define CY_EEPROM_NUMBER_ROWS   (CYDEV_EE_SIZE/CYDEV_EEPROM_ROW_SIZE)
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    void     EEPROM_Start(void);
+    void     EEPROM_Stop(void);
+    uint8    EEPROM_ReadByte(uint16 address);
+    cystatus EEPROM_WriteByte(uint8 dataByte, uint16 address);
+    cystatus EEPROM_Write(const uint8* rowData, uint8 rowNumber);
+    cystatus EEPROM_StartWrite(const uint8* rowData, uint8 rowNumber);
+    cystatus EEPROM_Query(void);
+    cystatus EEPROM_UpdateTemperature(void);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,29 @@
+/* ========================================
+ *
+ * \file  ISR_DataReady.h
+ * \brief Host stand-in for the API of the ISR_DataReady component (LIS3DH INT1, rising edge)
+ *
+ * ========================================
+*/
+
+#ifndef CY_ISR_ISR_DataReady_H
+    #define CY_ISR_ISR_DataReady_H
+    
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "CyLib.h"
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    void ISR_DataReady_StartEx(cyisraddress address);
+    void ISR_DataReady_Stop(void);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
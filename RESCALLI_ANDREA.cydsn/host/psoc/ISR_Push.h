@@ -0,0 +1,29 @@
+/* ========================================
+ *
+ * \file  ISR_Push.h
+ * \brief Host stand-in for the API of the ISR_Push component (button, rising edge)
+ *
+ * ========================================
+*/
+
+#ifndef CY_ISR_ISR_Push_H
+    #define CY_ISR_ISR_Push_H
+    
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "CyLib.h"
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    void ISR_Push_StartEx(cyisraddress address);
+    void ISR_Push_Stop(void);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,43 @@
+/* ========================================
+ *
+ * \file  UART.h
+ * \brief Host stand-in for the API of the UART component (19200 8N1, 4-byte TX FIFO,
+ *        no software buffer)
+ *
+ * ========================================
+*/
+
+#ifndef CY_UART_UART_H
+    #define CY_UART_UART_H
+    
+    #include "cytypes.h"
+    #include "cyfitter.h"
+    #include "CyLib.h"
+    
+    #define UART_TX_STS_COMPLETE       (0x01u)
+    #define UART_TX_STS_FIFO_EMPTY     (0x02u)
+    #define UART_TX_STS_FIFO_FULL      (0x04u)
+    #define UART_TX_STS_FIFO_NOT_FULL  (0x08u)
+    
+    #define UART_TX_FIFO_SIZE          (4u)
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    void  UART_Start(void);
+    void  UART_Stop(void);
+    void  UART_PutChar(uint8 txDataByte);
+    void  UART_PutString(const char8* string);
+    void  UART_PutArray(const uint8* string, uint8 byteCount);
+    void  UART_PutCRLF(uint8 txDataByte);
+    uint8 UART_ReadTxStatus(void);
+    uint8 UART_GetChar(void);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,21 @@
+/* ========================================
+ *
+ * \file  cyfitter.h
+ * \brief Host stand-in for the cyfitter.h generated by PSoC Creator
+ *
+ * The board model has what the firmware expects from the TopDesign, plus the
+ * INT1 input and ISR_DataReady needed by ACQUISITION_INTERRUPT (see main.c):
+ * the TopDesign of the project does not have them yet. No DMA_TX (TX_USE_DMA 0)
+ *
+ * ========================================
+*/
+
+#ifndef INCLUDED_CYFITTER_H
+    #define INCLUDED_CYFITTER_H
+    
+    #define ISR_Push__INTC_NUMBER       0u
+    #define ISR_DataReady__INTC_NUMBER  1u
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,73 @@
+/* ========================================
+ *
+ * \file  cytypes.h
+ * \brief Host stand-in for the cytypes.h generated by PSoC Creator
+ *
+ * Only what the firmware of RESCALLI_ANDREA.cydsn uses. The register accesses
+ * that matter (SysTick, SCB, DWT) go to the board model (see "../board/Board.h")
+ *
+ * ========================================
+*/
+
+#ifndef CY_BOOT_CYTYPES_H
+    #define CY_BOOT_CYTYPES_H
+    
+    #include <stdint.h>
+    #include <stddef.h>
+    
+    typedef uint8_t  uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int8_t   int8;
+    typedef int16_t  int16;
+    typedef int32_t  int32;
+    typedef char     char8;
+    typedef float    float32;
+    typedef double   float64;
+    
+    typedef volatile uint8  reg8;
+    typedef volatile uint16 reg16;
+    typedef volatile uint32 reg32;
+    
+    typedef uint32 cystatus;
+    
+    #define CYRET_SUCCESS        (0x00u)
+    #define CYRET_BAD_PARAM      (0x01u)
+    #define CYRET_INVALID_OBJECT (0x02u)
+    #define CYRET_MEMORY         (0x03u)
+    #define CYRET_LOCKED         (0x04u)
+    #define CYRET_EMPTY          (0x05u)
+    #define CYRET_BAD_DATA       (0x06u)
+    #define CYRET_STARTED        (0x07u)
+    #define CYRET_FINISHED       (0x08u)
+    #define CYRET_CANCELED       (0x09u)
+    #define CYRET_TIMEOUT        (0x10u)
+    #define CYRET_INVALID_STATE  (0x11u)
+    
+    #define CY_ISR(FuncName)        void FuncName(void)
+    #define CY_ISR_PROTO(FuncName)  void FuncName(void)
+    typedef void (*cyisraddress)(void);
+    
+    #define LO8(x)  ((uint8) ((x) & 0xFFu))
+    #define HI8(x)  ((uint8) ((uint16)(x) >> 8))
+    #define LO16(x) ((uint16) ((x) & 0xFFFFu))
+    #define HI16(x) ((uint16) ((uint32)(x) >> 16))
+    
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+    
+    // Core registers of the board model (SysTick, SCB, DWT): see "../board/Board.h"
+    uint32 Host_ReadReg32(uint32 address);
+    void   Host_WriteReg32(uint32 address, uint32 value);
+    
+    #ifdef __cplusplus
+    }
+    #endif
+    
+    #define CY_GET_REG32(addr)         Host_ReadReg32((uint32)(uintptr_t)(addr))
+    #define CY_SET_REG32(addr, value)  Host_WriteReg32((uint32)(uintptr_t)(addr), (uint32)(value))
+    
+#endif
+
+/* [] END OF FILE */
@@ -0,0 +1,18 @@
+/* ========================================
+ *
+ * \file  project.h
+ * \brief Host stand-in for the project.h generated by PSoC Creator
+ *
+ * ========================================
+*/
+
+#include "cyfitter.h"
+#include "cytypes.h"
+#include "CyLib.h"
+#include "EEPROM.h"
+#include "I2C_Master.h"
+#include "ISR_DataReady.h"
+#include "ISR_Push.h"
+#include "UART.h"
+
+/* [] END OF FILE */
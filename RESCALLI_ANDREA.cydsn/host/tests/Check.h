@@ -0,0 +1,91 @@
+/* ========================================
+ *
+ * \file  Check.h
+ * \brief Minimal test harness of the host tests (no dependencies)
+ *
+ * TEST(name) { ... CHECK(condition); CHECK_EQUAL(a, b); ... }
+ * The tests register themselves; CHECK_MAIN() runs them all and returns the #
+ * failed checks as exit code
+ *
+ * ========================================
+*/
+
+#ifndef __CHECK_H_
+    #define __CHECK_H_
+
+    #include <cstdio>
+    #include <cstring>
+    #include <vector>
+
+    namespace check {
+
+    struct Test {
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<Test>& Tests() {
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    inline int& Failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    struct Register {
+        Register(const char* name, void (*run)()) {
+            Tests().push_back({name, run});
+        }
+    };
+
+    // Runs the tests whose name contains 'filter' (all if null)
+    inline int RunAll(const char* filter) {
+        int run = 0;
+        for(const Test& test : Tests()) {
+            if(filter && !strstr(test.name, filter)) {
+                continue;
+            }
+            int before = Failures();
+            test.run();
+            printf("%-48s %s\n", test.name, (Failures() == before) ? "ok" : "FAILED");
+            run++;
+        }
+        printf("%d tests, %d failed checks\n", run, Failures());
+        return Failures() ? 1 : 0;
+    }
+
+    } // namespace check
+
+    #define TEST(name) \
+        static void name(); \
+        static check::Register name##_register(#name, name); \
+        static void name()
+
+    #define CHECK(condition) \
+        do { \
+            if(!(condition)) { \
+                printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+                check::Failures()++; \
+            } \
+        } while(0)
+
+    #define CHECK_EQUAL(expected, actual) \
+        do { \
+            long long expected_ = (long long)(expected); \
+            long long actual_   = (long long)(actual); \
+            if(expected_ != actual_) { \
+                printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+                check::Failures()++; \
+            } \
+        } while(0)
+
+    #define CHECK_MAIN() \
+        int main(int argc, char** argv) { \
+            return check::RunAll((argc > 1) ? argv[1] : nullptr); \
+        }
+
+#endif
+
+/* [] END OF FILE */
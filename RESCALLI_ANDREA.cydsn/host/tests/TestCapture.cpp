@@ -0,0 +1,194 @@
+/* ========================================
+ *
+ * \file  TestCapture.cpp
+ * \brief Capture files: writer and reader against the decoder on the whole stream
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Capture.h"
+#include "Check.h"
+#include "FrameEncoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+using namespace lis3dh;
+
+
+namespace {
+
+const char* kPath = "build/test_capture.cap";
+
+// Stream with 'packets' batches of 'count' samples, a marker (ODR 100, 200, ...) every 'every' packets
+std::vector<uint8_t> MakeStream(const FrameFormat& format, size_t packets, uint8_t count, size_t every) {
+
+    FrameEncoder encoder(format);
+    std::vector<uint8_t> stream;
+    int16_t  samples[kMaxBatch][3];
+    uint32_t time = 0;
+    for(size_t packet = 0; packet < packets; packet++) {
+        if(format.odr_marker && (packet % every == 0)) {
+            encoder.Marker((uint16_t)(100*(packet/every + 1)), time, stream);
+        }
+        for(uint8_t i = 0; i < count; i++) {
+            int16_t value = (int16_t)((packet*count + i) % 4000 - 2000);
+            samples[i][0] = value;
+            samples[i][1] = (int16_t)-value;
+            samples[i][2] = (int16_t)(value/2);
+        }
+        encoder.Samples((uint8_t)(packet % (format.sensor_id ? kMaxSensors : 1)), samples, count, time, stream);
+        time += count*1000;
+    }
+    return stream;
+
+} // end MakeStream
+
+
+// Writes the stream in chunks of random sizes, 1 ms of host time per chunk
+bool WriteCapture(const FrameFormat& format, const std::vector<uint8_t>& stream, uint32_t block_samples) {
+
+    std::mt19937  random(5);
+    CaptureWriter writer(format, block_samples);
+    if(!writer.Open(kPath)) {
+        return false;
+    }
+    int64_t host_ns = 1000000000;
+    for(size_t position = 0; position < stream.size(); host_ns += 1000000) {
+        size_t size = std::min<size_t>(stream.size() - position, 1 + random() % 300);
+        if(!writer.Append(&stream[position], size, host_ns)) {
+            return false;
+        }
+        position += size;
+    }
+    return writer.Close();
+
+} // end WriteCapture
+
+
+void CheckSameSamples(const FrameFormat& format, uint32_t block_samples) {
+
+    std::vector<uint8_t> stream = MakeStream(format, 3000, format.batching ? 7 : 1, 500);
+    CHECK(WriteCapture(format, stream, block_samples));
+
+    StreamDecoder decoder(format);
+    DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+
+    CaptureReader reader;
+    std::string   error;
+    CHECK(reader.Open(kPath, &error));
+    if(!error.empty()) {
+        printf("%s\n", error.c_str());
+        return;
+    }
+    CHECK_EQUAL(decoded.samples.size(), reader.samples());
+    CHECK_EQUAL((reader.samples() + block_samples-1)/block_samples, reader.blocks());
+    CHECK_EQUAL(decoder.stats().frames, reader.header().frames);
+    CHECK_EQUAL(decoder.stats().markers, reader.header().markers);
+
+    SampleColumns read;
+    CHECK_EQUAL(reader.samples(), reader.Read(0, reader.samples() + 100, read));
+    CHECK(read.x == decoded.samples.x);
+    CHECK(read.y == decoded.samples.y);
+    CHECK(read.z == decoded.samples.z);
+    CHECK(read.sensor == decoded.samples.sensor);
+    CHECK(read.time_us == decoded.samples.time_us);
+
+    // Across a block boundary, from the block columns
+    SampleColumns part;
+    CHECK_EQUAL(10, reader.Read(block_samples - 5, 10, part));
+    CHECK(std::equal(part.x.begin(), part.x.end(), decoded.samples.x.begin() + block_samples - 5));
+    CaptureBlock last = reader.Block(reader.blocks()-1);
+    CHECK_EQUAL(reader.samples() - last.first, last.count);
+    CHECK_EQUAL(decoded.samples.z.back(), last.z[last.count-1]);
+}
+
+} // namespace
+
+
+TEST(samples_as_decoded) {
+    FrameFormat format;
+    format.Parse("batching,integrity,marker,time");
+    CheckSameSamples(format, 64);
+    CheckSameSamples(format, kCaptureBlockSamples);
+}
+
+TEST(samples_as_decoded_default_format) {
+    FrameFormat format;
+    format.Parse("default");
+    CheckSameSamples(format, 8);
+}
+
+TEST(index_of_markers_and_host_time) {
+    FrameFormat format;
+    format.Parse("id,batching,integrity,marker");
+    std::vector<uint8_t> stream = MakeStream(format, 3000, 4, 500);
+    CHECK(WriteCapture(format, stream, 256));
+
+    StreamDecoder decoder(format);
+    DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+
+    CaptureReader reader;
+    CHECK(reader.Open(kPath));
+    CHECK_EQUAL(6, decoded.markers.size());
+    for(const PacketInfo& marker : decoded.markers) {
+        CHECK_EQUAL(marker.odr, reader.OdrOfSample(marker.first_sample));
+        if(marker.first_sample > 0) {
+            CHECK_EQUAL(marker.odr - 100, reader.OdrOfSample(marker.first_sample - 1));
+        }
+    }
+
+    // Entries in sample order, host time exact at each of them and monotonic in between
+    size_t blocks = 0;
+    for(size_t i = 0; i < reader.index_entries(); i++) {
+        const CaptureIndexEntry& entry = reader.index()[i];
+        blocks += (entry.kind == IndexKind::Block);
+        if(i > 0) {
+            CHECK(entry.sample >= reader.index()[i-1].sample);
+            CHECK(entry.host_ns >= reader.index()[i-1].host_ns);
+        }
+    }
+    CHECK_EQUAL(reader.blocks(), blocks);
+
+    uint64_t previous = 0;
+    int64_t  start    = reader.header().start_host_ns;
+    for(int64_t t = start - 1000000; t <= reader.header().end_host_ns + 1000000; t += 250000) {
+        uint64_t sample = reader.SampleAtHostTime(t);
+        CHECK(sample >= previous);
+        CHECK(sample <= reader.samples());
+        previous = sample;
+    }
+    CHECK_EQUAL(0, reader.SampleAtHostTime(start - 1));
+    CHECK_EQUAL(reader.samples(), reader.SampleAtHostTime(reader.header().end_host_ns + 1));
+}
+
+TEST(invalid_files_rejected) {
+    CaptureReader reader;
+    std::string   error;
+    CHECK(!reader.Open("build/no_such_file.cap", &error));
+    CHECK(!error.empty());
+
+    // A capture cut short (e.g. the writer did not close)
+    FrameFormat format;
+    format.Parse("batching");
+    CHECK(WriteCapture(format, MakeStream(format, 100, 4, 50), 8));
+    CHECK(reader.Open(kPath));
+    reader.Close();
+    CHECK_EQUAL(0, truncate(kPath, 8000));
+    CHECK(!reader.Open(kPath, &error));
+
+    FILE* file = fopen(kPath, "wb");
+    fprintf(file, "A0 01 02 C0 not a capture, but longer than a page%4096s", "");
+    fclose(file);
+    CHECK(!reader.Open(kPath, &error));
+    remove(kPath);
+}
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
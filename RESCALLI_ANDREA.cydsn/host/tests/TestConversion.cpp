@@ -0,0 +1,80 @@
+/* ========================================
+ *
+ * \file  TestConversion.cpp
+ * \brief Exhaustive test of the integer conversion of the firmware ("Conversion.c")
+ *
+ * Every operating mode, every possible content of an OUT_x_L/OUT_x_H couple
+ * (65536 values: every count of the mode, with every value of the unused low bits)
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Check.h"
+
+extern "C" {
+    #include "Conversion.h"
+}
+
+#include <cstdint>
+
+namespace {
+
+const int kMgPerDigit[CONVERSION_RESOLUTIONS][CONVERSION_FULL_SCALES] = {
+    { 1,  2,  4,  12},  // High resolution
+    { 4,  8, 16,  48},  // Normal
+    {16, 32, 64, 192}   // Low power
+};
+const int kBits[CONVERSION_RESOLUTIONS] = {12, 10, 8};
+
+int32_t Convert(uint16_t raw) {
+    uint8_t bytes[2] = {(uint8_t)(raw & 0xFF), (uint8_t)(raw >> 8)};
+    return Conversion_ToMilliMs2(bytes);
+}
+
+// Former code of main.c (float, HR +-2g): conv = OutAcc/DIGIT_TO_G*G_TO_MS2; OutAcc = (int16_t)(conv*1000)
+int16_t FormerFloat(int16_t counts) {
+    volatile float conv = counts/1000.0*9.81;
+    return (int16_t)(conv*1000);
+}
+
+} // namespace
+
+
+TEST(every_input_exact) {
+    for(uint8_t resolution = 0; resolution < CONVERSION_RESOLUTIONS; resolution++) {
+        for(uint8_t full_scale = 0; full_scale < CONVERSION_FULL_SCALES; full_scale++) {
+            Conversion_SetMode(resolution, full_scale);
+            int errors = 0;
+            for(uint32_t raw = 0; raw < 65536; raw++) {
+                int32_t counts = (int16_t)raw >> (16-kBits[resolution]);
+                // mm/s^2 = counts * mg/digit * 9.81, truncated towards zero
+                int32_t exact  = counts*kMgPerDigit[resolution][full_scale]*981/100;
+                errors += (Convert((uint16_t)raw) != exact);
+            }
+            CHECK_EQUAL(0, errors);
+        }
+    }
+}
+
+TEST(high_resolution_2g_matches_former_float) {
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FS_2G);
+    int errors = 0;
+    for(int32_t counts = -2048; counts < 2048; counts++) {
+        errors += (Convert((uint16_t)(counts << 4)) != FormerFloat((int16_t)counts));
+    }
+    CHECK_EQUAL(0, errors);
+}
+
+TEST(invalid_mode_ignored) {
+    Conversion_SetMode(CONVERSION_LOW_POWER, CONVERSION_FS_16G);
+    Conversion_SetMode(CONVERSION_RESOLUTIONS, CONVERSION_FS_2G);
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FULL_SCALES);
+    // Still LP +-16g: 1 digit = 192 mg
+    CHECK_EQUAL(1883, Convert(0x0100));
+    CHECK_EQUAL(-1883, Convert(0xFF00));
+}
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
@@ -0,0 +1,461 @@
+/* ========================================
+ *
+ * \file  TestDecoder.cpp
+ * \brief Tests of the host decoder (host/decoder), every PACKET_* variant
+ *
+ * The streams are built by FrameEncoder; the tests of the firmware encoder
+ * ("Packet.c" built for the host) decode its output with the same decoder
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Check.h"
+#include "FrameEncoder.h"
+#include "StreamDecoder.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+
+using namespace lis3dh;
+
+
+namespace {
+
+// Every valid combination of the build options
+std::vector<FrameFormat> AllFormats() {
+
+    std::vector<FrameFormat> formats;
+    for(int options = 0; options < 32*3; options++) {
+        FrameFormat format;
+        format.sensor_id  = options & 0x01;
+        format.batching   = options & 0x02;
+        format.integrity  = options & 0x04;
+        format.odr_marker = options & 0x08;
+        format.timestamp  = options & 0x10;
+        format.encoding   = (Encoding)(options/32);
+        if(format.Check().empty()) {
+            formats.push_back(format);
+        }
+    }
+    return formats;
+
+} // end AllFormats
+
+
+struct Frame {
+    uint8_t sensor;
+    uint8_t count;
+    int16_t samples[kMaxBatch][3];
+};
+
+
+// Stream of 'frames' random frames (a marker first if the format has them)
+struct TestStream {
+    std::vector<uint8_t> bytes;
+    std::vector<Frame>   frames;
+    std::vector<size_t>  offsets; // Of the frames of samples
+};
+
+TestStream MakeStream(const FrameFormat& format, size_t frames, uint32_t seed, uint16_t odr = 100) {
+
+    std::mt19937 random(seed);
+    FrameEncoder encoder(format);
+    TestStream   stream;
+
+    // 12-bit counts for RAW12/DELTA, mm/s^2 (+-2 g) for MMS2. Smooth signal, so that
+    // DELTA also writes 1-byte differences, with jumps for the 2-byte ones
+    int limit = (format.encoding == Encoding::Mms2) ? 19620 : 2047;
+    int value[3] = {0, 0, limit/2};
+
+    uint32_t time = 0xFFF000; // Wraps after a few frames
+    if(format.odr_marker) {
+        encoder.Marker(odr, time, stream.bytes);
+    }
+
+    for(size_t index = 0; index < frames; index++) {
+        Frame frame;
+        frame.sensor = format.sensor_id ? (uint8_t)(random() % kMaxSensors) : 0;
+        frame.count  = format.batching ? (uint8_t)(1 + random() % kMaxBatch) : 1;
+        for(uint8_t i = 0; i < frame.count; i++) {
+            for(int axis = 0; axis < 3; axis++) {
+                int step = (random() % 8 == 0) ? (int)(random() % (2*limit+1)) - limit : (int)(random() % 61) - 30;
+                value[axis] = std::max(-limit-1, std::min(limit, value[axis] + step));
+                frame.samples[i][axis] = (int16_t)value[axis];
+            }
+        }
+        stream.offsets.push_back(stream.bytes.size());
+        encoder.Samples(frame.sensor, frame.samples, frame.count, time, stream.bytes);
+        stream.frames.push_back(frame);
+        time += frame.count*10000;
+    }
+    return stream;
+
+} // end MakeStream
+
+
+// The decoded samples are the ones of the frames, in order
+void CheckSamples(const FrameFormat& format, const TestStream& stream, const DecodedStream& decoded) {
+
+    float scale = (format.encoding == Encoding::Mms2) ? 0.001f : 0.00981f;
+    size_t sample = 0;
+    for(const Frame& frame : stream.frames) {
+        for(uint8_t i = 0; i < frame.count; i++, sample++) {
+            if(sample >= decoded.samples.size()) {
+                CHECK(sample < decoded.samples.size());
+                return;
+            }
+            CHECK_EQUAL(frame.samples[i][0], decoded.samples.raw_x[sample]);
+            CHECK_EQUAL(frame.samples[i][1], decoded.samples.raw_y[sample]);
+            CHECK_EQUAL(frame.samples[i][2], decoded.samples.raw_z[sample]);
+            CHECK(std::fabs(decoded.samples.z[sample] - frame.samples[i][2]*scale) < 1e-3f);
+            CHECK_EQUAL(frame.sensor, decoded.samples.sensor[sample]);
+        }
+    }
+    CHECK_EQUAL(sample, decoded.samples.size());
+
+} // end CheckSamples
+
+
+StreamDecoder::Options KeepAll() {
+
+    StreamDecoder::Options options;
+    options.keep_raw     = true;
+    options.keep_packets = true;
+    return options;
+
+} // end KeepAll
+
+
+// Decodes a stream in chunks of 1 ... 40 bytes, the bytes not consumed given again
+void DecodeInChunks(const std::vector<uint8_t>& bytes, uint32_t seed, StreamDecoder& decoder, DecodedStream& decoded) {
+
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pending;
+    size_t position = 0;
+    while(position < bytes.size()) {
+        size_t chunk = std::min<size_t>(1 + random() % 40, bytes.size()-position);
+        pending.insert(pending.end(), &bytes[position], &bytes[position+chunk]);
+        position += chunk;
+        bool last = (position == bytes.size());
+        size_t used = decoder.Decode(pending.data(), pending.size(), decoded, last);
+        pending.erase(pending.begin(), pending.begin()+used);
+    }
+    CHECK(pending.empty());
+
+} // end DecodeInChunks
+
+
+// Profiler record ('P'/'B'): full of bytes that look like headers and tails
+void PutRecord(uint8_t type, std::vector<uint8_t>& out) {
+
+    out.push_back(type);
+    for(size_t i = 1; i < kRecordSize-1; i++) {
+        out.push_back((i % 3) ? kHeader : kTail);
+    }
+    out.push_back(kTail);
+
+} // end PutRecord
+
+void PutText(const char* text, std::vector<uint8_t>& out) {
+
+    out.insert(out.end(), text, text+strlen(text));
+
+} // end PutText
+
+} // namespace
+
+
+TEST(every_format_round_trip) {
+
+    for(const FrameFormat& format : AllFormats()) {
+
+        TestStream stream = MakeStream(format, 500, 1);
+
+        StreamDecoder decoder(format, KeepAll());
+        DecodedStream decoded;
+        CHECK_EQUAL(stream.bytes.size(), decoder.Decode(stream.bytes.data(), stream.bytes.size(), decoded, true));
+
+        CheckSamples(format, stream, decoded);
+        CHECK_EQUAL(stream.frames.size(), decoder.stats().frames);
+        CHECK_EQUAL(stream.frames.size(), decoded.packets.size());
+        CHECK_EQUAL(format.odr_marker ? 1 : 0, decoded.markers.size());
+        CHECK_EQUAL(0, decoder.stats().corrupted);
+        CHECK_EQUAL(0, decoder.stats().skipped_bytes);
+        CHECK_EQUAL(0, decoder.stats().lost_packets);
+        if(check::Failures()) {
+            printf("  format %s\n", format.ToString().c_str());
+            return;
+        }
+    }
+
+} // end every_format_round_trip
+
+
+TEST(chunked_decode_matches_whole) {
+
+    for(const FrameFormat& format : AllFormats()) {
+
+        TestStream stream = MakeStream(format, 300, 3);
+
+        StreamDecoder decoder(format, KeepAll());
+        DecodedStream decoded;
+        DecodeInChunks(stream.bytes, 2, decoder, decoded);
+
+        CheckSamples(format, stream, decoded);
+        CHECK_EQUAL(stream.bytes.size(), decoder.stats().bytes);
+        CHECK_EQUAL(0, decoder.stats().corrupted);
+    }
+
+} // end chunked_decode_matches_whole
+
+
+TEST(resync_across_text_and_records) {
+
+    for(const FrameFormat& format : AllFormats()) {
+
+        TestStream stream = MakeStream(format, 40, 4);
+
+        // Reports of the UART commands between the frames, garbage at the beginning
+        std::vector<uint8_t> bytes = {0x13, kTail, 0x05};
+        size_t text = 0;
+        for(size_t i = 0; i < stream.frames.size(); i++) {
+            size_t end = (i+1 < stream.frames.size()) ? stream.offsets[i+1] : stream.bytes.size();
+            bytes.insert(bytes.end(), &stream.bytes[stream.offsets[i]], &stream.bytes[end]);
+            if(i % 10 == 3) {
+                PutRecord(kRecordHeader, bytes);
+                PutRecord(kBenchHeader, bytes);
+                PutRecord(kInstrHeader, bytes);
+            }
+            if(i % 10 == 7) {
+                const char* line = "ODR  100 Hz: 1200 samples, active 112 us/sample, duty 1.1%\r\n";
+                PutText(line, bytes);
+                text += strlen(line);
+            }
+        }
+
+        // The marker comes before the first frame of samples
+        std::vector<uint8_t> head(stream.bytes.begin(), stream.bytes.begin()+stream.offsets[0]);
+        bytes.insert(bytes.begin()+3, head.begin(), head.end());
+
+        StreamDecoder decoder(format, KeepAll());
+        DecodedStream decoded;
+        decoder.Decode(bytes.data(), bytes.size(), decoded, true);
+
+        CheckSamples(format, stream, decoded);
+        CHECK_EQUAL(12, decoder.stats().records);
+        CHECK_EQUAL(text, decoder.stats().text_bytes);
+        CHECK_EQUAL(0, decoder.stats().corrupted);
+
+        StreamDecoder chunked_decoder(format, KeepAll());
+        DecodedStream chunked;
+        DecodeInChunks(bytes, 7, chunked_decoder, chunked);
+        CheckSamples(format, stream, chunked);
+        CHECK_EQUAL(12, chunked_decoder.stats().records);
+        if(check::Failures()) {
+            printf("  format %s\n", format.ToString().c_str());
+            return;
+        }
+    }
+
+} // end resync_across_text_and_records
+
+
+TEST(crc_error_is_corruption_not_loss) {
+
+    FrameFormat format;
+    format.Parse("batching,integrity");
+    TestStream stream = MakeStream(format, 20, 5);
+
+    // A bit of the samples of frame 5 flipped: same length and tail, wrong CRC
+    stream.bytes[stream.offsets[5]+4] ^= 0x10;
+
+    StreamDecoder decoder(format, KeepAll());
+    DecodedStream decoded;
+    decoder.Decode(stream.bytes.data(), stream.bytes.size(), decoded, true);
+
+    CHECK_EQUAL(19, decoder.stats().frames);
+    CHECK_EQUAL(1, decoder.stats().corrupted);
+    CHECK_EQUAL(1, decoder.stats().crc_errors);
+    CHECK_EQUAL(0, decoder.stats().lost_packets);
+    CHECK_EQUAL(0, decoder.stats().sequence_gaps);
+
+} // end crc_error_is_corruption_not_loss
+
+
+TEST(sequence_gaps_count_bursts) {
+
+    FrameFormat format;
+    format.Parse("id,batching,integrity,time");
+
+    FrameEncoder encoder(format);
+    std::vector<uint8_t> bytes;
+    int16_t sample[1][3] = {{1, 2, 3}};
+
+    // Dropped by the firmware: 1, then 3, then 20 packets
+    const uint8_t drops[] = {0, 1, 0, 3, 0, 20, 0};
+    for(uint8_t drop : drops) {
+        encoder.SkipSequence(drop);
+        encoder.Samples(0, sample, 1, 0, bytes);
+    }
+
+    StreamDecoder decoder(format);
+    DecodedStream decoded;
+    decoder.Decode(bytes.data(), bytes.size(), decoded, true);
+
+    CHECK_EQUAL(7, decoder.stats().frames);
+    CHECK_EQUAL(24, decoder.stats().lost_packets);
+    CHECK_EQUAL(3, decoder.stats().sequence_gaps);
+    CHECK_EQUAL(1, decoder.stats().loss_bursts[0]);
+    CHECK_EQUAL(1, decoder.stats().loss_bursts[2]);
+    CHECK_EQUAL(1, decoder.stats().loss_bursts[kLossBuckets-1]);
+
+} // end sequence_gaps_count_bursts
+
+
+TEST(lost_header_without_integrity) {
+
+    FrameFormat format;
+    format.Parse("batching");
+    TestStream stream = MakeStream(format, 30, 6);
+
+    // Header of frame 10 lost on the line
+    stream.bytes.erase(stream.bytes.begin()+stream.offsets[10]);
+
+    StreamDecoder decoder(format, KeepAll());
+    DecodedStream decoded;
+    decoder.Decode(stream.bytes.data(), stream.bytes.size(), decoded, true);
+
+    CHECK_EQUAL(29, decoder.stats().frames);
+    CHECK_EQUAL(1, decoder.stats().corrupted);
+
+    // Frame 11 onwards decoded again
+    size_t before = 0;
+    for(size_t i = 0; i < 10; i++) {
+        before += stream.frames[i].count;
+    }
+    CHECK_EQUAL(stream.frames[11].samples[0][0], decoded.samples.raw_x[before]);
+
+} // end lost_header_without_integrity
+
+
+TEST(time_unwraps_per_sensor) {
+
+    FrameFormat format;
+    format.Parse("id,batching,marker,time");
+
+    FrameEncoder encoder(format);
+    std::vector<uint8_t> bytes;
+    int16_t samples[4][3] = {};
+
+    encoder.Marker(400, 0xFFFF00, bytes);
+    encoder.Samples(0, samples, 4, 0xFFFF00, bytes);
+    encoder.Samples(1, samples, 4, 0xFFFF80, bytes);
+    encoder.Samples(0, samples, 4, 0x000100, bytes);  // Wrapped: 2^24 + 0x100
+    encoder.Samples(1, samples, 4, 0x000180, bytes);
+
+    StreamDecoder decoder(format, KeepAll());
+    DecodedStream decoded;
+    decoder.Decode(bytes.data(), bytes.size(), decoded, true);
+
+    CHECK_EQUAL(1, decoded.markers.size());
+    CHECK_EQUAL(400, decoded.markers[0].odr);
+    CHECK_EQUAL(4, decoded.packets.size());
+    CHECK_EQUAL(0xFFFF00, decoded.packets[0].time_us);
+    CHECK_EQUAL(0x1000100, decoded.packets[2].time_us);
+    CHECK_EQUAL(0x1000180, decoded.packets[3].time_us);
+    CHECK_EQUAL(400, decoded.packets[3].odr);
+
+    // One period (2500 us at 400 Hz) between the samples of a packet
+    CHECK_EQUAL(0x1000100,      decoded.samples.time_us[8]);
+    CHECK_EQUAL(0x1000100+2500, decoded.samples.time_us[9]);
+
+} // end time_unwraps_per_sensor
+
+
+TEST(invalid_frames_rejected) {
+
+    FrameFormat format;
+    format.Parse("id,batching,integrity");
+
+    std::vector<uint8_t> bytes;
+    FrameEncoder encoder(format);
+    int16_t sample[1][3] = {{100, 200, 300}};
+    encoder.Samples(0, sample, 1, 0, bytes);
+
+    // N = 17, ID = 2, marker without the option: never accepted, even with a good CRC
+    std::vector<uint8_t> bad = {kHeader, 0, kMaxBatch+1, 1};
+    bad.resize(bad.size() + (kMaxBatch+1)*6, 0);
+    bad.push_back(Crc8(&bad[1], bad.size()-1));
+    bad.push_back(kTail);
+    bytes.insert(bytes.end(), bad.begin(), bad.end());
+
+    std::vector<uint8_t> marker = {kHeader, kAllSensors, 0, 2, 100, 0};
+    marker.push_back(Crc8(&marker[1], marker.size()-1));
+    marker.push_back(kTail);
+    bytes.insert(bytes.end(), marker.begin(), marker.end());
+
+    encoder.SkipSequence(2);
+    encoder.Samples(1, sample, 1, 0, bytes);
+
+    StreamDecoder decoder(format, KeepAll());
+    DecodedStream decoded;
+    decoder.Decode(bytes.data(), bytes.size(), decoded, true);
+
+    CHECK_EQUAL(2, decoder.stats().frames);
+    CHECK_EQUAL(0, decoder.stats().markers);
+    CHECK_EQUAL(1, decoder.stats().corrupted);
+
+    // The 2 invalid frames took the sequence numbers skipped: one of them has been
+    // counted as corrupted, the other one is lost
+    CHECK_EQUAL(1, decoder.stats().lost_packets);
+
+} // end invalid_frames_rejected
+
+
+TEST(format_options) {
+
+    FrameFormat format;
+    CHECK(format.Parse("id,batching,integrity,marker,time,delta"));
+    CHECK_EQUAL(1+1+1+1+3, format.HeadBytes());
+    CHECK_EQUAL(2, format.TailBytes());
+    CHECK(format.ToString() == "id,batching,integrity,marker,time,delta");
+    CHECK(format.Check().empty());
+
+    CHECK(format.Parse(""));
+    CHECK(format.ToString() == "default");
+    CHECK_EQUAL(2, format.HeadBytes()+format.TailBytes());
+
+    CHECK(!format.Parse("batching,crc"));
+    CHECK(format.Parse("marker"));
+    CHECK(!format.Check().empty());
+    CHECK(format.Parse("delta"));
+    CHECK(!format.Check().empty());
+
+    // CRC of "123456789" (CRC-8/SMBUS check value)
+    const uint8_t digits[] = {'1','2','3','4','5','6','7','8','9'};
+    CHECK_EQUAL(0xF4, Crc8(digits, sizeof(digits)));
+
+    // 8 bytes per step against the bitwise definition, every length up to a long frame
+    uint8_t bytes[128];
+    for(size_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = (uint8_t)(i*37 + 11);
+    }
+    for(size_t length = 0; length <= sizeof(bytes); length++) {
+        uint8_t crc = 0;
+        for(size_t i = 0; i < length; i++) {
+            crc ^= bytes[i];
+            for(int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x80) ? (uint8_t)((crc<<1) ^ 0x07) : (uint8_t)(crc<<1);
+            }
+        }
+        CHECK_EQUAL(crc, Crc8(bytes, length));
+    }
+
+} // end format_options
+
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
@@ -0,0 +1,267 @@
+/* ========================================
+ *
+ * \file  TestFilter.cpp
+ * \brief Filter.c (built with FILTER_ENABLED) against a host reference
+ *
+ * The reference below is written from the description of "Filter.h" only
+ * (Direct Form I, Q30 coefficients, Q31 state, round half up, floor, saturation)
+ * with floor divisions instead of the shifts: Filter_Process must give the same
+ * bits on every input. The presets are also checked against their design
+ * (bilinear Butterworth in double precision) and against a step: they must settle
+ * on its final value, with no dead band
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Check.h"
+
+extern "C" {
+    #include "Filter.h"
+}
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#if !FILTER_ENABLED
+    #error "Build with -DFILTER_ENABLED=1 (see the Makefile)"
+#endif
+
+namespace {
+
+// Reference pipeline of one sensor
+class Reference {
+public:
+    explicit Reference(const FilterConfig& config) : config_(config) {
+    }
+
+    // Returns true if the sample is kept (decimation)
+    bool Process(const int16_t in[3], int16_t out[3]) {
+        for(int axis = 0; axis < 3; axis++) {
+            int16_t value = in[axis];
+            for(int stage = 0; stage < config_.stages; stage++) {
+                value = Biquad(config_.biquads[stage], state_[axis][stage], value);
+            }
+            out[axis] = value;
+        }
+        count_ = (count_+1) % std::max<int>(1, config_.decimation);
+        return count_ == 0;
+    }
+
+private:
+    struct State {
+        std::array<int16_t, 3> x{}; // x[n], x[n-1], x[n-2] (Q15)
+        std::array<int32_t, 3> y{}; // y[n], y[n-1], y[n-2] (Q31)
+    };
+
+    // Round half up: floor((value + 2^(bits-1)) / 2^bits)
+    static __int128 Round(__int128 value, int bits) {
+        __int128 scale = (__int128)1 << bits;
+        __int128 num   = value + scale/2;
+        return num/scale - ((num % scale) < 0);
+    }
+
+    static __int128 Clamp(__int128 value, __int128 low, __int128 high) {
+        return std::max(low, std::min(high, value));
+    }
+
+    static int16_t Biquad(const FilterBiquad& c, State& s, int16_t x0) {
+        s.x = {x0, s.x[0], s.x[1]};
+        __int128 feedback = (__int128)c.a1*s.y[0] + (__int128)c.a2*s.y[1];                  // Q61
+        __int128 sum      = (__int128)c.b0*s.x[0] + (__int128)c.b1*s.x[1] + (__int128)c.b2*s.x[2] +
+                            Round(feedback, 16);                                               // Q45
+        int32_t  y0       = (int32_t)Clamp(Round(sum, 14), INT32_MIN, INT32_MAX);             // Q31
+        s.y = {y0, s.y[0], s.y[1]};
+        return (int16_t)Clamp(Round(y0, 16), INT16_MIN, INT16_MAX);                          // Q15
+    }
+
+    FilterConfig config_;
+    State        state_[3][FILTER_MAX_STAGES];
+    int          count_ = 0;
+};
+
+void Pack(const int16_t in[3], uint8_t raw[6]) {
+    for(int axis = 0; axis < 3; axis++) {
+        raw[2*axis]   = (uint8_t)(in[axis] & 0xFF);
+        raw[2*axis+1] = (uint8_t)((uint16_t)in[axis] >> 8);
+    }
+}
+
+void Unpack(const uint8_t raw[6], int16_t out[3]) {
+    for(int axis = 0; axis < 3; axis++) {
+        out[axis] = (int16_t)(raw[2*axis] | (raw[2*axis+1] << 8));
+    }
+}
+
+// Runs 'inputs' through Filter_Process (one sensor) and the reference; # samples that differ
+int Compare(const FilterConfig& config, const std::vector<std::array<int16_t, 3>>& inputs) {
+    Filter_Configure(&config);
+    Reference reference(config);
+    int differences = 0;
+    for(const auto& input : inputs) {
+        uint8_t raw[6], filtered[6];
+        int16_t expected[3], actual[3];
+        Pack(input.data(), raw);
+        bool ready     = Filter_Process(0, raw, filtered);
+        bool ref_ready = reference.Process(input.data(), expected);
+        Unpack(filtered, actual);
+        differences += (ready != ref_ready) || !std::equal(actual, actual+3, expected);
+    }
+    return differences;
+}
+
+// Butterworth section by the bilinear transform, as stored (Q30, feedback sign changed)
+std::array<double, 5> Design(bool low_pass, double relative_cutoff, double q) {
+    double k    = std::tan(M_PI*relative_cutoff);
+    double norm = 1/(1 + k/q + k*k);
+    double b0   = low_pass ? k*k*norm : norm;
+    double b1   = low_pass ? 2*b0 : -2*b0;
+    double a1   = 2*(k*k - 1)*norm;
+    double a2   = (1 - k/q + k*k)*norm;
+    return {b0, b1, b0, -a1, -a2};
+}
+
+void CheckDesign(const FilterBiquad& biquad, const std::array<double, 5>& design) {
+    const int32_t stored[5] = {biquad.b0, biquad.b1, biquad.b2, biquad.a1, biquad.a2};
+    for(int i = 0; i < 5; i++) {
+        CHECK(std::fabs(stored[i] - design[i]*(1 << 30)) <= 2);
+    }
+}
+
+} // namespace
+
+
+TEST(presets_bit_exact_on_noise) {
+    std::mt19937 random(3);
+    std::vector<std::array<int16_t, 3>> inputs;
+    for(int i = 0; i < 200000; i++) {
+        inputs.push_back({(int16_t)random(), (int16_t)((random() % 4096 - 2048) << 4), (int16_t)(16000 + random() % 64)});
+    }
+    for(int preset = 0; preset < FILTER_PRESETS; preset++) {
+        CHECK_EQUAL(0, Compare(filter_presets[preset], inputs));
+    }
+}
+
+TEST(presets_bit_exact_on_steps_and_saturation) {
+    // Full scale steps: the high-pass and the 4th order low-pass overshoot and saturate
+    std::vector<std::array<int16_t, 3>> inputs;
+    for(int i = 0; i < 4000; i++) {
+        int16_t value = ((i/250) % 2) ? INT16_MAX : INT16_MIN;
+        inputs.push_back({value, (int16_t)-value, (int16_t)(value/2)});
+    }
+    for(int preset = 0; preset < FILTER_PRESETS; preset++) {
+        CHECK_EQUAL(0, Compare(filter_presets[preset], inputs));
+    }
+}
+
+TEST(presets_settle_after_a_step) {
+    // 0 --> 16000 (about 1 g at +-2 g) on every axis: the high-pass must go back to 0
+    // (no dead band around its poles), the low-pass filters to the step within 1 LSB
+    for(int preset = 1; preset < FILTER_PRESETS; preset++) {
+        Filter_Configure(&filter_presets[preset]);
+        int16_t target   = (preset == 2) ? 0 : 16000;
+        int     settled  = 0;
+        for(int i = 0; i < 20000; i++) {
+            int16_t in[3] = {(int16_t)(i ? 16000 : 0), (int16_t)(i ? 16000 : 0), (int16_t)(i ? 16000 : 0)};
+            uint8_t raw[6], filtered[6];
+            int16_t out[3];
+            Pack(in, raw);
+            Filter_Process(0, raw, filtered);
+            Unpack(filtered, out);
+            if(i >= 10000) {
+                for(int axis = 0; axis < 3; axis++) {
+                    settled += std::abs(out[axis] - target) <= ((preset == 2) ? 0 : 1);
+                }
+            }
+        }
+        CHECK_EQUAL(3*10000, settled);
+    }
+}
+
+#if PACKET_MAX_SENSORS > 1
+TEST(sensors_have_their_own_state) {
+    Filter_Configure(&filter_presets[3]);
+    Reference first(filter_presets[3]), second(filter_presets[3]);
+    int differences = 0;
+    for(int i = 0; i < 1000; i++) {
+        int16_t in0[3] = {(int16_t)(i*37), 100, -100};
+        int16_t in1[3] = {(int16_t)(-i*11), 5000, 0};
+        uint8_t raw[6], filtered[6];
+        int16_t expected[3], actual[3];
+
+        Pack(in0, raw);
+        bool ready = Filter_Process(0, raw, filtered);
+        differences += (ready != first.Process(in0, expected));
+        Unpack(filtered, actual);
+        differences += !std::equal(actual, actual+3, expected);
+
+        // The second sensor is one sample behind in the decimation
+        if(i > 0) {
+            Pack(in1, raw);
+            ready = Filter_Process(1, raw, filtered);
+            differences += (ready != second.Process(in1, expected));
+            Unpack(filtered, actual);
+            differences += !std::equal(actual, actual+3, expected);
+        }
+    }
+    CHECK_EQUAL(0, differences);
+}
+#endif
+
+TEST(configure_resets_and_clamps) {
+    FilterConfig config = filter_presets[3];
+    config.stages     = FILTER_MAX_STAGES+3;
+    config.decimation = 0;
+    Filter_Configure(&config);
+
+    // Clamped: as many stages as there are, every sample kept
+    config.stages     = FILTER_MAX_STAGES;
+    config.decimation = 1;
+    std::vector<std::array<int16_t, 3>> inputs(100, {{1000, 2000, 3000}});
+    CHECK_EQUAL(0, Compare(config, inputs));
+}
+
+TEST(presets_match_their_design) {
+    CheckDesign(filter_presets[1].biquads[0], Design(true, 0.1, M_SQRT1_2));
+    CheckDesign(filter_presets[2].biquads[0], Design(false, 0.01, M_SQRT1_2));
+    // 4th order Butterworth: Q = 1/(2 cos(pi/8)) and 1/(2 cos(3 pi/8))
+    CheckDesign(filter_presets[3].biquads[0], Design(true, 0.05, 1/(2*std::cos(M_PI/8))));
+    CheckDesign(filter_presets[3].biquads[1], Design(true, 0.05, 1/(2*std::cos(3*M_PI/8))));
+}
+
+TEST(presets_frequency_response) {
+    // Steady state amplitude of a sine at 'relative' frequency through a preset (axis X,
+    // every output before the decimation), by correlation over whole periods
+    auto gain = [](int preset, double relative) {
+        Filter_Configure(&filter_presets[preset]);
+        double in_phase = 0, quadrature = 0;
+        for(int i = 0; i < 20000; i++) {
+            int16_t in[3] = {(int16_t)std::lround(10000*std::sin(2*M_PI*relative*i)), 0, 0};
+            uint8_t raw[6], filtered[6];
+            int16_t out[3];
+            Pack(in, raw);
+            Filter_Process(0, raw, filtered);
+            Unpack(filtered, out);
+            if(i >= 10000) {
+                in_phase   += out[0]*std::sin(2*M_PI*relative*i);
+                quadrature += out[0]*std::cos(2*M_PI*relative*i);
+            }
+        }
+        return std::hypot(in_phase, quadrature)*2/10000/10000;
+    };
+
+    CHECK(std::fabs(gain(1, 0.01) - 1) < 0.01);                     // Pass band
+    CHECK(std::fabs(gain(1, 0.1) - M_SQRT1_2) < 0.01);              // -3 dB at the cut-off
+    CHECK(gain(1, 0.4) < 0.02);
+    CHECK(gain(2, 0.001) < 0.02);                                   // Gravity removed
+    CHECK(std::fabs(gain(2, 0.2) - 1) < 0.01);
+    CHECK(std::fabs(gain(3, 0.05) - M_SQRT1_2) < 0.01);
+    CHECK(gain(3, 0.25) < 0.002);                                   // Alias band of the decimation
+}
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
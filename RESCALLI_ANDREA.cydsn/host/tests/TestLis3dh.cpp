@@ -0,0 +1,218 @@
+/* ========================================
+ *
+ * \file  TestLis3dh.cpp
+ * \brief Tests of the LIS3DH model of the simulator (host/board/Lis3dh)
+ *
+ * The register behaviour the firmware relies on: timing of the samples,
+ * STATUS_REG flags, BDU, INT1, FIFO and resolution
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Check.h"
+#include "Lis3dh.h"
+
+#include <vector>
+
+using namespace board;
+
+
+namespace {
+
+constexpr Cycles kMs = 24000;
+
+// Single register write, as I2C_Peripheral_WriteRegister
+void WriteRegister(Lis3dh& sensor, Cycles now, uint8_t address, uint8_t value) {
+    sensor.Start(now, false);
+    sensor.Write(now, address);
+    sensor.Write(now, value);
+    sensor.Stop(now);
+}
+
+// Sub-address write, restart, 'count' bytes read (auto-increment if count > 1)
+std::vector<uint8_t> ReadRegisters(Lis3dh& sensor, Cycles now, uint8_t address, size_t count) {
+    std::vector<uint8_t> data;
+    sensor.Start(now, false);
+    sensor.Write(now, (count > 1) ? (address | 0x80) : address);
+    sensor.Start(now, true);
+    for(size_t i = 0; i < count; i++) {
+        data.push_back(sensor.Read(now));
+    }
+    sensor.Stop(now);
+    return data;
+}
+
+void ConstantSource(Lis3dh& sensor, int16_t x, int16_t y, int16_t z) {
+    sensor.SetSource([=](uint64_t, Cycles, int16_t mg[3]) {
+        mg[0] = x;
+        mg[1] = y;
+        mg[2] = z;
+    });
+}
+
+} // namespace
+
+
+TEST(reset_values) {
+    Lis3dh sensor(0x18, 0);
+    CHECK_EQUAL(0x33, ReadRegisters(sensor, 0, 0x0F, 1)[0]);
+    CHECK_EQUAL(0x07, ReadRegisters(sensor, 0, 0x20, 1)[0]);
+    CHECK_EQUAL(0, sensor.Odr());
+    CHECK(sensor.NextSample() == kNever);
+
+    // Read-only registers ignore the writes
+    WriteRegister(sensor, 0, 0x0F, 0x00);
+    CHECK_EQUAL(0x33, sensor.Register(0x0F));
+}
+
+TEST(samples_at_the_odr) {
+    Lis3dh sensor(0x18, 0);
+    std::vector<uint16_t> changes;
+    sensor.SetOdrListener([&](uint16_t odr, Cycles) {
+        changes.push_back(odr);
+    });
+
+    // 100 Hz from 5 ms: first sample one period later
+    WriteRegister(sensor, 5*kMs, 0x20, 0x57);
+    CHECK_EQUAL(100, sensor.Odr());
+    for(int i = 1; i <= 3; i++) {
+        CHECK_EQUAL(5*kMs + i*10*kMs, sensor.NextSample());
+        sensor.Produce(sensor.NextSample());
+    }
+    CHECK_EQUAL(3, sensor.stats().generated);
+
+    // Same ODR written again: timing kept
+    WriteRegister(sensor, 36*kMs, 0x20, 0x57);
+    CHECK_EQUAL(45*kMs, sensor.NextSample());
+
+    // Low Power 5.376 kHz, then power down
+    WriteRegister(sensor, 40*kMs, 0x20, 0x9F);
+    CHECK_EQUAL(5376, sensor.Odr());
+    WriteRegister(sensor, 41*kMs, 0x20, 0x07);
+    CHECK(sensor.NextSample() == kNever);
+
+    CHECK_EQUAL(3, changes.size());
+    CHECK_EQUAL(5376, changes[1]);
+    CHECK_EQUAL(0, changes[2]);
+
+    // Clock error
+    Lis3dh slow(0x18, 1000);
+    WriteRegister(slow, 0, 0x20, 0x17);
+    CHECK_EQUAL(24024000, slow.NextSample());
+}
+
+TEST(status_flags_and_overrun) {
+    Lis3dh sensor(0x18, 0);
+    WriteRegister(sensor, 0, 0x20, 0x57);
+    CHECK_EQUAL(0x00, ReadRegisters(sensor, 0, 0x27, 1)[0]);
+
+    sensor.Produce(sensor.NextSample());
+    CHECK_EQUAL(0x0F, ReadRegisters(sensor, 11*kMs, 0x27, 1)[0]);
+
+    // Overwritten before being read
+    sensor.Produce(sensor.NextSample());
+    CHECK_EQUAL(0xFF, ReadRegisters(sensor, 21*kMs, 0x27, 1)[0]);
+    CHECK_EQUAL(1, sensor.stats().overwritten);
+
+    // Reading OUT_Z_H clears both flags; the sample is counted once
+    ReadRegisters(sensor, 22*kMs, 0x28, 6);
+    CHECK_EQUAL(0x00, ReadRegisters(sensor, 22*kMs, 0x27, 1)[0]);
+    ReadRegisters(sensor, 23*kMs, 0x28, 6);
+    CHECK_EQUAL(1, sensor.stats().read);
+    CHECK_EQUAL(2*kMs, sensor.stats().latency_max);
+
+    // Combined read: STATUS_REG and the axes in a single burst
+    sensor.Produce(sensor.NextSample());
+    std::vector<uint8_t> data = ReadRegisters(sensor, 31*kMs, 0x27, 7);
+    CHECK_EQUAL(0x0F, data[0]);
+    CHECK_EQUAL(2, sensor.stats().read);
+}
+
+TEST(bdu_holds_samples_during_a_read) {
+    Lis3dh sensor(0x18, 0);
+    WriteRegister(sensor, 0, 0x20, 0x57);
+    WriteRegister(sensor, 0, 0x22, 0x10);
+
+    // Sample generated between the sub-address and the stop: applied at the stop
+    sensor.Start(9*kMs, false);
+    sensor.Write(9*kMs, 0x27);
+    CHECK(!sensor.Produce(sensor.NextSample()));
+    sensor.Start(10*kMs, true);
+    CHECK_EQUAL(0x00, sensor.Read(10*kMs));
+    CHECK(sensor.Stop(10*kMs));
+    CHECK(sensor.Int1());
+    CHECK_EQUAL(0x0F, ReadRegisters(sensor, 11*kMs, 0x27, 1)[0]);
+}
+
+TEST(int1_follows_zyxda) {
+    Lis3dh sensor(0x18, 0);
+    WriteRegister(sensor, 0, 0x20, 0x57);
+
+    // Not routed
+    CHECK(!sensor.Produce(sensor.NextSample()));
+    ReadRegisters(sensor, 11*kMs, 0x28, 6);
+
+    WriteRegister(sensor, 11*kMs, 0x22, 0x10);
+    CHECK(sensor.Produce(sensor.NextSample()));
+    // Still high: no new edge until the axes are read
+    CHECK(!sensor.Produce(sensor.NextSample()));
+    ReadRegisters(sensor, 31*kMs, 0x28, 6);
+    CHECK(!sensor.Int1());
+    CHECK(sensor.Produce(sensor.NextSample()));
+    CHECK_EQUAL(2, sensor.stats().int1_edges);
+}
+
+TEST(fifo_stream_mode) {
+    Lis3dh sensor(0x18, 0);
+    WriteRegister(sensor, 0, 0x20, 0x57);
+    WriteRegister(sensor, 0, 0x24, 0x40);
+    WriteRegister(sensor, 0, 0x2E, 0x80);
+    CHECK_EQUAL(0x20, ReadRegisters(sensor, 0, 0x2F, 1)[0]);
+
+    for(int i = 0; i < 40; i++) {
+        sensor.Produce(sensor.NextSample());
+    }
+    CHECK_EQUAL(0x5F, ReadRegisters(sensor, 400*kMs, 0x2F, 1)[0]);
+    CHECK_EQUAL(8, sensor.stats().overwritten);
+
+    // One burst drains everything: the address rolls back from OUT_Z_H to OUT_X_L
+    ReadRegisters(sensor, 401*kMs, 0x28, 32*6);
+    CHECK_EQUAL(32, sensor.stats().read);
+    CHECK_EQUAL(0x20, ReadRegisters(sensor, 401*kMs, 0x2F, 1)[0]);
+    // Oldest sample left: the 9th, generated at 90 ms
+    CHECK_EQUAL(401*kMs - 90*kMs, sensor.stats().latency_max);
+
+    // Bypass mode empties the FIFO
+    for(int i = 0; i < 5; i++) {
+        sensor.Produce(sensor.NextSample());
+    }
+    WriteRegister(sensor, 460*kMs, 0x2E, 0x00);
+    CHECK_EQUAL(0, sensor.FifoLevel());
+}
+
+TEST(resolution_and_full_scale) {
+    Lis3dh sensor(0x18, 0);
+    ConstantSource(sensor, 1000, -1000, 5000);
+
+    // High Resolution, +-2 g: 12 bits left-justified, 1 mg/digit, saturated at 2047
+    WriteRegister(sensor, 0, 0x23, 0x88);
+    WriteRegister(sensor, 0, 0x20, 0x57);
+    sensor.Produce(sensor.NextSample());
+    std::vector<uint8_t> data = ReadRegisters(sensor, 11*kMs, 0x28, 6);
+    CHECK_EQUAL(1000*16, (int16_t)(data[0] | (data[1] << 8)));
+    CHECK_EQUAL(-1000*16, (int16_t)(data[2] | (data[3] << 8)));
+    CHECK_EQUAL(2047*16, (int16_t)(data[4] | (data[5] << 8)));
+
+    // Low Power: 8 bits, 16 mg/digit
+    WriteRegister(sensor, 11*kMs, 0x23, 0x80);
+    WriteRegister(sensor, 11*kMs, 0x20, 0x8F);
+    sensor.Produce(sensor.NextSample());
+    data = ReadRegisters(sensor, 12*kMs, 0x28, 6);
+    CHECK_EQUAL(63*256, (int16_t)(data[0] | (data[1] << 8)));
+    CHECK_EQUAL(127*256, (int16_t)(data[4] | (data[5] << 8)));
+}
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
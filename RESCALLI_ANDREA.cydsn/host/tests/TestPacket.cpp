@@ -0,0 +1,182 @@
+/* ========================================
+ *
+ * \file  TestPacket.cpp
+ * \brief Round trip of the firmware encoder ("Packet.c") through the host decoder
+ *
+ * Built once per variant of the Makefile (test_packet_<variant>) with the same
+ * -D as Packet.c: the frames queued by Packet_AddSample are captured in place of
+ * Transmit_Frame and decoded by StreamDecoder with the options of the build.
+ * MMS2 must give the mm/s^2 of Conversion.c, RAW12 and DELTA the 12-bit counts
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Check.h"
+#include "StreamDecoder.h"
+
+extern "C" {
+    #include "Conversion.h"
+    #include "I2C.h"
+    #include "Packet.h"
+    #include "Transmit.h"
+}
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace lis3dh;
+
+
+namespace {
+
+std::vector<uint8_t> stream;
+
+FrameFormat FirmwareFormat() {
+    FrameFormat format;
+    format.sensor_id  = PACKET_SENSOR_ID;
+    format.batching   = PACKET_BATCHING;
+    format.integrity  = PACKET_INTEGRITY;
+    format.odr_marker = PACKET_ODR_MARKER;
+    format.timestamp  = PACKET_TIMESTAMP;
+    format.encoding   = (Encoding)PACKET_ENCODING;
+    return format;
+}
+
+// Value on the wire of a count: mm/s^2 (HR +-2g) or the count itself
+int16_t Expected(int16_t counts) {
+#if PACKET_ENCODING == PACKET_ENCODING_MMS2
+    return (int16_t)(counts*981/100);
+#else
+    return counts;
+#endif
+}
+
+// Encodes the samples (12-bit counts, left-justified as in OUT_x registers) and decodes the stream
+DecodedStream RoundTrip(const std::vector<std::array<int16_t, 3>>& samples,
+                        uint8_t batch,
+                        DecoderStats* stats = nullptr) {
+
+    stream.clear();
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FS_2G);
+    Packet_SetBatch(batch);
+
+    for(const auto& sample : samples) {
+        uint8_t raw[BYTE_TO_SEND];
+        for(int axis = 0; axis < AXES; axis++) {
+            uint16_t left = (uint16_t)(sample[axis] << 4);
+            raw[2*axis]   = (uint8_t)(left & 0xFF);
+            raw[2*axis+1] = (uint8_t)(left >> 8);
+        }
+        Packet_AddSample(0, raw);
+    }
+    Packet_Flush();
+
+    StreamDecoder::Options options;
+    options.keep_raw     = true;
+    options.keep_packets = true;
+    StreamDecoder decoder(FirmwareFormat(), options);
+    DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+    if(stats) {
+        *stats = decoder.stats();
+    }
+    return decoded;
+
+} // end RoundTrip
+
+
+void CheckSamples(const std::vector<std::array<int16_t, 3>>& samples, const DecodedStream& decoded) {
+
+    CHECK_EQUAL(samples.size(), decoded.samples.size());
+    if(samples.size() != decoded.samples.size()) {
+        return;
+    }
+    int errors = 0;
+    for(size_t i = 0; i < samples.size(); i++) {
+        errors += (decoded.samples.raw_x[i] != Expected(samples[i][0])) +
+                  (decoded.samples.raw_y[i] != Expected(samples[i][1])) +
+                  (decoded.samples.raw_z[i] != Expected(samples[i][2]));
+    }
+    CHECK_EQUAL(0, errors);
+
+} // end CheckSamples
+
+} // namespace
+
+
+// Frames of the firmware go to the decoder instead of the UART
+extern "C" uint8_t Transmit_Frame(const uint8_t* frame, uint8_t length) {
+    stream.insert(stream.end(), frame, frame+length);
+    return NO_ERROR;
+}
+
+
+TEST(every_count_round_trips) {
+    // Every 12-bit value on every axis, in an order that gives every nibble alignment
+    std::vector<std::array<int16_t, 3>> samples;
+    for(int32_t counts = -2048; counts < 2048; counts++) {
+        samples.push_back({(int16_t)counts, (int16_t)(-1-counts), (int16_t)(((counts+2048)*1031 % 4096) - 2048)});
+    }
+    for(uint8_t batch : {1, 2, 3, 16}) {
+        DecoderStats stats;
+        DecodedStream decoded = RoundTrip(samples, batch, &stats);
+        CheckSamples(samples, decoded);
+        CHECK_EQUAL(0, stats.corrupted);
+        CHECK_EQUAL(0, stats.skipped_bytes);
+    }
+}
+
+TEST(frame_lengths) {
+    // Odd batch: the last packet is flushed with fewer samples
+    std::vector<std::array<int16_t, 3>> samples(7, {{100, -100, 1000}});
+    DecodedStream decoded = RoundTrip(samples, 3);
+    CheckSamples(samples, decoded);
+
+    uint8_t batch = PACKET_BATCHING ? 3 : 1;
+    CHECK_EQUAL((7 + batch-1)/batch, decoded.packets.size());
+    for(size_t i = 0; i < decoded.packets.size(); i++) {
+        const PacketInfo& packet = decoded.packets[i];
+        size_t length = ((i+1 < decoded.packets.size()) ? decoded.packets[i+1].offset : stream.size()) - packet.offset;
+#if PACKET_ENCODING == PACKET_ENCODING_DELTA
+        // Keyframe + 1 byte per axis (differences of 0)
+        CHECK_EQUAL(PACKET_OVERHEAD + 6 + 3*(packet.count-1), length);
+#else
+        CHECK_EQUAL(PACKET_OVERHEAD + PACKET_SAMPLES_BYTES(packet.count), length);
+#endif
+    }
+}
+
+TEST(random_walk_and_jumps) {
+    // Small differences (1 byte varints) and full scale jumps (2 bytes)
+    std::mt19937 random(7);
+    std::vector<std::array<int16_t, 3>> samples;
+    int16_t value[3] = {0, 0, 1000};
+    for(int i = 0; i < 20000; i++) {
+        for(int axis = 0; axis < 3; axis++) {
+            int step = (random() % 50 == 0) ? (int)(random() % 4096) - 2048 : (int)(random() % 129) - 64;
+            value[axis] = (int16_t)std::max(-2048, std::min(2047, value[axis] + step));
+        }
+        samples.push_back({value[0], value[1], value[2]});
+    }
+    DecoderStats stats;
+    CheckSamples(samples, RoundTrip(samples, PACKET_MAX_BATCH, &stats));
+    CHECK_EQUAL(0, stats.corrupted);
+    CHECK_EQUAL(0, stats.lost_packets);
+}
+
+TEST(byte_counters) {
+    uint32_t raw_before  = packet_raw_bytes;
+    uint32_t sent_before = packet_sent_bytes;
+    std::vector<std::array<int16_t, 3>> samples(40, {{1, 2, 3}});
+    RoundTrip(samples, PACKET_MAX_BATCH);
+    CHECK_EQUAL(40*BYTE_TO_SEND, packet_raw_bytes - raw_before);
+    CHECK_EQUAL(stream.size(), packet_sent_bytes - sent_before);
+}
+
+CHECK_MAIN()
+
+/* [] END OF FILE */
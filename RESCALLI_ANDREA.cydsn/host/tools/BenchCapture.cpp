@@ -0,0 +1,177 @@
+/* ========================================
+ *
+ * \file  BenchCapture.cpp
+ * \brief Write and read throughput of the capture files (see "Capture.h")
+ *
+ * Usage: bench_capture [GB of capture (default 2)] [path (default build/bench.cap)]
+ *
+ * A stream of full batches ("batching,integrity,marker,time", 400 Hz, a marker every
+ * 4096 packets) is written through CaptureWriter in 4 KB chunks, then read back:
+ *   sequential   every sample of every block through the mapped columns (sum of x, y, z),
+ *                once with the file dropped from the page cache (cold), once cached (warm)
+ *   random       seeks to random host times (SampleAtHostTime) and Read of 1 s of samples
+ * The file is removed at the end
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Capture.h"
+#include "FrameEncoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace lis3dh;
+
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Drops the clean pages of the file from the page cache
+void DropCache(const char* path) {
+    int file = open(path, O_RDONLY);
+    if(file >= 0) {
+        fdatasync(file);
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+}
+
+double SequentialRead(const CaptureReader& reader, double* checksum) {
+    auto   start = std::chrono::steady_clock::now();
+    double sum   = 0;
+    for(size_t block = 0; block < reader.blocks(); block++) {
+        CaptureBlock columns = reader.Block(block);
+        float partial = 0;
+        for(size_t i = 0; i < columns.count; i++) {
+            partial += columns.x[i] + columns.y[i] + columns.z[i];
+        }
+        sum += partial;
+    }
+    *checksum = sum;
+    return Seconds(start);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    double      gigabytes = (argc > 1) ? atof(argv[1]) : 2;
+    const char* path      = (argc > 2) ? argv[2] : "build/bench.cap";
+
+    FrameFormat format;
+    format.Parse("batching,integrity,marker,time");
+    FrameEncoder encoder(format);
+    size_t bytes_per_sample = CaptureBlockBytes(kCaptureBlockSamples, true)/kCaptureBlockSamples;
+    uint64_t target = (uint64_t)(gigabytes*1e9/bytes_per_sample);
+
+    // Write: the stream is encoded chunk by chunk, as it would come from the UART
+    CaptureWriter writer(format);
+    std::string   error;
+    if(!writer.Open(path, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::mt19937 random(1);
+    std::vector<uint8_t> chunk;
+    int16_t  samples[kMaxBatch][3];
+    int16_t  value[3] = {0, 0, 1000};
+    uint32_t time     = 0;
+    uint64_t stream_bytes = 0, encoded = 0;
+    double   encode_s = 0;
+    auto     start = std::chrono::steady_clock::now();
+    for(uint64_t packet = 0; encoded < target; packet++) {
+        auto encode_start = std::chrono::steady_clock::now();
+        if(packet % 4096 == 0) {
+            encoder.Marker((uint16_t)(packet/4096 % 2 ? 200 : 400), time, chunk);
+        }
+        for(int i = 0; i < kMaxBatch; i++) {
+            for(int axis = 0; axis < 3; axis++) {
+                value[axis] = (int16_t)std::max(-2048, std::min(2047, value[axis] + (int)(random() % 41) - 20));
+                samples[i][axis] = value[axis];
+            }
+        }
+        encoder.Samples(0, samples, kMaxBatch, time, chunk);
+        encoded += kMaxBatch;
+        time    += kMaxBatch*2500;
+        encode_s += Seconds(encode_start);
+        if(chunk.size() >= 4096) {
+            writer.Append(chunk.data(), chunk.size(), (int64_t)time*1000);
+            stream_bytes += chunk.size();
+            chunk.clear();
+        }
+    }
+    writer.Append(chunk.data(), chunk.size(), (int64_t)time*1000);
+    stream_bytes += chunk.size();
+    if(!writer.Close(&error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        remove(path);
+        return 1;
+    }
+    double write_s = Seconds(start) - encode_s;
+
+    CaptureReader reader;
+    if(!reader.Open(path, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        remove(path);
+        return 1;
+    }
+    double file_mb = (kCapturePage + reader.blocks()*CaptureBlockBytes(kCaptureBlockSamples, true))/1e6;
+    double msamples = reader.samples()/1e6;
+    printf("%s: %.0f MB, %.1f M samples (%.0f MB of stream), %zu blocks, %zu index entries\n",
+           path, file_mb, msamples, stream_bytes/1e6, reader.blocks(), reader.index_entries());
+    printf("%-22s %9s %12s\n", "", "MB/s", "Msamples/s");
+    printf("%-22s %9.0f %12.1f  (decode + write, encoding excluded)\n", "write", file_mb/write_s, msamples/write_s);
+
+    // Sequential: cold then warm
+    double checksum = 0, warm_checksum = 0;
+    reader.Close();
+    DropCache(path);
+    reader.Open(path);
+    reader.Advise(MADV_SEQUENTIAL);
+    double cold_s = SequentialRead(reader, &checksum);
+    printf("%-22s %9.0f %12.1f\n", "sequential (cold)", file_mb/cold_s, msamples/cold_s);
+    double warm_s = 1e30;
+    for(int run = 0; run < 3; run++) {
+        warm_s = std::min(warm_s, SequentialRead(reader, &warm_checksum));
+    }
+    printf("%-22s %9.0f %12.1f\n", "sequential (warm)", file_mb/warm_s, msamples/warm_s);
+
+    // Random: 1 s (400 samples) at random host times, cold
+    reader.Close();
+    DropCache(path);
+    reader.Open(path);
+    reader.Advise(MADV_RANDOM);
+    constexpr int kSeeks = 2000;
+    int64_t first_ns = reader.header().start_host_ns;
+    int64_t span_ns  = reader.header().end_host_ns - first_ns - 1000000000;
+    SampleColumns window;
+    size_t read = 0;
+    start = std::chrono::steady_clock::now();
+    for(int seek = 0; seek < kSeeks; seek++) {
+        window.clear();
+        uint64_t sample = reader.SampleAtHostTime(first_ns + (int64_t)(random() % (uint64_t)std::max<int64_t>(1, span_ns)));
+        read += reader.Read(sample, 400, window);
+    }
+    double random_s = Seconds(start);
+    printf("%-22s %9.1f us per seek + 1 s of samples (%zu samples read, cold)\n",
+           "random", random_s*1e6/kSeeks, read);
+
+    printf("checksums %s\n", (checksum == warm_checksum) ? "identical" : "DIFFERENT");
+    reader.Close();
+    remove(path);
+    return (checksum == warm_checksum) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,88 @@
+/* ========================================
+ *
+ * \file  BenchConversion.cpp
+ * \brief Throughput of the conversion of the firmware ("Conversion.c") on the host
+ *
+ * Usage: bench_conversion [millions of samples (default 16)]
+ *
+ * Integer multiply-shift of Conversion_ToMilliMs2 against the former float code of
+ * main.c, on the same random samples (HR +-2g, X, Y, Z per sample); best of a few runs.
+ * The host has an FPU: on the Cortex-M3 (software floating point) the float code
+ * costs far more, the ratio here is a lower bound
+ *
+ * ========================================
+*/
+
+// Includes
+extern "C" {
+    #include "Conversion.h"
+}
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kRuns = 5;
+
+// Former code of main.c, out of line as Conversion_ToMilliMs2 is
+__attribute__((noinline)) int32_t FormerFloat(const uint8_t* data) {
+    int16_t OutAcc = (int16_t)(data[0] | (data[1]<<8)) >> 4;
+    float   conv   = OutAcc/1000.0*9.81;
+    return (int16_t)(conv*1000);
+}
+
+template <typename Convert>
+double Bench(const std::vector<uint8_t>& raw, Convert convert, int64_t* checksum) {
+
+    double best = 1e30;
+    for(int run = 0; run < kRuns; run++) {
+        int64_t sum   = 0;
+        auto    start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < raw.size(); i += 2) {
+            sum += convert(&raw[i]);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best      = std::min(best, seconds);
+        *checksum = sum;
+    }
+    return best;
+
+} // end Bench
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    size_t samples = (size_t)((argc > 1) ? atof(argv[1]) : 16)*1000000;
+
+    std::mt19937 random(1);
+    std::vector<uint8_t> raw(samples*6);
+    for(size_t i = 0; i < raw.size(); i += 2) {
+        uint16_t value = (uint16_t)((random() & 0xFFF) << 4);
+        raw[i]   = (uint8_t)(value & 0xFF);
+        raw[i+1] = (uint8_t)(value >> 8);
+    }
+
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FS_2G);
+
+    int64_t integer_sum = 0, float_sum = 0;
+    double integer_s = Bench(raw, [](const uint8_t* data) {
+        return Conversion_ToMilliMs2(data);
+    }, &integer_sum);
+    double float_s = Bench(raw, FormerFloat, &float_sum);
+
+    printf("%zu samples (x3 axes), HR +-2g\n", samples);
+    printf("%-20s %8.2f ns/axis %8.1f Msamples/s\n", "integer (Conversion)", integer_s*1e9/(samples*3), samples/integer_s/1e6);
+    printf("%-20s %8.2f ns/axis %8.1f Msamples/s\n", "float (former)", float_s*1e9/(samples*3), samples/float_s/1e6);
+    printf("speed-up x%.2f, results %s\n", float_s/integer_s, (integer_sum == float_sum) ? "identical" : "DIFFERENT");
+
+    return (integer_sum == float_sum) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,146 @@
+/* ========================================
+ *
+ * \file  BenchDecoder.cpp
+ * \brief Throughput of the host decoder, per frame format
+ *
+ * Usage: bench_decoder [MB of stream per format (default 64)]
+ *
+ * A stream of full batches (16 samples, two sensors, a marker every 4096 frames)
+ * is encoded once in memory per format and decoded a few times, in MB/s of stream
+ * and millions of samples/s:
+ *   fresh    whole stream into new columns: the first write of every page of the
+ *            columns is a page fault (about half of the time on the test machine)
+ *   whole    whole stream into the same columns again, best run
+ *   chunks   1 MB at a time, the columns cleared after each chunk (as Capture.cpp
+ *            and ratecheck use the decoder: the columns stay in the cache), best run
+ *
+ * ========================================
+*/
+
+// Includes
+#include "FrameEncoder.h"
+#include "StreamDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace lis3dh;
+
+
+namespace {
+
+constexpr int    kRuns       = 5;
+constexpr size_t kChunkBytes = 1 << 20;
+
+// Stream of about 'bytes' bytes
+std::vector<uint8_t> MakeStream(const FrameFormat& format, size_t bytes) {
+
+    std::mt19937 random(1);
+    FrameEncoder encoder(format);
+    std::vector<uint8_t> stream;
+    stream.reserve(bytes + 256);
+
+    uint8_t count = format.batching ? kMaxBatch : 1;
+    int16_t samples[kMaxBatch][3];
+    int16_t value[3] = {0, 0, 1000};
+    uint32_t time = 0;
+
+    for(size_t frame = 0; stream.size() < bytes; frame++) {
+        if(format.odr_marker && (frame % 4096 == 0)) {
+            encoder.Marker(400, time, stream);
+        }
+        for(uint8_t i = 0; i < count; i++) {
+            for(int axis = 0; axis < 3; axis++) {
+                value[axis] = (int16_t)(value[axis] + (int)(random() % 41) - 20);
+                value[axis] = (int16_t)std::max(-2048, std::min(2047, (int)value[axis]));
+                samples[i][axis] = value[axis];
+            }
+        }
+        encoder.Samples((uint8_t)(frame % (format.sensor_id ? kMaxSensors : 1)), samples, count, time, stream);
+        time += count*2500;
+    }
+    return stream;
+
+} // end MakeStream
+
+
+void Bench(const char* options, size_t bytes) {
+
+    FrameFormat format;
+    format.Parse(options);
+    std::vector<uint8_t> stream = MakeStream(format, bytes);
+
+    double        fresh = 0, whole = 1e30, chunks = 1e30;
+    uint64_t      samples = 0;
+    DecodedStream decoded;
+    for(int run = 0; run < kRuns; run++) {
+
+        StreamDecoder decoder(format);
+        decoded.clear();
+
+        auto start = std::chrono::steady_clock::now();
+        decoder.Decode(stream.data(), stream.size(), decoded, true);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(run == 0) {
+            fresh = seconds;
+        }
+        else {
+            whole = std::min(whole, seconds);
+        }
+        samples = decoder.stats().samples;
+    }
+    for(int run = 0; run < kRuns; run++) {
+
+        StreamDecoder decoder(format);
+        DecodedStream chunk;
+
+        auto start = std::chrono::steady_clock::now();
+        for(size_t position = 0; position < stream.size(); ) {
+            size_t size = std::min(kChunkBytes, stream.size()-position);
+            position   += decoder.Decode(&stream[position], size, chunk, position+size == stream.size());
+            chunk.clear();
+        }
+        chunks = std::min(chunks, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    printf("%-40s %7.1f %7.1f %7.1f MB/s %7.1f %7.1f %7.1f Msamples/s %6.2f bytes/sample\n",
+           format.ToString().c_str(),
+           stream.size()/fresh/1e6, stream.size()/whole/1e6, stream.size()/chunks/1e6,
+           samples/fresh/1e6, samples/whole/1e6, samples/chunks/1e6,
+           (double)stream.size()/samples);
+
+} // end Bench
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    size_t megabytes = (argc > 1) ? (size_t)atoi(argv[1]) : 64;
+    size_t bytes     = megabytes << 20;
+
+    const char* formats[] = {
+        "",
+        "integrity",
+        "batching",
+        "batching,integrity",
+        "id,batching,integrity,marker,time",
+        "batching,raw12",
+        "id,batching,integrity,marker,time,raw12",
+        "batching,delta",
+        "id,batching,integrity,marker,time,delta",
+    };
+    printf("%-40s %7s %7s %7s      %7s %7s %7s\n", "", "fresh", "whole", "chunks", "fresh", "whole", "chunks");
+    for(const char* format : formats) {
+        Bench(format, bytes);
+    }
+
+    return 0;
+
+} // end main
+
+/* [] END OF FILE */
@@ -0,0 +1,64 @@
+/* ========================================
+ *
+ * \file  BenchFilter.cpp
+ * \brief Throughput of the filters of the firmware ("Filter.c") on the host
+ *
+ * Usage: bench_filter [millions of samples (default 4)]
+ *
+ * Filter_Process on the same random XYZ samples with each preset; best of a few runs.
+ * Time per sample and per biquad of one axis: the host figure, not the Cortex-M3 one
+ * (see the cycle budget in "Filter.h")
+ *
+ * ========================================
+*/
+
+// Includes
+extern "C" {
+    #include "Filter.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv) {
+
+    constexpr int kRuns = 5;
+    size_t samples = (size_t)((argc > 1) ? atof(argv[1]) : 4)*1000000;
+
+    std::mt19937 random(1);
+    std::vector<uint8_t> raw(samples*6);
+    for(size_t i = 0; i < raw.size(); i += 2) {
+        uint16_t value = (uint16_t)((random() & 0xFFF) << 4);
+        raw[i]   = (uint8_t)(value & 0xFF);
+        raw[i+1] = (uint8_t)(value >> 8);
+    }
+
+    printf("%zu samples (x3 axes)\n", samples);
+    printf("%-8s %6s %10s %12s %8s\n", "preset", "stages", "ns/sample", "ns/biquad", "kept");
+    for(int preset = 0; preset < FILTER_PRESETS; preset++) {
+        double   best = 1e30;
+        uint32_t kept = 0;
+        for(int run = 0; run < kRuns; run++) {
+            uint8_t filtered[6];
+            Filter_Configure(&filter_presets[preset]);
+            kept = 0;
+            auto start = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < raw.size(); i += 6) {
+                kept += Filter_Process(0, &raw[i], filtered);
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        int stages = filter_presets[preset].stages;
+        printf("%-8d %6d %10.2f %12.2f %8u\n", preset, stages, best*1e9/samples,
+               stages ? best*1e9/samples/(3*stages) : 0.0, kept);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
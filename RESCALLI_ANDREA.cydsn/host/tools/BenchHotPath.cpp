@@ -0,0 +1,224 @@
+/* ========================================
+ *
+ * \file  BenchHotPath.cpp
+ * \brief Routines of the firmware run on every sample, built unchanged for the host
+ *
+ * Usage: bench_hotpath_<variant> [millions of samples (default 4)]
+ *
+ * Built once per variant of the Makefile (as test_packet_<variant>) with the same -D
+ * as Packet.c, Conversion.c and I2C.c. Same pseudo-random samples as the 'B' command of
+ * "Profiler.c" (xorshift32); ns and instructions per sample, best of a few runs:
+ *   reconstruct   raw bytes --> 12-bit counts, 3 axes (the expression of Packet.c)
+ *   float         counts --> mm/s^2 in floating point, 3 axes (former code of main.c)
+ *   integer       Conversion_ToMilliMs2, 3 axes
+ *   pack          Packet_AddSample: encoding in DataBuffer, header/CRC/tail of the full
+ *                 packets (Transmit_Frame replaced by a byte count)
+ *   read          I2C_Peripheral_ReadRegister (CTRL_REG1) on the board model
+ *   read multi    I2C_Peripheral_ReadRegisterMulti (CTRL_REG1 ... CTRL_REG6) on the board model
+ * The I2C wrappers wait for the bus: their host time is the one of the board model, the
+ * bus time is given in simulated us (100 kHz). Instructions are counted by the PMU of the
+ * host (perf_event_open, user space): "-" where there is none (virtual machines). The
+ * counts of the Cortex-M3 come from the 'B' command on the target (PROFILER_INSTR_HEADER)
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Board.h"
+
+extern "C" {
+    #include "Conversion.h"
+    #include "I2C.h"
+    #include "Packet.h"
+    #include "Transmit.h"
+    #include "Utility.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef SIM_VARIANT
+    #define SIM_VARIANT "custom"
+#endif
+
+using namespace board;
+
+
+namespace {
+
+constexpr int kRuns = 5;
+
+uint64_t queued_bytes = 0;
+volatile int64_t sink = 0; // Results of the benchmarks (not optimized away)
+
+// Instructions retired in user space, if the host has a PMU
+class Instructions {
+public:
+    Instructions() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd_ = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~Instructions() {
+        if(fd_ >= 0) {
+            close(fd_);
+        }
+    }
+    bool available() const {
+        return fd_ >= 0;
+    }
+    uint64_t Read() const {
+        uint64_t count = 0;
+        if((fd_ < 0) || (read(fd_, &count, sizeof(count)) != sizeof(count))) {
+            return 0;
+        }
+        return count;
+    }
+private:
+    int fd_;
+};
+
+Instructions instructions;
+
+struct Result {
+    double ns;           // Per sample
+    double instructions; // Per sample (0: not counted)
+};
+
+// Former code of main.c, out of line as Conversion_ToMilliMs2 is
+__attribute__((noinline)) int32_t FormerFloat(const uint8_t* data) {
+    int16_t OutAcc = (int16_t)(data[0] | (data[1]<<8)) >> 4;
+    float   conv   = OutAcc/1000.0*9.81;
+    return (int16_t)(conv*1000);
+}
+
+__attribute__((noinline)) int32_t Reconstruct(const uint8_t* data) {
+    return (int16_t)(data[0] | (data[1]<<8)) >> 4;
+}
+
+// Runs 'routine' on every sample (6 bytes) of 'raw', best of kRuns
+template <typename Routine>
+Result Bench(const std::vector<uint8_t>& raw, Routine routine, int64_t* checksum) {
+
+    size_t samples = raw.size()/BYTE_TO_SEND;
+    Result best    = {1e30, 0};
+    for(int run = 0; run < kRuns; run++) {
+        int64_t  sum   = 0;
+        uint64_t first = instructions.Read();
+        auto     start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < raw.size(); i += BYTE_TO_SEND) {
+            sum += routine(&raw[i]);
+        }
+        double   seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t counted = instructions.Read() - first;
+        if(seconds*1e9/samples < best.ns) {
+            best = {seconds*1e9/samples, (double)counted/samples};
+        }
+        *checksum = sum;
+        sink      = sum;
+    }
+    return best;
+
+} // end Bench
+
+
+void Print(const char* name, const Result& result, const char* note = "") {
+
+    char counted[16] = "-";
+    if(instructions.available()) {
+        snprintf(counted, sizeof(counted), "%.1f", result.instructions);
+    }
+    printf("%-14s %10.2f %14s  %s\n", name, result.ns, counted, note);
+
+} // end Print
+
+} // namespace
+
+
+// Frames of Packet.c counted instead of queued for the UART
+extern "C" uint8_t Transmit_Frame(const uint8_t* frame, uint8_t length) {
+    (void)frame;
+    queued_bytes += length;
+    return NO_ERROR;
+}
+
+
+int main(int argc, char** argv) {
+
+    size_t samples = (size_t)((argc > 1) ? atof(argv[1]) : 4)*1000000;
+
+    // Same sequence as the 'B' command of Profiler.c
+    std::vector<uint8_t> raw(samples*BYTE_TO_SEND);
+    uint32_t seed = 0x2545F491;
+    for(uint8_t& byte : raw) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        byte = (uint8_t)seed;
+    }
+
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FS_2G);
+    Packet_SetBatch(PACKET_MAX_BATCH);
+
+    printf("%s: %zu samples, HR +-2g, %s\n", SIM_VARIANT, samples,
+           instructions.available() ? "instructions counted by the PMU" : "no PMU: instructions not counted");
+    printf("%-14s %10s %14s\n", "", "ns/sample", "instr/sample");
+
+    int64_t checksum = 0, integer_sum = 0, float_sum = 0;
+    Print("reconstruct", Bench(raw, [](const uint8_t* data) {
+        return Reconstruct(data) + Reconstruct(data+2) + Reconstruct(data+4);
+    }, &checksum));
+    Result float_result = Bench(raw, [](const uint8_t* data) {
+        return FormerFloat(data) + FormerFloat(data+2) + FormerFloat(data+4);
+    }, &float_sum);
+    Result integer_result = Bench(raw, [](const uint8_t* data) {
+        return Conversion_ToMilliMs2(data) + Conversion_ToMilliMs2(data+2) + Conversion_ToMilliMs2(data+4);
+    }, &integer_sum);
+    Print("float", float_result);
+    Print("integer", integer_result, (integer_sum == float_sum) ? "same results as float" : "DIFFERENT from float");
+
+    char packed[64];
+    Result pack_result = Bench(raw, [](const uint8_t* data) {
+        Packet_AddSample(0, data);
+        return 0;
+    }, &checksum);
+    snprintf(packed, sizeof(packed), "%.2f bytes queued per sample", (double)queued_bytes/(kRuns*samples));
+    Print("pack", pack_result, packed);
+
+    // I2C wrappers on the board model: a few thousand transfers are enough
+    Params params;
+    params.end = ~(Cycles)0 >> 1;
+    Board::Get().Configure(params);
+    std::vector<uint8_t> few(raw.begin(), raw.begin() + std::min<size_t>(raw.size(), 4096*BYTE_TO_SEND));
+    uint8_t registers[LIS3DH_CTRL_REGS];
+    Cycles  start = Board::Get().Now();
+    Result  read_result = Bench(few, [&](const uint8_t*) {
+        return (int32_t)I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, registers);
+    }, &checksum);
+    char bus[64];
+    snprintf(bus, sizeof(bus), "%.0f us of bus (simulated)", (double)(Board::Get().Now() - start)/kCyclesPerUs/(kRuns*few.size()/BYTE_TO_SEND));
+    Print("read", read_result, bus);
+    start = Board::Get().Now();
+    Result multi_result = Bench(few, [&](const uint8_t*) {
+        return (int32_t)I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REGS, registers);
+    }, &checksum);
+    snprintf(bus, sizeof(bus), "%.0f us of bus (simulated)", (double)(Board::Get().Now() - start)/kCyclesPerUs/(kRuns*few.size()/BYTE_TO_SEND));
+    Print("read multi", multi_result, bus);
+
+    return (integer_sum == float_sum) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,191 @@
+/* ========================================
+ *
+ * \file  CaptureTool.cpp
+ * \brief Indexed capture files (see "Capture.h"): conversion, summary, statistics of a range
+ *
+ * Usage: capture <options> <recording> <output.cap> [bit/s]
+ *          recording --> capture. A recording has no arrival times: with PACKET_TIMESTAMP
+ *          the host time of a chunk is the PSoC time of its last packet (the UART delay
+ *          left out), otherwise the position of its last byte at the UART rate (default
+ *          19200 bit/s, 10 bits per byte: an idle line makes it run fast)
+ *        capture <file.cap>
+ *          header and frequency segments of the index
+ *        capture <file.cap> <from s> <to s>
+ *          samples received between the two host times (from the start of the capture):
+ *          count, mean and RMS per sensor and axis, read through the index
+ *
+ * A logger reading the serial port calls CaptureWriter::Append with each chunk and
+ * the time it was received instead
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Capture.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace lis3dh;
+
+
+namespace {
+
+int Convert(const char* options, const char* recording, const char* output, double bit_rate) {
+
+    FrameFormat format;
+    if(!format.Parse(options) || !format.Check().empty()) {
+        fprintf(stderr, "Invalid options '%s' %s\n", options, format.Check().c_str());
+        return 2;
+    }
+
+    FILE* input = fopen(recording, "rb");
+    if(!input) {
+        perror(recording);
+        return 1;
+    }
+
+    CaptureWriter writer(format);
+    std::string   error;
+    if(!writer.Open(output, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        fclose(input);
+        return 1;
+    }
+
+    // PSoC time of the packets by offset in the stream
+    DecodedStream timed;
+    if(format.timestamp) {
+        StreamDecoder::Options decoder_options;
+        decoder_options.keep_packets = true;
+        StreamDecoder(format, decoder_options).DecodeFile(recording, timed);
+    }
+
+    // Small chunks: the host time of a sample is the one of its chunk
+    std::vector<uint8_t> chunk(64);
+    uint64_t position = 0;
+    size_t   size, packet = 0;
+    int64_t  host_ns = 0;
+    while((size = fread(chunk.data(), 1, chunk.size(), input)) > 0) {
+        position += size;
+        if(format.timestamp) {
+            while((packet < timed.packets.size()) && (timed.packets[packet].offset < position)) {
+                host_ns = (int64_t)timed.packets[packet++].time_us*1000;
+            }
+        }
+        else {
+            host_ns = (int64_t)(position*10*1e9/bit_rate);
+        }
+        if(!writer.Append(chunk.data(), size, host_ns)) {
+            break;
+        }
+    }
+    fclose(input);
+    if(!writer.Close(&error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const DecoderStats& stats = writer.stats();
+    printf("%s: %" PRIu64 " samples, %" PRIu64 " frames, %" PRIu64 " markers, %" PRIu64 " corrupted, %" PRIu64 " lost\n",
+           output, writer.samples(), stats.frames, stats.markers, stats.corrupted, stats.lost_packets);
+    return 0;
+
+} // end Convert
+
+
+void Summary(const char* path, const CaptureReader& reader) {
+
+    const CaptureHeader& header = reader.header();
+    double seconds = (header.end_host_ns - header.start_host_ns)/1e9;
+    printf("%s (%s): %" PRIu64 " samples in %zu blocks of %u, %zu index entries, %.1f s\n",
+           path, header.format, header.samples, reader.blocks(), header.block_samples,
+           reader.index_entries(), seconds);
+    printf("frames %" PRIu64 ", markers %" PRIu64 ", corrupted %" PRIu64 ", lost %" PRIu64 "\n",
+           header.frames, header.markers, header.corrupted, header.lost_packets);
+
+    // One line per frequency segment (the markers)
+    printf("%12s %10s %8s\n", "first sample", "host [s]", "ODR [Hz]");
+    for(size_t i = 0; i < reader.index_entries(); i++) {
+        const CaptureIndexEntry& entry = reader.index()[i];
+        if((i == 0) || (entry.kind == IndexKind::Marker)) {
+            printf("%12" PRIu64 " %10.3f %8u\n", entry.sample, (entry.host_ns - header.start_host_ns)/1e9, entry.odr);
+        }
+    }
+
+} // end Summary
+
+
+void Range(const CaptureReader& reader, double from, double to) {
+
+    int64_t  start = reader.header().start_host_ns;
+    uint64_t first = reader.SampleAtHostTime(start + (int64_t)(from*1e9));
+    uint64_t last  = reader.SampleAtHostTime(start + (int64_t)(to*1e9));
+
+    double   sum[kMaxSensors][3] = {}, squares[kMaxSensors][3] = {};
+    uint64_t count[kMaxSensors]  = {};
+    for(size_t block = (size_t)(first/reader.header().block_samples); block < reader.blocks(); block++) {
+        CaptureBlock columns = reader.Block(block);
+        if(columns.first >= last) {
+            break;
+        }
+        size_t begin = (size_t)((first > columns.first) ? first - columns.first : 0);
+        size_t end   = (size_t)std::min<uint64_t>(columns.count, last - columns.first);
+        for(size_t i = begin; i < end; i++) {
+            uint8_t sensor = columns.sensor[i] % kMaxSensors;
+            const float value[3] = {columns.x[i], columns.y[i], columns.z[i]};
+            for(int axis = 0; axis < 3; axis++) {
+                sum[sensor][axis]     += value[axis];
+                squares[sensor][axis] += value[axis]*value[axis];
+            }
+            count[sensor]++;
+        }
+    }
+
+    printf("samples %" PRIu64 " ... %" PRIu64 " (%.3f ... %.3f s, ODR %u Hz at the start)\n",
+           first, last, from, to, reader.OdrOfSample(first));
+    printf("%6s %10s %30s %30s\n", "sensor", "samples", "mean x y z [m/s^2]", "RMS x y z [m/s^2]");
+    for(int sensor = 0; sensor < kMaxSensors; sensor++) {
+        if(count[sensor] == 0) {
+            continue;
+        }
+        double n = (double)count[sensor];
+        printf("%6d %10" PRIu64 "   %9.4f %9.4f %9.4f   %9.4f %9.4f %9.4f\n", sensor, count[sensor],
+               sum[sensor][0]/n, sum[sensor][1]/n, sum[sensor][2]/n,
+               std::sqrt(squares[sensor][0]/n), std::sqrt(squares[sensor][1]/n), std::sqrt(squares[sensor][2]/n));
+    }
+
+} // end Range
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    if((argc == 4 || argc == 5) && !CaptureReader().Open(argv[1])) {
+        return Convert(argv[1], argv[2], argv[3], (argc == 5) ? atof(argv[4]) : 19200);
+    }
+    if((argc != 2) && (argc != 4)) {
+        fprintf(stderr, "Usage: %s <options> <recording> <output.cap> [bit/s]\n"
+                        "       %s <file.cap> [<from s> <to s>]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    CaptureReader reader;
+    std::string   error;
+    if(!reader.Open(argv[1], &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if(argc == 2) {
+        Summary(argv[1], reader);
+    }
+    else {
+        Range(reader, atof(argv[2]), atof(argv[3]));
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,237 @@
+/* ========================================
+ *
+ * \file  Compression.cpp
+ * \brief Compression of PACKET_ENCODING_DELTA ("Packet.c") on traces
+ *
+ * Usage: compression [<options> <recording>]...
+ *   without arguments: the built-in traces below
+ *   <options> <recording>: samples of a recorded stream (see decode), e.g.
+ *   "default" capture.bin; sim_<variant> --capture writes one
+ *
+ * Packet.c built with PACKET_BATCHING and PACKET_ENCODING_DELTA encodes every trace
+ * in full batches; its frames are decoded back (the counts must match) and measured:
+ * bytes per sample on the wire against MMS2 and RAW12 with the same batches,
+ * packet_raw_bytes/packet_sent_bytes, encode time per sample on the host
+ *
+ * ========================================
+*/
+
+// Includes
+#include "StreamDecoder.h"
+
+extern "C" {
+    #include "Conversion.h"
+    #include "I2C.h"
+    #include "Packet.h"
+    #include "Transmit.h"
+}
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#if (PACKET_ENCODING != PACKET_ENCODING_DELTA) || PACKET_SENSOR_ID || PACKET_INTEGRITY || PACKET_TIMESTAMP
+    #error "Build with the options of the delta variant (see the Makefile)"
+#endif
+
+using namespace lis3dh;
+
+
+namespace {
+
+typedef std::vector<std::array<int16_t, 3>> Trace; // 12-bit counts
+
+std::vector<uint8_t> stream;
+
+// Tilt at rest: 1 g spread on the axes, +-2 counts of noise
+Trace Static(size_t samples, std::mt19937& random) {
+    Trace trace;
+    for(size_t i = 0; i < samples; i++) {
+        trace.push_back({(int16_t)(120 + (int)(random() % 5) - 2),
+                         (int16_t)(-340 + (int)(random() % 5) - 2),
+                         (int16_t)(935 + (int)(random() % 5) - 2)});
+    }
+    return trace;
+}
+
+// Default source of the simulator at 100 Hz: 250 mg rotating at 1 Hz, 1 g on Z
+Trace Rotating(size_t samples, std::mt19937& random) {
+    Trace trace;
+    for(size_t i = 0; i < samples; i++) {
+        double angle = 2*M_PI*i/100.0;
+        trace.push_back({(int16_t)std::lround(250*std::cos(angle) + (int)(random() % 5) - 2),
+                         (int16_t)std::lround(250*std::sin(angle) + (int)(random() % 5) - 2),
+                         (int16_t)(1000 + (int)(random() % 5) - 2)});
+    }
+    return trace;
+}
+
+// Machine vibration: 500 mg at 37 Hz sampled at 400 Hz, +-8 counts of noise
+Trace Vibration(size_t samples, std::mt19937& random) {
+    Trace trace;
+    for(size_t i = 0; i < samples; i++) {
+        double value = 500*std::sin(2*M_PI*37*i/400.0);
+        trace.push_back({(int16_t)std::lround(value + (int)(random() % 17) - 8),
+                         (int16_t)std::lround(0.3*value + (int)(random() % 17) - 8),
+                         (int16_t)std::lround(1000 + 0.1*value + (int)(random() % 17) - 8)});
+    }
+    return trace;
+}
+
+// Worst case: every sample anywhere in the range
+Trace Random(size_t samples, std::mt19937& random) {
+    Trace trace;
+    for(size_t i = 0; i < samples; i++) {
+        trace.push_back({(int16_t)((int)(random() % 4096) - 2048),
+                         (int16_t)((int)(random() % 4096) - 2048),
+                         (int16_t)((int)(random() % 4096) - 2048)});
+    }
+    return trace;
+}
+
+// Counts of a recorded stream (mm/s^2 of MMS2 converted back: HR +-2g, 9.81 mm/s^2 per count)
+bool Load(const std::string& options, const std::string& path, Trace* trace) {
+
+    FrameFormat format;
+    if(!format.Parse(options) || !format.Check().empty()) {
+        fprintf(stderr, "Invalid options '%s'\n", options.c_str());
+        return false;
+    }
+    StreamDecoder::Options decoder_options;
+    decoder_options.keep_raw = true;
+    StreamDecoder decoder(format, decoder_options);
+    DecodedStream decoded;
+    std::string   error;
+    if(!decoder.DecodeFile(path, decoded, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    const SampleColumns& samples = decoded.samples;
+    for(size_t i = 0; i < samples.size(); i++) {
+        std::array<int16_t, 3> sample = {samples.raw_x[i], samples.raw_y[i], samples.raw_z[i]};
+        if(format.encoding == Encoding::Mms2) {
+            for(int16_t& value : sample) {
+                value = (int16_t)std::lround(value/9.81);
+            }
+        }
+        trace->push_back(sample);
+    }
+    return true;
+
+} // end Load
+
+
+void Report(const char* name, const Trace& trace) {
+
+    constexpr int kRuns = 5;
+    if(trace.empty()) {
+        return;
+    }
+
+    // OUT_x registers of the trace, left-justified
+    std::vector<uint8_t> raw(trace.size()*BYTE_TO_SEND);
+    for(size_t i = 0; i < trace.size(); i++) {
+        for(int axis = 0; axis < AXES; axis++) {
+            uint16_t left = (uint16_t)(trace[i][axis] << 4);
+            raw[i*BYTE_TO_SEND+2*axis]   = (uint8_t)(left & 0xFF);
+            raw[i*BYTE_TO_SEND+2*axis+1] = (uint8_t)(left >> 8);
+        }
+    }
+
+    double   best = 1e30;
+    uint32_t raw_bytes = 0, sent_bytes = 0;
+    for(int run = 0; run < kRuns; run++) {
+        stream.clear();
+        stream.reserve(raw.size() + raw.size()/8);
+        uint32_t raw_before  = packet_raw_bytes;
+        uint32_t sent_before = packet_sent_bytes;
+        Packet_SetBatch(PACKET_MAX_BATCH);
+
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < trace.size(); i++) {
+            Packet_AddSample(0, &raw[i*BYTE_TO_SEND]);
+        }
+        Packet_Flush();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        raw_bytes  = packet_raw_bytes - raw_before;
+        sent_bytes = packet_sent_bytes - sent_before;
+    }
+
+    // Decoded back: the encoding is lossless
+    FrameFormat format;
+    format.batching = true;
+    format.encoding = Encoding::Delta;
+    StreamDecoder::Options options;
+    options.keep_raw = true;
+    StreamDecoder decoder(format, options);
+    DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+    size_t errors = (decoded.samples.size() == trace.size()) ? 0 : trace.size();
+    for(size_t i = 0; !errors && (i < trace.size()); i++) {
+        errors += (decoded.samples.raw_x[i] != trace[i][0]) + (decoded.samples.raw_y[i] != trace[i][1]) +
+                  (decoded.samples.raw_z[i] != trace[i][2]);
+    }
+
+    size_t packets = (trace.size() + PACKET_MAX_BATCH-1)/PACKET_MAX_BATCH;
+    double samples = (double)trace.size();
+    printf("%-12s %9zu %8.2f %8.2f %8.2f %8.2f %10.1f  %s\n",
+           name, trace.size(),
+           (double)sent_bytes/samples,
+           (packets*3 + samples*BYTE_TO_SEND)/samples,                        // MMS2
+           (packets*3 + (trace.size()/2)*9 + (trace.size()%2)*5)/samples,     // RAW12 (full batches)
+           (double)raw_bytes/sent_bytes,
+           best*1e9/samples,
+           errors ? "MISMATCH" : "lossless");
+
+} // end Report
+
+} // namespace
+
+
+// Frames of the firmware are kept in memory instead of going to the UART
+extern "C" uint8_t Transmit_Frame(const uint8_t* frame, uint8_t length) {
+    stream.insert(stream.end(), frame, frame+length);
+    return NO_ERROR;
+}
+
+
+int main(int argc, char** argv) {
+
+    if(argc % 2 == 0) {
+        fprintf(stderr, "Usage: %s [<options> <recording>]...\n", argv[0]);
+        return 2;
+    }
+
+    Conversion_SetMode(CONVERSION_HIGH_RESOLUTION, CONVERSION_FS_2G);
+    printf("PACKET_ENCODING_DELTA, batches of %d samples; bytes per sample on the wire\n", PACKET_MAX_BATCH);
+    printf("%-12s %9s %8s %8s %8s %8s %10s\n",
+           "trace", "samples", "delta", "mms2", "raw12", "ratio", "ns/sample");
+
+    if(argc == 1) {
+        std::mt19937 random(1);
+        Report("static", Static(1000000, random));
+        Report("rotating", Rotating(1000000, random));
+        Report("vibration", Vibration(1000000, random));
+        Report("random", Random(1000000, random));
+        return 0;
+    }
+
+    for(int i = 1; i+1 < argc; i += 2) {
+        Trace trace;
+        if(!Load(argv[i], argv[i+1], &trace)) {
+            return 1;
+        }
+        std::string name = argv[i+1];
+        name = name.substr(name.find_last_of('/') + 1);
+        Report(name.c_str(), trace);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,83 @@
+/* ========================================
+ *
+ * \file  Decode.cpp
+ * \brief Decodes a recorded UART stream into CSV
+ *
+ * Usage: decode <options> <recording> [output.csv]
+ *   options: build options of the firmware, comma separated (see FrameFormat::Parse),
+ *            e.g. "batching,integrity,raw12"; "default" for the Bridge Control Panel format
+ *
+ * One line per sample: sensor, time [us] (PACKET_TIMESTAMP), x, y, z [m/s^2].
+ * The markers are written as comment lines, the counters of the decoder to stderr
+ *
+ * ========================================
+*/
+
+// Includes
+#include "StreamDecoder.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+using namespace lis3dh;
+
+
+int main(int argc, char** argv) {
+
+    if((argc < 3) || (argc > 4)) {
+        fprintf(stderr, "Usage: %s <options> <recording> [output.csv]\n", argv[0]);
+        return 2;
+    }
+
+    FrameFormat format;
+    if(!format.Parse(argv[1]) || !format.Check().empty()) {
+        fprintf(stderr, "Invalid options '%s' %s\n", argv[1], format.Check().c_str());
+        return 2;
+    }
+
+    StreamDecoder decoder(format);
+    DecodedStream decoded;
+    std::string   error;
+    if(!decoder.DecodeFile(argv[2], decoded, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    FILE* output = (argc == 4) ? fopen(argv[3], "w") : stdout;
+    if(!output) {
+        perror(argv[3]);
+        return 1;
+    }
+
+    fprintf(output, "sensor,time_us,x,y,z\n");
+    const SampleColumns& samples = decoded.samples;
+    size_t marker = 0;
+    for(size_t i = 0; i < samples.size(); i++) {
+        // Markers come before the samples taken at their frequency
+        while((marker < decoded.markers.size()) && (decoded.markers[marker].first_sample <= i)) {
+            fprintf(output, "# ODR %u Hz\n", decoded.markers[marker].odr);
+            marker++;
+        }
+        fprintf(output, "%u,%" PRIu64 ",%.3f,%.3f,%.3f\n",
+                samples.sensor[i],
+                format.timestamp ? samples.time_us[i] : 0,
+                samples.x[i], samples.y[i], samples.z[i]);
+    }
+
+    if(output != stdout) {
+        fclose(output);
+    }
+
+    const DecoderStats& stats = decoder.stats();
+    fprintf(stderr, "%" PRIu64 " bytes: %" PRIu64 " frames, %" PRIu64 " samples, %" PRIu64 " markers, "
+                    "%" PRIu64 " records, %" PRIu64 " text bytes, %" PRIu64 " bytes skipped, "
+                    "%" PRIu64 " corrupted (%" PRIu64 " CRC), %" PRIu64 " lost\n",
+            stats.bytes, stats.frames, stats.samples, stats.markers,
+            stats.records, stats.text_bytes, stats.skipped_bytes,
+            stats.corrupted, stats.crc_errors, stats.lost_packets);
+
+    return 0;
+
+} // end main
+
+/* [] END OF FILE */
@@ -0,0 +1,117 @@
+/* ========================================
+ *
+ * \file  LinkStats.cpp
+ * \brief Loss, corruption and burst statistics of a recorded UART stream
+ *
+ * Usage: linkstats <options> <recording> [<nominal packets/s> [tolerance %]]
+ *   options: build options of the firmware (see decode); "integrity" is needed
+ *            to count the lost packets, "time" to check the packet rate
+ *
+ * Frames sent = received + corrupted + lost: a frame that reaches the host damaged
+ * (wrong CRC or tail) is corruption, a sequence number never seen is a loss. Bursts:
+ * # gaps of 1, 2, ... consecutive lost packets. With PACKET_TIMESTAMP and a nominal
+ * rate, the packets of sensor 0 are counted per second of PSoC time (e.g. the
+ * 200 +-2 packets/s of the README: linkstats time,integrity capture.bin 200 1)
+ *
+ * ========================================
+*/
+
+// Includes
+#include "StreamDecoder.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+using namespace lis3dh;
+
+
+int main(int argc, char** argv) {
+
+    if((argc < 3) || (argc > 5)) {
+        fprintf(stderr, "Usage: %s <options> <recording> [<nominal packets/s> [tolerance %%]]\n", argv[0]);
+        return 2;
+    }
+
+    FrameFormat format;
+    if(!format.Parse(argv[1]) || !format.Check().empty()) {
+        fprintf(stderr, "Invalid options '%s' %s\n", argv[1], format.Check().c_str());
+        return 2;
+    }
+    double nominal   = (argc > 3) ? atof(argv[3]) : 0;
+    double tolerance = (argc > 4) ? atof(argv[4]) : 1;
+
+    StreamDecoder::Options options;
+    options.keep_packets = true;
+    StreamDecoder decoder(format, options);
+    DecodedStream decoded;
+    std::string   error;
+    if(!decoder.DecodeFile(argv[2], decoded, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const DecoderStats& stats = decoder.stats();
+    uint64_t received = stats.frames + stats.markers;
+    uint64_t sent     = received + stats.corrupted + stats.lost_packets;
+
+    printf("%s (%s): %" PRIu64 " bytes\n", argv[2], format.ToString().c_str(), stats.bytes);
+    printf("frames      %" PRIu64 " received (%" PRIu64 " markers), %" PRIu64 " samples\n",
+           received, stats.markers, stats.samples);
+    printf("corrupted   %" PRIu64 " (%" PRIu64 " CRC), %.4f %% of the frames sent\n",
+           stats.corrupted, stats.crc_errors, sent ? 100.0*stats.corrupted/sent : 0.0);
+    if(format.integrity) {
+        printf("lost        %" PRIu64 " in %" PRIu64 " gaps, %.4f %% of the frames sent\n",
+               stats.lost_packets, stats.sequence_gaps, sent ? 100.0*stats.lost_packets/sent : 0.0);
+        printf("bursts     ");
+        for(size_t n = 0; n < kLossBuckets; n++) {
+            if(stats.loss_bursts[n]) {
+                printf(" %zu%s: %" PRIu64, n+1, (n+1 == kLossBuckets) ? "+" : "", stats.loss_bursts[n]);
+            }
+        }
+        printf("\n");
+    }
+    else {
+        printf("lost        unknown without PACKET_INTEGRITY (no sequence number)\n");
+    }
+    printf("skipped     %" PRIu64 " text bytes, %" PRIu64 " records, %" PRIu64 " other bytes\n",
+           stats.text_bytes, stats.records, stats.skipped_bytes);
+
+    if(nominal <= 0) {
+        return 0;
+    }
+    if(!format.timestamp) {
+        fprintf(stderr, "The packet rate needs PACKET_TIMESTAMP\n");
+        return 2;
+    }
+
+    // Packets of sensor 0 per whole second of PSoC time (first and last second left out)
+    std::map<uint64_t, uint32_t> windows;
+    for(const PacketInfo& packet : decoded.packets) {
+        if(packet.sensor == 0) {
+            windows[packet.time_us/1000000]++;
+        }
+    }
+    if(windows.size() < 3) {
+        printf("rate        less than 3 s of packets\n");
+        return 0;
+    }
+    windows.erase(windows.begin());
+    windows.erase(std::prev(windows.end()));
+
+    uint32_t minimum = UINT32_MAX, maximum = 0, outside = 0;
+    uint64_t total   = 0;
+    for(const auto& window : windows) {
+        minimum = std::min(minimum, window.second);
+        maximum = std::max(maximum, window.second);
+        total  += window.second;
+        outside += (std::abs(window.second - nominal) > nominal*tolerance/100);
+    }
+    printf("rate        %zu windows of 1 s: min %u, mean %.2f, max %u packets/s; %u outside %.0f +-%.1f %%\n",
+           windows.size(), minimum, (double)total/windows.size(), maximum, outside, nominal, tolerance);
+
+    return outside ? 1 : 0;
+}
+
+/* [] END OF FILE */
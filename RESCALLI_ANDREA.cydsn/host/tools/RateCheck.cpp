@@ -0,0 +1,479 @@
+/* ========================================
+ *
+ * \file  RateCheck.cpp
+ * \brief Packet rate stability of a live serial port, a recorded stream or a capture
+ *
+ * Usage: ratecheck [--odr Hz] [--window s] [--tolerance %] [--decimation n] [--sensor n]
+ *                  [--baud bit/s] [--seconds s] <options> <input>
+ *   options:   build options of the firmware (see decode), ignored for a capture
+ *   input:     serial device (e.g. /dev/ttyACM0, read until --seconds or Ctrl-C),
+ *              recording of the UART stream, or capture (.cap, see "Capture.h")
+ *
+ * Checks, per frequency, the packets of one sensor against the nominal rate
+ * ODR / (decimation of the filter preset * samples per packet), e.g. the
+ * 200 +-2 packets/s of the README, in a single pass with fixed memory:
+ * - packets/s over windows of --window s (at least 10 nominal intervals) sliding by
+ *   a tenth of a window: intervals in the window / time between its first and last
+ *   packet. A window is ok within +-tolerance (default 1 %) of the nominal rate
+ * - histogram of the deviation of each interval from the nominal one (log2 of us:
+ *   bucket 0 --> 0, bucket n --> [2^(n-1), 2^n) us, the last one and above)
+ * - gaps: intervals longer than 1.5 nominal ones, and the packets missing in them
+ * - drift of the mean rate from the nominal one [ppm]
+ * Time of a packet: its TIME field (PACKET_TIMESTAMP, PSoC clock), otherwise the time
+ * it is received from a serial device (host clock: the UART and the USB bridge
+ * add their jitter). A recording without TIME has no time: it cannot be checked.
+ * Frequency: the last ODR marker (PACKET_ODR_MARKER), otherwise --odr. A capture is
+ * checked per sample (the packets are not kept, and the samples of a packet are
+ * one period apart): the unit is then samples/s.
+ *
+ * Output: one comment line, then one line per frequency:
+ *   odr=<Hz> unit=<packets|samples> nominal=<per s> windows=<#> ok=<#> min=<per s>
+ *   max=<per s> mean=<per s> drift_ppm=<ppm> gaps=<#> lost=<#> jitter_us=<counts>
+ *   verdict=<PASS|FAIL|SHORT>
+ * SHORT: not a single whole window. Exit code 1 if a frequency fails
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Capture.h"
+#include "StreamDecoder.h"
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace lis3dh;
+
+
+namespace {
+
+constexpr size_t   kJitterBuckets = 16;
+constexpr int      kSlots         = 10; // A window slides by 1/kSlots of its length
+constexpr uint32_t kMinIntervals  = 10; // Shortest window, in nominal intervals
+
+volatile sig_atomic_t stop = 0;
+
+struct RateParams {
+    double   window_s   = 1;
+    double   tolerance  = 1;  // [%]
+    uint32_t decimation = 1;
+    uint16_t odr        = 0;  // [Hz] For the packets before any marker (0: unknown)
+    uint8_t  sensor     = 0;
+};
+
+
+// Checks of every frequency, fed one packet at a time
+class RateChecker {
+public:
+
+    explicit RateChecker(const RateParams& params) : params_(params) {
+    }
+
+    // Packet of the checked sensor: time [us], frequency [Hz], # samples
+    void Add(uint64_t time_us, uint16_t odr, uint8_t count) {
+        if(odr == 0) {
+            odr = params_.odr;
+        }
+        if(odr == 0) {
+            unknown_++;
+            return;
+        }
+        if(!open_ || (odr != odr_) || (time_us < last_us_)) {
+            Open(time_us, odr, count);
+        }
+        else {
+            Interval(time_us);
+        }
+        Slot(time_us).count++;
+        Slot(time_us).last_us = time_us;
+    }
+
+    // One line per frequency; returns false if one fails
+    bool Report(FILE* output, const char* unit) const {
+        bool pass = true;
+        for(const auto& entry : stats_) {
+            const OdrStats& stats = entry.second;
+            double mean  = stats.elapsed_us ? stats.intervals*1e6/stats.elapsed_us : 0;
+            double drift = stats.elapsed_us ? (mean - stats.nominal)/stats.nominal*1e6 : 0;
+            const char* verdict = (stats.windows == 0) ? "SHORT" :
+                                  (stats.windows_ok == stats.windows) ? "PASS" : "FAIL";
+            fprintf(output, "odr=%u unit=%s nominal=%.3f windows=%" PRIu64 " ok=%" PRIu64
+                            " min=%.3f max=%.3f mean=%.3f drift_ppm=%.0f gaps=%" PRIu64
+                            " lost=%" PRIu64 " jitter_us=",
+                    entry.first, unit, stats.nominal, stats.windows, stats.windows_ok,
+                    stats.windows ? stats.min : 0.0, stats.max, mean, drift, stats.gaps, stats.lost);
+            for(size_t bucket = 0; bucket < kJitterBuckets; bucket++) {
+                fprintf(output, bucket ? ",%" PRIu64 : "%" PRIu64, stats.jitter[bucket]);
+            }
+            fprintf(output, " verdict=%s\n", verdict);
+            pass = pass && (stats.windows_ok == stats.windows);
+        }
+        return pass;
+    }
+
+    uint64_t unknown() const {
+        return unknown_;
+    }
+
+private:
+
+    struct OdrStats {
+        double   nominal    = 0;   // [1/s]
+        uint64_t windows    = 0;
+        uint64_t windows_ok = 0;
+        double   min        = 1e30;
+        double   max        = 0;
+        uint64_t gaps       = 0;
+        uint64_t lost       = 0;
+        uint64_t intervals  = 0;   // In the segments of this frequency
+        uint64_t elapsed_us = 0;
+        std::array<uint64_t, kJitterBuckets> jitter{};
+    };
+
+    struct SlotCounts {
+        uint32_t count    = 0;
+        uint64_t first_us = 0;     // Of the slot: first and last packet
+        uint64_t last_us  = 0;
+    };
+
+    // New segment: frequency changed, or time going back (a new recording)
+    void Open(uint64_t time_us, uint16_t odr, uint8_t count) {
+        OdrStats& stats = stats_[odr];
+        stats.nominal   = (double)odr/((double)params_.decimation*std::max<uint8_t>(count, 1));
+        interval_us_    = 1e6/stats.nominal;
+        slot_us_        = std::max(params_.window_s*1e6, kMinIntervals*interval_us_)/kSlots;
+        odr_            = odr;
+        open_           = true;
+        start_us_       = time_us;
+        last_us_        = time_us;
+        slot_           = 0;
+        slots_.fill(SlotCounts());
+        slots_[0].first_us = time_us;
+    }
+
+    SlotCounts& Slot(uint64_t time_us) {
+        Advance((uint64_t)((time_us - start_us_)/slot_us_));
+        SlotCounts& slot = slots_[slot_ % kSlots];
+        if(slot.count == 0) {
+            slot.first_us = time_us;
+        }
+        return slot;
+    }
+
+    // Closes the slots before 'slot': each one ends a window
+    void Advance(uint64_t slot) {
+        OdrStats& stats = stats_[odr_];
+        uint64_t  empty = 0;
+        while(slot_ < slot) {
+            if(slot_+1 >= kSlots) {
+                if(empty > kSlots) {
+                    // Nothing left in the window: the same empty window until 'slot'
+                    stats.windows += slot - slot_;
+                    stats.min      = 0;
+                    slot_          = slot;
+                    break;
+                }
+                Window(stats);
+            }
+            slot_++;
+            empty = slots_[slot_ % kSlots].count ? 0 : empty+1;
+            slots_[slot_ % kSlots] = SlotCounts();
+        }
+    }
+
+    // Rate of the kSlots slots ending at slot_
+    void Window(OdrStats& stats) {
+        uint32_t packets  = 0;
+        uint64_t first_us = UINT64_MAX, last_us = 0;
+        for(const SlotCounts& slot : slots_) {
+            if(slot.count) {
+                packets += slot.count;
+                first_us = std::min(first_us, slot.first_us);
+                last_us  = std::max(last_us, slot.last_us);
+            }
+        }
+        double rate = ((packets > 1) && (last_us > first_us)) ? (packets-1)*1e6/(last_us - first_us) : 0;
+        stats.windows++;
+        stats.windows_ok += std::fabs(rate - stats.nominal) <= stats.nominal*params_.tolerance/100;
+        stats.min = std::min(stats.min, rate);
+        stats.max = std::max(stats.max, rate);
+    }
+
+    void Interval(uint64_t time_us) {
+        OdrStats& stats   = stats_[odr_];
+        uint64_t interval = time_us - last_us_;
+        double   deviation = std::fabs(interval - interval_us_);
+        size_t   bucket    = (deviation < 0.5) ? 0 : std::min<size_t>(kJitterBuckets-1, (size_t)std::log2(deviation)+1);
+        stats.jitter[bucket]++;
+        if(interval > 1.5*interval_us_) {
+            stats.gaps++;
+            stats.lost += (uint64_t)std::lround(interval/interval_us_) - 1;
+        }
+        stats.intervals++;
+        stats.elapsed_us += interval;
+        last_us_ = time_us;
+    }
+
+    RateParams params_;
+    std::map<uint16_t, OdrStats> stats_;    // One per frequency (the few of the LIS3DH)
+    std::array<SlotCounts, kSlots> slots_{};
+    bool     open_        = false;
+    uint16_t odr_         = 0;
+    uint64_t start_us_    = 0;
+    uint64_t last_us_     = 0;
+    uint64_t slot_        = 0;              // Slot of the last packet, from the start of the segment
+    double   interval_us_ = 0;
+    double   slot_us_     = 0;
+    uint64_t unknown_     = 0;              // Packets without frequency (no marker, no --odr)
+};
+
+
+// Chunks of a UART stream --> packets of the checked sensor
+class StreamFeeder {
+public:
+
+    StreamFeeder(const FrameFormat& format, RateChecker& checker, uint8_t sensor)
+        : decoder_(format, Options()), checker_(checker), sensor_(sensor) {
+    }
+
+    // Chunk received at host time 'host_us' (used without PACKET_TIMESTAMP)
+    void Feed(const uint8_t* data, size_t size, uint64_t host_us, bool last = false) {
+        pending_.insert(pending_.end(), data, data+size);
+        size_t used = decoder_.Decode(pending_.data(), pending_.size(), decoded_, last);
+        pending_.erase(pending_.begin(), pending_.begin()+used);
+        for(const PacketInfo& packet : decoded_.packets) {
+            if(packet.sensor == sensor_) {
+                checker_.Add(decoder_.format().timestamp ? packet.time_us : host_us, packet.odr, packet.count);
+            }
+        }
+        decoded_.clear();
+    }
+
+    const DecoderStats& stats() const {
+        return decoder_.stats();
+    }
+
+private:
+
+    static StreamDecoder::Options Options() {
+        StreamDecoder::Options options;
+        options.keep_packets = true;
+        return options;
+    }
+
+    StreamDecoder        decoder_;
+    DecodedStream        decoded_;
+    std::vector<uint8_t> pending_;   // Beginning of a frame not complete yet
+    RateChecker&         checker_;
+    uint8_t              sensor_;
+};
+
+
+uint64_t HostMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool BaudConstant(long bit_rate, speed_t* speed) {
+    static const std::pair<long, speed_t> rates[] = {
+        {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200},
+        {230400, B230400}, {460800, B460800}, {921600, B921600}, {1000000, B1000000}
+    };
+    for(const auto& rate : rates) {
+        if(rate.first == bit_rate) {
+            *speed = rate.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Serial device, raw 8N1, until 'seconds' (0: Ctrl-C)
+bool ReadDevice(const char* path, long bit_rate, double seconds, StreamFeeder& feeder) {
+
+    speed_t speed;
+    if(!BaudConstant(bit_rate, &speed)) {
+        fprintf(stderr, "Unsupported rate %ld bit/s\n", bit_rate);
+        return false;
+    }
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if(fd < 0) {
+        perror(path);
+        return false;
+    }
+    termios tty;
+    if(tcgetattr(fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cc[VMIN]  = 1;
+        tty.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tty);
+        tcflush(fd, TCIFLUSH);
+    }
+
+    uint8_t  buffer[256];
+    uint64_t start = HostMicros();
+    while(!stop && ((seconds <= 0) || (HostMicros() - start < seconds*1e6))) {
+        pollfd ready = {fd, POLLIN, 0};
+        if(poll(&ready, 1, 100) <= 0) {
+            continue;
+        }
+        ssize_t size = read(fd, buffer, sizeof(buffer));
+        if(size <= 0) {
+            break;
+        }
+        feeder.Feed(buffer, (size_t)size, HostMicros());
+    }
+    feeder.Feed(nullptr, 0, HostMicros(), true);
+    close(fd);
+    return true;
+
+} // end ReadDevice
+
+// Recording, read in chunks (the memory does not grow with the file)
+bool ReadRecording(const char* path, StreamFeeder& feeder) {
+
+    FILE* input = fopen(path, "rb");
+    if(!input) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> chunk(1 << 16);
+    size_t size;
+    while((size = fread(chunk.data(), 1, chunk.size(), input)) > 0) {
+        feeder.Feed(chunk.data(), size, 0);
+    }
+    feeder.Feed(nullptr, 0, 0, true);
+    fclose(input);
+    return true;
+
+} // end ReadRecording
+
+// Capture: every sample of the sensor, block by block, ODR from the index
+void ReadCapture(const CaptureReader& reader, uint8_t sensor, RateChecker& checker) {
+
+    const CaptureIndexEntry* entry = reader.index();
+    const CaptureIndexEntry* end   = entry + reader.index_entries();
+    uint16_t odr = 0;
+    for(size_t block = 0; block < reader.blocks(); block++) {
+        CaptureBlock columns = reader.Block(block);
+        for(size_t i = 0; i < columns.count; i++) {
+            while((entry < end) && (entry->sample <= columns.first+i)) {
+                odr = entry++->odr;
+            }
+            if(columns.sensor[i] == sensor) {
+                checker.Add(columns.time_us[i], odr, 1);
+            }
+        }
+    }
+
+} // end ReadCapture
+
+void Usage(const char* name) {
+    fprintf(stderr, "Usage: %s [--odr Hz] [--window s] [--tolerance %%] [--decimation n] [--sensor n]\n"
+                    "       [--baud bit/s] [--seconds s] <options> <device|recording|capture.cap>\n", name);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    RateParams params;
+    long   bit_rate = 19200;
+    double seconds  = 0;
+    int    arg      = 1;
+    for(; (arg+1 < argc) && (strncmp(argv[arg], "--", 2) == 0); arg += 2) {
+        std::string option = argv[arg];
+        const char* value  = argv[arg+1];
+        if(option == "--odr")             params.odr = (uint16_t)atoi(value);
+        else if(option == "--window")     params.window_s = atof(value);
+        else if(option == "--tolerance")  params.tolerance = atof(value);
+        else if(option == "--decimation") params.decimation = (uint32_t)std::max(1, atoi(value));
+        else if(option == "--sensor")     params.sensor = (uint8_t)atoi(value);
+        else if(option == "--baud")       bit_rate = atol(value);
+        else if(option == "--seconds")    seconds = atof(value);
+        else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if(arg+2 != argc) {
+        Usage(argv[0]);
+        return 2;
+    }
+    const char* input = argv[arg+1];
+
+    RateChecker checker(params);
+    const char* unit = "packets";
+    std::string source;
+
+    CaptureReader reader;
+    struct stat   info;
+    if((stat(input, &info) == 0) && S_ISCHR(info.st_mode)) {
+        FrameFormat format;
+        if(!format.Parse(argv[arg]) || !format.Check().empty()) {
+            fprintf(stderr, "Invalid options '%s' %s\n", argv[arg], format.Check().c_str());
+            return 2;
+        }
+        signal(SIGINT, [](int) { stop = 1; });
+        StreamFeeder feeder(format, checker, params.sensor);
+        if(!ReadDevice(input, bit_rate, seconds, feeder)) {
+            return 1;
+        }
+        source = format.ToString() + (format.timestamp ? ", PSoC time" : ", host time of arrival");
+    }
+    else if(reader.Open(input)) {
+        if(!reader.header().timestamp) {
+            fprintf(stderr, "%s: no PSoC time in the capture (PACKET_TIMESTAMP)\n", input);
+            return 2;
+        }
+        ReadCapture(reader, params.sensor, checker);
+        unit   = "samples";
+        source = std::string(reader.header().format) + ", capture, PSoC time";
+    }
+    else {
+        FrameFormat format;
+        if(!format.Parse(argv[arg]) || !format.Check().empty()) {
+            fprintf(stderr, "Invalid options '%s' %s\n", argv[arg], format.Check().c_str());
+            return 2;
+        }
+        if(!format.timestamp) {
+            fprintf(stderr, "%s: a recording has no arrival times, the rate needs PACKET_TIMESTAMP\n", input);
+            return 2;
+        }
+        StreamFeeder feeder(format, checker, params.sensor);
+        if(!ReadRecording(input, feeder)) {
+            return 1;
+        }
+        source = format.ToString() + ", PSoC time";
+    }
+
+    printf("# %s (%s): sensor %u, windows of %.1f s (10 intervals at least), tolerance %.2f %%",
+           input, source.c_str(), params.sensor, params.window_s, params.tolerance);
+    if(checker.unknown()) {
+        printf(", %" PRIu64 " %s before any marker left out (--odr)", checker.unknown(), unit);
+    }
+    printf("\n");
+
+    return checker.Report(stdout, unit) ? 0 : 1;
+
+} // end main
+
+/* [] END OF FILE */
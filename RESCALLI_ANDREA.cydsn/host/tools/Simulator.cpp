@@ -0,0 +1,497 @@
+/* ========================================
+ *
+ * \file  Simulator.cpp
+ * \brief Runs the firmware on the board model and reports what reaches the host
+ *
+ * Usage: sim_<variant> [options]  (one executable per build variant, see the Makefile)
+ *   --time <s>          simulated time (default 60)
+ *   --odr <Hz>          frequency at startup: written in STARTUP_REG of the EEPROM
+ *   --sweep <s>         button pressed every <s> seconds: every sustainable frequency in turn
+ *   --press <ms>        button pressed at <ms> (repeatable)
+ *   --send <ms>:<c>     character <c> received via UART at <ms> (repeatable), e.g. 5000:D
+ *   --sensors <n>       LIS3DH on the bus (1: 0x18, 2: 0x18 and 0x19)
+ *   --ppm <ppm>         clock error of the LIS3DH
+ *   --call-us <us>      CPU time of a PSoC API call (default 1)
+ *   --baud <bit/s>      UART of the board (default 19200, as in TopDesign)
+ *   --i2c-hz <Hz>       I2C bus of the board (default 100000, as in TopDesign)
+ *   --i2c-nack <ms>     first I2C buffer transfer (MasterWriteBuf/ReadBuf) after <ms> NACKed (repeatable)
+ *   --i2c-hang <ms>     first I2C buffer transfer after <ms> never ends, lost interrupt (repeatable)
+ *   --eeprom <file>     EEPROM content loaded at startup (if the file exists) and saved at the end
+ *   --capture <file>    UART stream written to <file> (decode, linkstats, Bridge Control Panel)
+ *   --ber <p>           bits of the stream flipped with probability <p> before the host sees them
+ *   --replay <file>     samples of the LIS3DH taken from a recorded trace instead of the built-in
+ *                       source: a capture (see "Capture.h") or the CSV of decode, in m/s^2 (HR +-2g:
+ *                       1 mg per count), fed to the LIS3DH models behind the I2C master: the
+ *                       firmware runs unchanged
+ *   --golden <file>     frames of the stream compared byte by byte with those of a recorded
+ *                       stream (e.g. the one the trace comes from): exit code 1 if they differ
+ *   --text              text sent by the firmware (replies to the commands) printed
+ *   --check             exit code 1 if a sample has been lost at a sustainable frequency
+ *
+ * The stream is decoded with the options the variant has been built with. One line per
+ * frequency the sensor 0 has been set to (segments start at the write of CTRL_REG1):
+ * packets and samples received per second, samples lost in the sensor (overwritten
+ * before being read) and on the link (read but never received: frames dropped by the
+ * ring buffer of Transmit.c, or still queued at the end), I2C and UART utilisation,
+ * CPU active time (1 - time in WFI), latency from generation to read, longest main
+ * loop iteration (time between two UART_GetChar). The frequencies the firmware deems
+ * not sustainable (UART_BAUD_RATE, I2C_BUS_SPEED) are flagged: they are reached only by a
+ * variant built with faster links than the board has (see "unlimited" in the Makefile).
+ * With a replay, a last line gives the samples read per second of host time
+ *
+ * ========================================
+*/
+
+// Includes
+#include "Board.h"
+#include "Capture.h"
+#include "StreamDecoder.h"
+
+extern "C" {
+    #include "Packet.h"
+    #include "Storage.h"
+    #include "Transmit.h"
+    #include "Utility.h"
+
+    int firmware_main(void);
+}
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef SIM_VARIANT
+    #define SIM_VARIANT "custom"
+#endif
+
+using namespace board;
+
+
+namespace {
+
+// Time spent by sensor 0 at one frequency
+struct Segment {
+    uint16_t odr;
+    Counters start, end;
+    uint16_t dropped_start, dropped_end; // tx_dropped_frames
+    uint64_t packets  = 0;               // Received, from the decoded stream
+    uint64_t samples  = 0;
+};
+
+std::vector<Segment> segments;
+
+void CloseSegment() {
+    if(!segments.empty()) {
+        segments.back().end         = Board::Get().Snapshot();
+        segments.back().dropped_end = tx_dropped_frames;
+    }
+}
+
+void OpenSegment(uint16_t odr) {
+    CloseSegment();
+    if(odr == 0) {
+        return;
+    }
+    Segment segment;
+    segment.odr           = odr;
+    segment.start         = Board::Get().Snapshot();
+    segment.dropped_start = tx_dropped_frames;
+    Board::Get().ResetMaxLoop();
+    for(size_t i = 0; i < Board::Get().SensorCount(); i++) {
+        Board::Get().Sensor(i)->ResetLatencyMax();
+    }
+    segments.push_back(segment);
+}
+
+lis3dh::FrameFormat FirmwareFormat() {
+    lis3dh::FrameFormat format;
+    format.sensor_id  = PACKET_SENSOR_ID;
+    format.batching   = PACKET_BATCHING;
+    format.integrity  = PACKET_INTEGRITY;
+    format.odr_marker = PACKET_ODR_MARKER;
+    format.timestamp  = PACKET_TIMESTAMP;
+    format.encoding   = (lis3dh::Encoding)PACKET_ENCODING;
+    return format;
+}
+
+bool Sustainable(uint16_t odr) {
+    for(uint8_t i = 0; i < LIS3DH_ODR_COUNT; i++) {
+        if(lis3dh_odr_table[i].frequency == odr) {
+            return LIS3DH_ODR_IsSustainable(i);
+        }
+    }
+    return false;
+}
+
+double Percent(Cycles part, Cycles total) {
+    return total ? 100.0*(double)part/(double)total : 0.0;
+}
+
+double Ms(double cycles) {
+    return cycles/(double)kCyclesPerMs;
+}
+
+typedef std::vector<std::array<int16_t, 3>> Trace; // [mg] = counts at HR +-2g
+
+// Samples of one sensor of a capture, or of the CSV of decode (sensor,time_us,x,y,z [m/s^2])
+bool LoadTrace(const std::string& path, uint8_t sensor, Trace* trace) {
+
+    auto add = [&](double x, double y, double z) {
+        trace->push_back({(int16_t)std::lround(x*1000/9.81), (int16_t)std::lround(y*1000/9.81),
+                          (int16_t)std::lround(z*1000/9.81)});
+    };
+
+    lis3dh::CaptureReader capture;
+    if(capture.Open(path)) {
+        for(size_t block = 0; block < capture.blocks(); block++) {
+            lis3dh::CaptureBlock columns = capture.Block(block);
+            for(size_t i = 0; i < columns.count; i++) {
+                if(columns.sensor[i] == sensor) {
+                    add(columns.x[i], columns.y[i], columns.z[i]);
+                }
+            }
+        }
+        return true;
+    }
+
+    FILE* file = fopen(path.c_str(), "r");
+    if(!file) {
+        perror(path.c_str());
+        return false;
+    }
+    char line[256];
+    while(fgets(line, sizeof(line), file)) {
+        unsigned id;
+        unsigned long long time_us;
+        double   x, y, z;
+        if((sscanf(line, "%u,%llu,%lf,%lf,%lf", &id, &time_us, &x, &y, &z) == 5) && (id == sensor)) {
+            add(x, y, z);
+        }
+    }
+    fclose(file);
+    return true;
+
+} // end LoadTrace
+
+
+// Frames of a stream (offset, length), markers included, in stream order
+std::vector<std::pair<uint64_t, uint16_t>> Frames(const std::vector<uint8_t>& stream) {
+
+    lis3dh::StreamDecoder::Options options;
+    options.keep_packets = true;
+    lis3dh::StreamDecoder decoder(FirmwareFormat(), options);
+    lis3dh::DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+
+    std::vector<std::pair<uint64_t, uint16_t>> frames;
+    for(const auto* list : {&decoded.packets, &decoded.markers}) {
+        for(const lis3dh::PacketInfo& info : *list) {
+            frames.emplace_back(info.offset, info.length);
+        }
+    }
+    std::sort(frames.begin(), frames.end());
+    return frames;
+
+} // end Frames
+
+
+// Frames of 'stream' against those of the golden stream, byte by byte. Returns true if identical.
+// With 'looped' (the trace has been replayed past its end) the frames after the golden ones are not compared
+bool CompareGolden(const std::vector<uint8_t>& stream, const std::string& path, bool looped) {
+
+    std::vector<uint8_t> golden;
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file) {
+        perror(path.c_str());
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t  size;
+    while((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        golden.insert(golden.end(), buffer, buffer+size);
+    }
+    fclose(file);
+
+    auto   frames        = Frames(stream);
+    auto   golden_frames = Frames(golden);
+    size_t common        = std::min(frames.size(), golden_frames.size());
+    size_t first_diff    = common;
+    for(size_t i = 0; (i < common) && (first_diff == common); i++) {
+        if((frames[i].second != golden_frames[i].second) ||
+           memcmp(&stream[frames[i].first], &golden[golden_frames[i].first], frames[i].second) != 0) {
+            first_diff = i;
+        }
+    }
+
+    bool identical = (first_diff == common) &&
+                     ((frames.size() == golden_frames.size()) || (looped && (frames.size() > golden_frames.size())));
+    printf("Golden %s: %zu frames, %zu in this run; ", path.c_str(), golden_frames.size(), frames.size());
+    if(identical && (frames.size() > golden_frames.size())) {
+        printf("frames identical (%zu more, from the trace replayed again: not compared)\n",
+               frames.size() - golden_frames.size());
+    }
+    else if(identical) {
+        printf("frames identical (whole stream %s)\n", (stream == golden) ? "identical" : "differs outside the frames");
+    }
+    else if(first_diff < common) {
+        printf("DIFFERENT from frame %zu (offset %" PRIu64 " here, %" PRIu64 " in the golden stream)\n",
+               first_diff, frames[first_diff].first, golden_frames[first_diff].first);
+    }
+    else {
+        printf("DIFFERENT: the first %zu frames are identical\n", common);
+    }
+    return identical;
+
+} // end CompareGolden
+
+
+void Usage(const char* name) {
+    fprintf(stderr, "Usage: %s [--time s] [--odr Hz] [--sweep s] [--press ms] [--send ms:c] [--sensors n]\n"
+                    "       [--ppm ppm] [--call-us us] [--baud bit/s] [--i2c-hz Hz] [--i2c-nack ms]\n"
+                    "       [--i2c-hang ms] [--eeprom file] [--capture file] [--ber p] [--replay file]\n"
+                    "       [--golden file] [--text] [--check]\n", name);
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+
+    Params      params;
+    double      seconds  = 60;
+    int         odr      = 0;
+    double      sweep    = 0;
+    double      ber      = 0;
+    bool        text     = false;
+    bool        check    = false;
+    std::string eeprom_file, capture_file, replay_file, golden_file;
+    std::vector<Cycles> presses;
+    std::vector<std::pair<Cycles, uint8_t>> received;
+
+    for(int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        const char* value  = (i+1 < argc) ? argv[i+1] : nullptr;
+        bool        flag   = (option == "--text") || (option == "--check");
+        if(!flag && !value) {
+            Usage(argv[0]);
+            return 2;
+        }
+        if(option == "--time")          seconds = atof(value);
+        else if(option == "--odr")      odr = atoi(value);
+        else if(option == "--sweep")    sweep = atof(value);
+        else if(option == "--press")    presses.push_back((Cycles)(atof(value)*kCyclesPerMs));
+        else if(option == "--sensors")  params.sensors = atoi(value);
+        else if(option == "--ppm")      params.odr_error_ppm = atof(value);
+        else if(option == "--call-us")  params.call_cycles = (Cycles)(atof(value)*kCyclesPerUs);
+        else if(option == "--baud")     params.uart_byte_cycles = kBusClockHz*10/(Cycles)atol(value);
+        else if(option == "--i2c-hz")   params.i2c_bit_cycles = kBusClockHz/(Cycles)atol(value);
+        else if(option == "--i2c-nack") params.i2c_nacks.push_back((Cycles)(atof(value)*kCyclesPerMs));
+        else if(option == "--i2c-hang") params.i2c_hangs.push_back((Cycles)(atof(value)*kCyclesPerMs));
+        else if(option == "--eeprom")   eeprom_file = value;
+        else if(option == "--capture")  capture_file = value;
+        else if(option == "--ber")      ber = atof(value);
+        else if(option == "--replay")   replay_file = value;
+        else if(option == "--golden")   golden_file = value;
+        else if(option == "--text")     text = true;
+        else if(option == "--check")    check = true;
+        else if(option == "--send") {
+            const char* colon = strchr(value, ':');
+            if(!colon || !colon[1]) {
+                Usage(argv[0]);
+                return 2;
+            }
+            received.emplace_back((Cycles)(atof(value)*kCyclesPerMs), (uint8_t)colon[1]);
+        }
+        else {
+            Usage(argv[0]);
+            return 2;
+        }
+        i += !flag;
+    }
+
+    params.end = (Cycles)(seconds*kBusClockHz);
+    Board& board = Board::Get();
+    board.Configure(params);
+
+    // Initial content of the EEPROM
+    if(!eeprom_file.empty()) {
+        if(FILE* file = fopen(eeprom_file.c_str(), "rb")) {
+            size_t read = fread(board.Eeprom().data(), 1, board.Eeprom().size(), file);
+            (void)read;
+            fclose(file);
+        }
+    }
+    if(odr) {
+        bool found = false;
+        for(uint8_t i = 0; i < LIS3DH_ODR_COUNT; i++) {
+            if(lis3dh_odr_table[i].frequency == odr) {
+                board.Eeprom()[STARTUP_REG] = lis3dh_odr_table[i].ctrl_reg1;
+                found = true;
+            }
+        }
+        if(!found) {
+            fprintf(stderr, "No frequency of %d Hz in lis3dh_odr_table\n", odr);
+            return 2;
+        }
+    }
+
+    // Script
+    if(sweep > 0) {
+        for(double t = sweep; t < seconds; t += sweep) {
+            presses.push_back((Cycles)(t*kBusClockHz));
+        }
+    }
+    std::sort(presses.begin(), presses.end());
+    for(Cycles press : presses) {
+        board.PressButton(press);
+    }
+    std::sort(received.begin(), received.end());
+    for(const auto& character : received) {
+        board.ReceiveChar(character.first, character.second);
+    }
+    board.Sensor(0)->SetOdrListener([](uint16_t frequency, Cycles) {
+        OpenSegment(frequency);
+    });
+
+    // Recorded samples in the LIS3DH models
+    Trace trace[2];
+    if(!replay_file.empty()) {
+        for(uint8_t sensor = 0; sensor < (uint8_t)board.SensorCount(); sensor++) {
+            if(!LoadTrace(replay_file, sensor, &trace[sensor])) {
+                return 1;
+            }
+            if(trace[sensor].empty()) {
+                continue;
+            }
+            const Trace& samples = trace[sensor];
+            board.Sensor(sensor)->SetSource([&samples](uint64_t index, Cycles, int16_t mg[3]) {
+                const auto& sample = samples[index % samples.size()];
+                std::copy(sample.begin(), sample.end(), mg);
+            });
+        }
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    try {
+        firmware_main();
+        fprintf(stderr, "The firmware returned from main\n");
+    }
+    catch(const End&) {
+    }
+    double host_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    CloseSegment();
+
+    // Line errors, then decoding of the stream, packets assigned to the segments by position
+    std::vector<uint8_t> stream = board.UartOutput();
+    if(ber > 0) {
+        std::mt19937_64 random(1);
+        std::geometric_distribution<uint64_t> next_error(ber);
+        for(uint64_t bit = next_error(random); bit < stream.size()*8; bit += 1 + next_error(random)) {
+            stream[bit/8] ^= (uint8_t)(1 << (bit%8));
+        }
+    }
+    lis3dh::StreamDecoder::Options options;
+    options.keep_packets = true;
+    options.keep_text    = text;
+    lis3dh::StreamDecoder decoder(FirmwareFormat(), options);
+    lis3dh::DecodedStream decoded;
+    decoder.Decode(stream.data(), stream.size(), decoded, true);
+
+    size_t current = 0;
+    for(const lis3dh::PacketInfo& packet : decoded.packets) {
+        while((current+1 < segments.size()) && (packet.offset >= segments[current+1].start.uart_bytes)) {
+            current++;
+        }
+        if(!segments.empty() && (packet.offset >= segments[current].start.uart_bytes)) {
+            segments[current].packets++;
+            segments[current].samples += packet.count;
+        }
+    }
+
+    if(!capture_file.empty()) {
+        FILE* file = fopen(capture_file.c_str(), "wb");
+        if(!file || (fwrite(stream.data(), 1, stream.size(), file) != stream.size())) {
+            perror(capture_file.c_str());
+            return 1;
+        }
+        fclose(file);
+    }
+    if(!eeprom_file.empty()) {
+        FILE* file = fopen(eeprom_file.c_str(), "wb");
+        if(!file || (fwrite(board.Eeprom().data(), 1, board.Eeprom().size(), file) != board.Eeprom().size())) {
+            perror(eeprom_file.c_str());
+            return 1;
+        }
+        fclose(file);
+    }
+
+    // Report
+    printf("Variant %s (%s), %.1f s, %d sensor(s), API call %.2f us, ODR error %.0f ppm, "
+           "UART %" PRIu64 " bit/s, I2C %" PRIu64 " Hz\n",
+           SIM_VARIANT, FirmwareFormat().ToString().c_str(), seconds, params.sensors,
+           (double)params.call_cycles/kCyclesPerUs, params.odr_error_ppm,
+           kBusClockHz*10/params.uart_byte_cycles, kBusClockHz/params.i2c_bit_cycles);
+    printf("%8s %7s %8s %10s %9s %8s %8s %8s %6s %6s %6s %9s %9s %9s\n",
+           "ODR[Hz]", "time[s]", "pkt/s", "samples/s", "generated", "sensor", "link", "tx-drop",
+           "I2C%", "UART%", "CPU%", "lat[ms]", "latmax", "loop[ms]");
+
+    bool failed = false;
+    for(const Segment& segment : segments) {
+        Cycles   time      = segment.end.time - segment.start.time;
+        double   s         = (double)time/kBusClockHz;
+        uint64_t generated = segment.end.sensors.generated - segment.start.sensors.generated;
+        uint64_t read      = segment.end.sensors.read - segment.start.sensors.read;
+        uint64_t lost      = segment.end.sensors.overwritten - segment.start.sensors.overwritten;
+        // Samples read and not received (filters of "Filter.h" aside, decimation 1)
+        uint64_t link      = (read > segment.samples) ? read-segment.samples : 0;
+        uint16_t dropped   = (uint16_t)(segment.dropped_end - segment.dropped_start);
+        uint64_t latency   = segment.end.sensors.latency_sum - segment.start.sensors.latency_sum;
+        if(s <= 0) {
+            continue;
+        }
+        printf("%8u %7.2f %8.1f %10.1f %9" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8u %6.1f %6.1f %6.1f %9.3f %9.3f %9.3f%s\n",
+               segment.odr, s, segment.packets/s, segment.samples/s, generated, lost, link, dropped,
+               Percent(segment.end.i2c_busy - segment.start.i2c_busy, time),
+               Percent(segment.end.uart_busy - segment.start.uart_busy, time),
+               100.0 - Percent(segment.end.sleep - segment.start.sleep, time),
+               read ? Ms((double)latency/read) : 0.0,
+               Ms((double)segment.end.sensors.latency_max),
+               Ms((double)segment.end.max_loop),
+               Sustainable(segment.odr) ? "" : "  (not sustainable)");
+        // The last packet of a segment can still be in the ring buffer: one batch of slack
+        if(Sustainable(segment.odr) && ((lost > 0) || (dropped > 0) || (link > PACKET_MAX_BATCH))) {
+            failed = true;
+        }
+    }
+
+    const lis3dh::DecoderStats& stats = decoder.stats();
+    printf("UART: %zu bytes, %" PRIu64 " frames, %" PRIu64 " markers, %" PRIu64 " text bytes, "
+           "%" PRIu64 " corrupted, %" PRIu64 " skipped\n",
+           stream.size(), stats.frames, stats.markers, stats.text_bytes, stats.corrupted, stats.skipped_bytes);
+    if(text && !decoded.text.empty()) {
+        printf("-- text --\n%s", decoded.text.c_str());
+    }
+
+    // Samples read by the firmware per second of host time
+    bool looped = false;
+    if(!replay_file.empty()) {
+        uint64_t read = board.Snapshot().sensors.read;
+        looped = (read > trace[0].size() + trace[1].size());
+        printf("Replay of %s (%zu samples): %" PRIu64 " samples read, %.0f samples/s (host time, %.2f s)\n",
+               replay_file.c_str(), trace[0].size(), read, read/host_s, host_s);
+    }
+
+    bool golden_ok = golden_file.empty() || CompareGolden(stream, golden_file, looped);
+
+    return ((check && failed) || !golden_ok) ? 1 : 0;
+}
+
+/* [] END OF FILE */
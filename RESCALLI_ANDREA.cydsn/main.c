@@ -28,39 +28,86 @@
 #include "InterruptRoutines.h"
 #include "I2C.h"
 #include "Utility.h"
+#include "Transmit.h"
+#include "Packet.h"
+#include "Profiler.h"
+#include "Storage.h"
+#include "Filter.h"
+#include "Idle.h"
 #include <stdio.h>
 
 
 // Defines
-    // EEPROM register where the frequency for the LIS3DH is stored
-#define STARTUP_REG          0x0000  
-    // Macros for the packet of data to be sent via UART
-#define HEADER               0xA0
-#define TAIL                 0xC0
-#define AXES                 3
-#define BYTE_TO_SEND         2*AXES
-#define TRANSMIT_BUFFER_SIZE 1+BYTE_TO_SEND+1
-    // Macros for the convertion of data (justified in the code)
-#define DIGIT_TO_G           1000.0
-#define G_TO_MS2             9.81
+    // EEPROM journal where the frequency for the LIS3DH is stored is found in the "Storage.h" header file
+    // Macros for the packet of data to be sent via UART are found in the "Packet.h" header file
+    // The convertion of data into m/s^2 is found in the "Conversion.h" header file
+    // Acquisition modes
+#define ACQUISITION_POLLING  0   // Poll STATUS_REG, then read one sample
+#define ACQUISITION_FIFO     1   // LIS3DH FIFO in Stream mode, drained with a single burst read
+#define ACQUISITION_INTERRUPT 2  // LIS3DH data ready on INT1 --> ISR_DataReady, no STATUS_REG poll
+#ifndef ACQUISITION_MODE
+    #define ACQUISITION_MODE ACQUISITION_POLLING
+#endif
+    // ACQUISITION_INTERRUPT needs two components the TopDesign does not have yet:
+    // a Digital Input Pin (HW connection, no resistive pull) on a free pin (e.g. P12.2),
+    // wired to INT1 of the LIS3DH, driving an isr named ISR_DataReady (InterruptType RISING_EDGE).
+    // cyfitter.h defines ISR_DataReady__INTC_NUMBER once they are placed
+#if (ACQUISITION_MODE == ACQUISITION_INTERRUPT) && !defined(ISR_DataReady__INTC_NUMBER)
+    #error "ACQUISITION_INTERRUPT needs ISR_DataReady and the INT1 pin in TopDesign (see above)"
+#endif
+#define FIFO_DRAIN_PERIOD    20  // [ms] Time between two FIFO drains (32 samples last 23.8 ms at 1.344 kHz)
+    // Startup
+#ifndef FAST_BOOT
+    #define FAST_BOOT        1   // 1 --> probe only the LIS3DH adresses, single configuration write, no prints
+                                 // 0 --> full bus scan and register dump at startup (first version)
+                                 // The startup prints are gone by default: see BRIDGE_CONTROL_PANEL_CONFIG_FILES/README.txt
+#endif
+#define DIAGNOSTIC_CMD       'S' // Character to be received via UART to scan the bus (see LIS3DH_Diagnostic)
+#define VERIFY_CMD           'V' // Character to be received via UART to check the LIS3DH registers (see LIS3DH_Shadow_Verify)
+#define FIFO_REPORT_CMD      'Q' // Character to be received via UART to report the FIFO drains (see LIS3DH_FIFO_Report)
     // Macros for the LIS3DH are found in the "Utility.h" header file
 
 
 // Useful variables
-uint8_t count_push         = 0; // Variable that tracks the cycling of frequencies
+uint8_t odr_index          = 0; // Entry of lis3dh_odr_table currently in use
 uint8_t init_ctrl_reg1     = 0; // Varaible that stores the initial setting for 
                                 // LIS3DH CONTROL REGISTER 1 (which sets the frequency)   
 
-uint8_t DataBuffer[TRANSMIT_BUFFER_SIZE] = {'\0'}; // Buffer with XYZ data to be sent
 uint8_t AccelerationData[BYTE_TO_SEND]   = {'\0'}; // Temporary buffer
 
-int16_t OutAcc = 0;    // Auxiliary variable
-float conv     = 0.0;  // Auxiliary variable   
+uint16_t overrun_count = 0; // # times the LIS3DH overwrote data that had not been read yet
+
+#if FILTER_ENABLED
+uint8_t filter_preset = 0; // Entry of filter_presets in use
+#endif
+
+uint32_t first_sample_ms = 0; // [ms] Time from startup to the first sample
+char     command         = 0; // Character received via UART
+
+#if ACQUISITION_MODE == ACQUISITION_FIFO
+uint8_t FifoData[LIS3DH_FIFO_SIZE*BYTE_TO_SEND] = {'\0'}; // Samples drained from the FIFO
+uint8_t fifo_samples   = 0; // # samples pulled by the last drain
+uint32_t next_drain_ms = 0; // [ms] Time of the next FIFO drain
+#endif
+
+#if ACQUISITION_MODE == ACQUISITION_POLLING
+uint8_t next_sensor = 0; // Sensor polled first (round robin)
+uint8_t sample_found = 0; // A sensor had new data in the last round robin
+uint32_t next_poll_ms = 0; // [ms] Time of the next round robin (see IDLE_POLL_INTERVAL)
+#if LIS3DH_COMBINED_READ
+uint8_t StatusData[1+BYTE_TO_SEND] = {'\0'}; // STATUS_REG followed by the axes
+#endif
+#endif
+
+#if ACQUISITION_MODE == ACQUISITION_INTERRUPT
+uint8_t read_handle = I2C_ASYNC_INVALID; // Asynchronous read of the axes in flight
+uint8_t read_state  = I2C_ASYNC_FREE;    // State of the asynchronous read
+uint32_t read_deadline_us = 0;           // [us] Time after which the read in flight is aborted
+#endif
 
                                     
 // TEST VARAIBLES
 char msg[50]            = {'\0'};
-uint8_t test_write_read = 0;
 uint8_t err             = 0;
                                     
 
@@ -68,10 +115,16 @@ int main(void) {
 
     CyGlobalIntEnable; /* Enable global interrupts. */
     
+    // Millisecond time base (first, so that the time to first sample includes the whole startup)
+    ms_ticks = 0;
+    CySysTickStart();
+    CySysTickSetCallback(0, Custom_SysTick_Callback);
+    
     // Start components (EEPROM, I2C, UART)
     EEPROM_Start();
     I2C_Master_Start();
     UART_Start();
+    Transmit_Start();
     
     // The LIS3DH datasheet states that the boot procedure of the device is completed
     // 5ms after the power-up of the device
@@ -82,19 +135,35 @@ int main(void) {
     /*         CONNECTED DEVICES          */
     /* ---------------------------------- */    
     
+    // Look for the LIS3DH only where they can be (WHO AM I checked as well):
+    // the full scan is available with DIAGNOSTIC_CMD
+    if(LIS3DH_Probe() == ERROR) {
+        UART_PutString("ERROR OCCURRED: LIS3DH not found\r\n");
+        UART_PutString("Reset the device\r\n");
+        return -1;
+    }
+    
+#if FAST_BOOT
+    
+#if ACQUISITION_MODE == ACQUISITION_POLLING
+    uint8_t status_register = 0;
+#endif
+    
+#else
+    
     // Check which devices are present on the I2C bus (just as intial control)
     for (int i=0;i<128;i++) {
         // Scan the whole I2C bus --> search for LIS3DH
         if (I2C_Peripheral_IsDeviceConnected(i)) {
             // Display address of connected device in hex format
-            sprintf(msg, "CONNECTED DEVICE: 0x%02X [Expected: 0x18]\r\n", i);
+            sprintf(msg, "CONNECTED DEVICE: 0x%02X [Expected: 0x18/0x19]\r\n", i);
             UART_PutString(msg);
             
             /* !IMPORTANT!
-             * For this application, only the 0x18 adress should be occupied on the I2C
-             * bus. Any other connection will lead to an error in the communication
+             * For this application, only the 0x18 and 0x19 (SA0 high) adresses should be
+             * occupied on the I2C bus. Any other connection will lead to an error in the communication
             */
-            if(i != LIS3DH_DEVICE_ADDRESS) {
+            if((i != LIS3DH_DEVICE_ADDRESS) && (i != LIS3DH_DEVICE_ADDRESS_SA0)) {
                 UART_PutString("ERROR OCCURRED\r\n");
                 UART_PutString("--------------------\r\n");
                 UART_PutString("Reset the device\r\n");
@@ -112,7 +181,7 @@ int main(void) {
     
     // Read WHO AM I register of connected device
     uint8_t who_am_i_reg = 0;
-    err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    err = I2C_Peripheral_ReadRegister(lis3dh_address,
                                       LIS3DH_WHO_AM_I_REG, 
                                       &who_am_i_reg);
     if(err == NO_ERROR) {    
@@ -125,7 +194,7 @@ int main(void) {
     
     // Read Status register of connected device
     uint8_t status_register = 0;
-    err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    err = I2C_Peripheral_ReadRegister(lis3dh_address,
                                       LIS3DH_STATUS_REG,
                                       &status_register);
     if(err == NO_ERROR) {    
@@ -138,7 +207,7 @@ int main(void) {
     
     // Read Control Register 1 of connected device
     uint8_t ctrl_reg1 = 0;
-    err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    err = I2C_Peripheral_ReadRegister(lis3dh_address,
                                       LIS3DH_CTRL_REG1,
                                       &ctrl_reg1);
     if(err == NO_ERROR) {
@@ -151,7 +220,7 @@ int main(void) {
 
     // Read Control Register 4 of connected device
     uint8_t ctrl_reg4 = 0;
-    err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+    err = I2C_Peripheral_ReadRegister(lis3dh_address,
                                       LIS3DH_CTRL_REG4,
                                       &ctrl_reg4);
     if(err == NO_ERROR) {
@@ -162,73 +231,54 @@ int main(void) {
         UART_PutString("Error occurred during I2C communication.\r\n");
     }    
     
+    // Start from what the LIS3DH holds: only the registers that differ are written
+    err = LIS3DH_Shadow_Sync();
+    if(err == ERROR) {
+        UART_PutString("Error occurred during I2C communication.\r\n");
+    }
+    
+#endif
+    
     
     /* ---------------------------------- */
     /*           SET FREQUENCY            */
     /* ---------------------------------- */    
     
-    // Read sampling frequency from EEPROM (adress 0x0000)
-    init_ctrl_reg1 = EEPROM_ReadByte(STARTUP_REG);
+    // Read sampling frequency from EEPROM (newest record of the journal)
+    Storage_Start(&init_ctrl_reg1);
+#if !FAST_BOOT
     sprintf(msg, "EEPROM value for CONTROL REGISTER 1: 0x%02X\r\n", init_ctrl_reg1);
     UART_PutString(msg);
+#endif
     
     /*
      * The very first time the device is set up, or in case the device has been used for
      * something else previously, in that cell of the EEPROM we could have anything.. 
-     * so check if it consistent with an allowed sampling frequency (and set the
-     * counter accordingly) otherwise set it, by default, to the lowest (1 Hz). 
-     * At the same time, set the LIS3DH accordingly.
-     * LPen bit is set to 0 to enable a proper HR setting in the control register 4.
+     * so check if it consistent with an allowed sampling frequency (one of the
+     * lis3dh_odr_table entries the UART and the I2C bus can sustain) otherwise set it,
+     * by default, to the lowest (1 Hz). At the same time, set the LIS3DH accordingly.
+     * LPen bit is embedded in the table: 0 everywhere but in the LP-only frequencies.
     */
-    switch(init_ctrl_reg1) {
-    
-        case LIS3DH_1_HZ_CTRL_REG1:
-            count_push = 1;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_1_HZ_CTRL_REG1);
-            break;
-        case LIS3DH_10_HZ_CTRL_REG1:
-            count_push = 2;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_10_HZ_CTRL_REG1);
-            break;
-        case LIS3DH_25_HZ_CTRL_REG1:
-            count_push = 3;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_25_HZ_CTRL_REG1);
-            break;
-        case LIS3DH_50_HZ_CTRL_REG1:
-            count_push = 4;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_50_HZ_CTRL_REG1);
-            break;        
-        case LIS3DH_100_HZ_CTRL_REG1:
-            count_push = 5;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_100_HZ_CTRL_REG1);
-            break;        
-        case LIS3DH_200_HZ_CTRL_REG1:
-            count_push = 0; // To be ready to restart the cycle
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_200_HZ_CTRL_REG1);
-            break;
-        default:
-            // Write default value on EEPROM (1 Hz)
-            EEPROM_UpdateTemperature();
-            EEPROM_WriteByte(LIS3DH_1_HZ_CTRL_REG1,STARTUP_REG);
-            
-            // EEPROM test
-            test_write_read = EEPROM_ReadByte(STARTUP_REG);
-            sprintf(msg, "Default value set: 0x%02X\r\n", test_write_read);
-            UART_PutString(msg);
-            
-            init_ctrl_reg1 = test_write_read;            
-            count_push = 1;
-            // Set frequency
-            SetOperatingFrequency(ctrl_reg1, LIS3DH_1_HZ_CTRL_REG1);
-            break;
+    odr_index = LIS3DH_ODR_Find(init_ctrl_reg1);
+    
+    if(odr_index == LIS3DH_ODR_INVALID) {
+        // Write default value on EEPROM (1 Hz), from the main loop
+        Storage_Request(lis3dh_odr_table[0].ctrl_reg1);
+        
+#if !FAST_BOOT
+        sprintf(msg, "Default value set: 0x%02X\r\n", lis3dh_odr_table[0].ctrl_reg1);
+        UART_PutString(msg);
+#endif
         
-    } // end initial frequency setting    
+        init_ctrl_reg1 = lis3dh_odr_table[0].ctrl_reg1;            
+        odr_index = 0;
+    }
+    
+#if !FAST_BOOT
+    
+    // Set frequency
+    SetOperatingFrequency(lis3dh_odr_table[odr_index].ctrl_reg1);
+    
     
     
     /* ---------------------------------- */
@@ -237,20 +287,20 @@ int main(void) {
     
     /*
      * Then, we have to set the LIS3DH to High Resolution operating mode
-     * This will be done only if the device is not in HR mode yet
+     * (Low Power for the frequencies that only exist in that mode)
+     * This will be done only if the device is not in that mode yet
      * To set properly the HR mode we need also the LPen bit in the CRTL_REG1 at 0..
      * This has been done when we set the sampling frequency of the device.
      * Sets also BDU
     */
-    if (ctrl_reg4 != LIS3DH_HR_MODE_CTRL_REG4) {
+    if (ctrl_reg4 != lis3dh_odr_table[odr_index].ctrl_reg4) {
         
         UART_PutString("\r\nUpdating Operating Mode\r\n");
         
         // Update the register with the correct value
-        ctrl_reg4 = LIS3DH_HR_MODE_CTRL_REG4;
-        err = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                           LIS3DH_CTRL_REG4,
-                                           ctrl_reg4);
+        ctrl_reg4 = lis3dh_odr_table[odr_index].ctrl_reg4;
+        LIS3DH_Shadow_Set(LIS3DH_CTRL_REG4, ctrl_reg4);
+        err = LIS3DH_Shadow_Flush();
         if(err == NO_ERROR) {
             sprintf(msg, "CONTROL REGISTER 4 written as: 0x%02X\r\n", ctrl_reg4);
             UART_PutString(msg);    
@@ -260,7 +310,7 @@ int main(void) {
         }        
         
         // Check that the register has been overwritten correctly
-        err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
+        err = I2C_Peripheral_ReadRegister(lis3dh_address,
                                           LIS3DH_CTRL_REG4,
                                           &ctrl_reg4);
         if(err == NO_ERROR){
@@ -272,17 +322,71 @@ int main(void) {
         }
             
     } // end HR setting
+    
+    // Conversion constants matching the operating mode, +-2g
+    Conversion_SetMode(lis3dh_odr_table[odr_index].resolution, CONVERSION_FS_2G);
+    
+    // Enable the FIFO only when needed: the LIS3DH keeps its configuration across PSoC resets
+    LIS3DH_FIFO_Setup(ACQUISITION_MODE == ACQUISITION_FIFO);
+    
+    // Same for the data ready signal on INT1
+    LIS3DH_Shadow_Set(LIS3DH_CTRL_REG3, (ACQUISITION_MODE == ACQUISITION_INTERRUPT) ? LIS3DH_I1_ZYXDA_CTRL_REG3 
+                                                                                   : LIS3DH_NO_INT_CTRL_REG3);
+    err = LIS3DH_Shadow_Flush();
+    if(err == ERROR) {
+        UART_PutString("Error occurred during I2C communication.\r\n");
+    }
+    
+#endif
+    
+    // Frequency, operating mode, FIFO and data ready signal in a single write per sensor
+    // (all of them in FAST_BOOT, the ones after the first otherwise): nothing is read
+    // first, whatever the LIS3DH kept from before a PSoC reset is overwritten
+    for(uint8_t sensor = (FAST_BOOT ? 0 : 1); sensor < lis3dh_sensor_count; sensor++) {
+        LIS3DH_Select(sensor);
+        err = LIS3DH_Configure(odr_index,
+                               ACQUISITION_MODE == ACQUISITION_FIFO,
+                               ACQUISITION_MODE == ACQUISITION_INTERRUPT);
+        if(err == ERROR) {
+            UART_PutString("Error occurred during I2C communication.\r\n");
+        }
+    }
+    LIS3DH_Select(0);
         
     
     // Init flags
-    flag_push = 0;
+    flag_push       = 0;
+    flag_data_ready = 0;
     
     // Start ISRs
     ISR_Push_StartEx(Custom_ISR_Push); 
+#if ACQUISITION_MODE == ACQUISITION_INTERRUPT
+    ISR_DataReady_StartEx(Custom_ISR_DataReady);
+    
+    // INT1 could already be high (data not read yet): a dummy read releases it,
+    // so that the next sample generates a rising edge
+    I2C_Peripheral_ReadRegisterMulti(lis3dh_address, 
+                                     LIS3DH_OUT_X_L, 
+                                     BYTE_TO_SEND, 
+                                     AccelerationData);
+#endif
+    
+#if FILTER_ENABLED
+    // No filtering until FILTER_CMD is received
+    Filter_Configure(&filter_presets[filter_preset]);
+#endif
+    
+    // Init packet of data (# samples per packet, if batching is enabled)
+    Packet_SetBatch(lis3dh_odr_table[odr_index].batch);
+#if PACKET_ODR_MARKER
+    Packet_MarkOdr(lis3dh_odr_table[odr_index].frequency);
+#endif
     
-    // Init packet of data
-    DataBuffer[0]                      = HEADER;
-    DataBuffer[TRANSMIT_BUFFER_SIZE-1] = TAIL;
+    // Cycle-count instrumentation (compiled only if PROFILER_ENABLED)
+    PROFILER_START();
+    
+    // Duty cycle accounting (compiled only if IDLE_ENABLED)
+    IDLE_START(odr_index, ACQUISITION_MODE == ACQUISITION_POLLING);
 
     for(;;) {
     
@@ -291,135 +395,261 @@ int main(void) {
             // Reset flag
             flag_push = 0;
             
-            // Keep track of how many pushes have been done
-            count_push++;
-            
-            // Set the appropriate sampling frequency
-            switch(count_push) {
-            
-                case 1:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_1_HZ_CTRL_REG1,STARTUP_REG);
-                    // Set frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_1_HZ_CTRL_REG1);
-                    break;
-                case 2:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_10_HZ_CTRL_REG1,STARTUP_REG);
-                    // Set frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_10_HZ_CTRL_REG1);
-                    break;
-                case 3:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_25_HZ_CTRL_REG1,STARTUP_REG);
-                    // Set frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_25_HZ_CTRL_REG1);
-                    break;
-                case 4:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_50_HZ_CTRL_REG1,STARTUP_REG);
-                    // Set frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_50_HZ_CTRL_REG1);
-                    break;
-                case 5:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_100_HZ_CTRL_REG1,STARTUP_REG);
-                    // Set frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_100_HZ_CTRL_REG1);
-                    break;
-                case 6:
-                    // Write on EEPROM
-                    EEPROM_UpdateTemperature();
-                    EEPROM_WriteByte(LIS3DH_200_HZ_CTRL_REG1,STARTUP_REG);
-                    // Start frequency
-                    SetOperatingFrequency(ctrl_reg1, LIS3DH_200_HZ_CTRL_REG1);
-                    count_push = 0;
-                    break;
-                default:
-                    UART_PutString("Error\r\n");
-                    break;
+            // Move to the next frequency the UART and the I2C bus can sustain
+            odr_index = LIS3DH_ODR_Next(odr_index);
             
-            } // end switch(count_push)
+            // Write on EEPROM (deferred: the loop never waits for the row write)
+            Storage_Request(lis3dh_odr_table[odr_index].ctrl_reg1);
+            // Set frequency (same one for all the sensors)
+            for(uint8_t sensor = 0; sensor < lis3dh_sensor_count; sensor++) {
+                LIS3DH_Select(sensor);
+                LIS3DH_ODR_Apply(odr_index);
+            }
+            Packet_SetBatch(lis3dh_odr_table[odr_index].batch);
+#if PACKET_ODR_MARKER
+            Packet_MarkOdr(lis3dh_odr_table[odr_index].frequency);
+#endif
+            IDLE_SET_ODR(odr_index);
                        
         } // end if(flag_push)
         
-        // Read Status register
-        err = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                          LIS3DH_STATUS_REG,
-                                          &status_register);
-        if(err == NO_ERROR) {
+        PROFILER_MARK();
         
-            // Acquire data only if we have new data available
-            if(status_register & LIS3DH_ZYXDA_MASK) {
+#if ACQUISITION_MODE == ACQUISITION_FIFO
+        
+        // Drain everything the FIFOs collected since the last drain: the number of I2C
+        // transactions per second depends on FIFO_DRAIN_PERIOD and not on the ODR.
+        // In between, the loop keeps feeding the UART while the FIFOs fill up
+        if((int32_t)(ms_ticks - next_drain_ms) >= 0) {
+            
+            next_drain_ms = ms_ticks + FIFO_DRAIN_PERIOD;
+            
+            for(uint8_t sensor = 0; sensor < lis3dh_sensor_count; sensor++) {
                 
-                // Read all the data from X, Y and Z axes
-                err = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, 
-                                                       LIS3DH_OUT_X_L, 
-                                                       BYTE_TO_SEND, 
-                                                       AccelerationData);
+                LIS3DH_Select(sensor);
+#if PACKET_TIMESTAMP
+                uint32_t drain_us = Custom_SysTick_Micros();
+#endif
+                err = LIS3DH_FIFO_Drain(FifoData, &fifo_samples);
+                PROFILER_STAGE(PROFILER_READ);
                 if(err == NO_ERROR) {
                     
-                    // Right shift of 4 bit is necessary since data are in 12-bit resolution
-                    // while the auxiliary variable is an int16
-                    
-                    // In HR mode one digit corresponds to one mg --> to have the g value we have
-                    // to divide by 1000 and then, to have it in m/s^2, multiply by 9.81
-                    
-                    /* ---------------------------------- */
-                    /*                 X                  */
-                    /* ---------------------------------- */
-                    OutAcc = (int16_t)((AccelerationData[0] | (AccelerationData[1]<<8)))>>4;
+                    // A full FIFO in Stream mode means the oldest samples have been overwritten
+                    if(fifo_samples == LIS3DH_FIFO_SIZE) {
+                        overrun_count++;
+                    }
                     
-                    // Conversion into m/s^2
-                    conv = OutAcc/DIGIT_TO_G*G_TO_MS2;
-                    OutAcc = (int16_t) (conv*1000);            
+                    for(uint8_t sample = 0; sample < fifo_samples; sample++) {
+                        // The newest sample is the last one drained: the older ones are
+                        // one period apart (kept only by the sample that opens a packet)
+                        PACKET_STAMP(sensor, drain_us - (uint32_t)(fifo_samples-1-sample)*lis3dh_odr_table[odr_index].period_us);
+                        Packet_AddSample(sensor, &FifoData[sample*BYTE_TO_SEND]);
+                    }
                     
-                    DataBuffer[1] = (uint8_t) (OutAcc & 0xFF);
-                    DataBuffer[2] = (uint8_t) (OutAcc>>8);
-                    
-                    
-                    /* ---------------------------------- */
-                    /*                 Y                  */
-                    /* ---------------------------------- */
-                    OutAcc = (int16_t)((AccelerationData[2] | (AccelerationData[3]<<8)))>>4;
-                    
-                    // Conversion into m/s^2
-                    conv = OutAcc/DIGIT_TO_G*G_TO_MS2;
-                    OutAcc = (int16_t) (conv*1000);
-                    
-                    DataBuffer[3] = (uint8_t) (OutAcc & 0xFF);
-                    DataBuffer[4] = (uint8_t) (OutAcc>>8);
-                    
-                    
-                    /* ---------------------------------- */
-                    /*                 Z                  */
-                    /* ---------------------------------- */
-                    OutAcc = (int16_t)((AccelerationData[4] | (AccelerationData[5]<<8)))>>4;
-                    
-                    // Conversion into m/s^2
-                    conv = OutAcc/DIGIT_TO_G*G_TO_MS2;
-                    OutAcc = (int16_t) (conv*1000);                       
+                } // end if(drain is ok)
+                
+            } // end for(sensor)
+            
+        } // end if(drain due)
+        
+#elif ACQUISITION_MODE == ACQUISITION_INTERRUPT
+        
+        // The data ready interrupt replaces the STATUS_REG poll: the bus is used
+        // only to read the axes, once per sample. The read is queued and carried out
+        // by the I2C_Master interrupt, so the loop keeps running while it is in flight.
+        // ISR_DataReady is wired to the INT1 of the first sensor only
+        if(flag_data_ready && (read_handle == I2C_ASYNC_INVALID)) {
+            // Reset flag
+            flag_data_ready = 0;
+            PACKET_STAMP(0, data_ready_us);
+            
+            // Queue the read of all the data from X, Y and Z axes
+            read_handle = I2C_Async_SubmitRead(lis3dh_sensors[0].address, 
+                                               LIS3DH_OUT_X_L, 
+                                               BYTE_TO_SEND, 
+                                               AccelerationData,
+                                               NULL);
+            read_deadline_us = Custom_SysTick_Micros() + I2C_ASYNC_TIMEOUT;
+            
+            // Queue full: try again at the next iteration
+            if(read_handle == I2C_ASYNC_INVALID) {
+                flag_data_ready = 1;
+            }
+        } // end if(flag_data_ready)
+        
+        I2C_Async_Process();
+        
+        if(read_handle != I2C_ASYNC_INVALID) {
+            
+            // A read that never ends (device holding the bus, lost interrupt) is aborted
+            if((int32_t)(Custom_SysTick_Micros() - read_deadline_us) >= 0) {
+                I2C_Async_Abort();
+            }
+            
+            read_state = I2C_Async_Poll(read_handle);
+            
+            if(read_state == I2C_ASYNC_DONE) {
+                Packet_AddSample(0, AccelerationData);
+            }
+            if(read_state == I2C_ASYNC_FAILED) {
+                // INT1 stays high until OUT_X..Z are read: no rising edge would come
+                // any more, so the read is issued again
+                flag_data_ready = 1;
+            }
+            if((read_state == I2C_ASYNC_DONE) || (read_state == I2C_ASYNC_FAILED)) {
+                read_handle = I2C_ASYNC_INVALID;
+            }
+            
+        } // end if(read in flight)
+        
+#else
+        
+        // Round robin: poll the sensors starting from the one after the last served,
+        // and serve the first one with new data (with a single sensor: one poll per loop).
+        // After an empty round the next one waits IDLE_POLL_INTERVAL (0 if !IDLE_ENABLED)
+        if((int32_t)(ms_ticks - next_poll_ms) >= 0) {
+            
+            sample_found = 0;
+            
+            for(uint8_t i = 0; i < lis3dh_sensor_count; i++) {
+                
+                uint8_t sensor = (next_sensor+i) % lis3dh_sensor_count;
+                LIS3DH_Select(sensor);
+                
+#if LIS3DH_COMBINED_READ
+                
+                // Read Status register and, speculatively, the axes that follow it
+                err = I2C_Peripheral_ReadRegisterMulti(lis3dh_address,
+                                                       LIS3DH_STATUS_REG,
+                                                       1+BYTE_TO_SEND,
+                                                       StatusData);
+                status_register = StatusData[0];
+                
+                // Empty polls in the STATUS stage, the ones with data in the READ stage:
+                // (STATUS sum + READ sum) / READ count is the time per sample in both modes
+                PROFILER_STAGE((status_register & LIS3DH_ZYXDA_MASK) ? PROFILER_READ : PROFILER_STATUS);
+                if(err != NO_ERROR) {
+                    continue;
+                }
+                
+#else
+                
+                // Read Status register
+                err = I2C_Peripheral_ReadRegister(lis3dh_address,
+                                                  LIS3DH_STATUS_REG,
+                                                  &status_register);
+                PROFILER_STAGE(PROFILER_STATUS);
+                if(err != NO_ERROR) {
+                    continue;
+                }
+                
+#endif
+                
+                // The LIS3DH produced a new sample before the previous one was read
+                if(status_register & LIS3DH_ZYXOR_MASK) {
+                    overrun_count++;
+                }
+                
+                // Acquire data only if we have new data available
+                if(status_register & LIS3DH_ZYXDA_MASK) {
                     
-                    DataBuffer[5] = (uint8_t) (OutAcc & 0xFF);
-                    DataBuffer[6] = (uint8_t) (OutAcc>>8);
+                    PACKET_STAMP(sensor, Custom_SysTick_Micros());
                     
+#if LIS3DH_COMBINED_READ
+                    // Data already read with the status
+                    Packet_AddSample(sensor, &StatusData[1]);
+#else
+                    // Read all the data from X, Y and Z axes
+                    err = I2C_Peripheral_ReadRegisterMulti(lis3dh_address, 
+                                                           LIS3DH_OUT_X_L, 
+                                                           BYTE_TO_SEND, 
+                                                           AccelerationData);
+                    PROFILER_STAGE(PROFILER_READ);
+                    if(err == NO_ERROR) {
+                        Packet_AddSample(sensor, AccelerationData);
+                    } // end if(read axes output is ok)
+#endif
                     
-                    // Transmit the packet
-                    UART_PutArray(DataBuffer,TRANSMIT_BUFFER_SIZE);
+                    next_sensor  = sensor+1;
+                    sample_found = 1;
+                    break;
                     
-                } // end if(read axes output is ok)
+                } // end data transmission
                 
-            } // end data transmission
+            } // end for(sensor)
             
-        } // end if(read status register is ok)
+            // Other sensors could have data too: poll again right away
+            if(!sample_found) {
+                next_poll_ms = ms_ticks + IDLE_POLL_INTERVAL(lis3dh_odr_table[odr_index].period_us);
+            }
+            
+        } // end if(poll due)
+        
+#endif
+        
+        // Time to first sample (there is at least the 5 ms LIS3DH boot before it)
+        if((first_sample_ms == 0) && (packet_raw_bytes > 0)) {
+            first_sample_ms = ms_ticks;
+        }
+        
+        // Send the queued packets (never waits for the UART)
+        Transmit_Process();
+        
+        // Store the frequency once the button has been left alone
+        PROFILER_MARK();
+        Storage_Process();
+        PROFILER_STAGE(PROFILER_STORAGE);
+        
+        // Commands received via UART
+        command = UART_GetChar();
+        if(command == DIAGNOSTIC_CMD) {
+            LIS3DH_Diagnostic(first_sample_ms);
+        }
+#if FILTER_ENABLED
+        if(command == FILTER_CMD) {
+            // Samples filtered with different settings do not share a packet
+            Packet_Flush();
+            filter_preset = (filter_preset+1) % FILTER_PRESETS;
+            Filter_Configure(&filter_presets[filter_preset]);
+        }
+#endif
+#if ACQUISITION_MODE == ACQUISITION_FIFO
+        if(command == FIFO_REPORT_CMD) {
+            LIS3DH_FIFO_Report();
+        }
+#endif
+        if(command == VERIFY_CMD) {
+            // Brown-out of a LIS3DH: its configuration is restored from the shadow
+            for(uint8_t sensor = 0; sensor < lis3dh_sensor_count; sensor++) {
+                LIS3DH_Select(sensor);
+                LIS3DH_Shadow_Verify();
+            }
+        }
+        
+        // Statistics dump on request
+        PROFILER_PROCESS(command);
+        IDLE_PROCESS(command);
+        
+#if IDLE_ENABLED
+        // Nothing to do until the next interrupt: the check and the WFI run with the
+        // interrupts disabled, so that an event in between is not missed (it wakes the
+        // CPU up anyway). The 1 ms SysTick bounds the latency of UART and EEPROM
+        CyGlobalIntDisable;
+#if ACQUISITION_MODE == ACQUISITION_FIFO
+        if(!flag_push && ((int32_t)(ms_ticks - next_drain_ms) < 0)) {
+#elif ACQUISITION_MODE == ACQUISITION_INTERRUPT
+        if(!flag_push && !flag_data_ready && (read_handle == I2C_ASYNC_INVALID)) {
+#else
+        if(!flag_push && ((int32_t)(ms_ticks - next_poll_ms) < 0)) {
+#endif
+            Idle_Sleep();
+        }
+        CyGlobalIntEnable;
+#endif
                     
     } // end for
     
 } // end main
 
+
 /* [] END OF FILE */